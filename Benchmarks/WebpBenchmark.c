@@ -0,0 +1,523 @@
+//
+//  WebpBenchmark.c
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#include <dirent.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "WebpBufferPool.h"
+#include "WebpCompositor.h"
+#include "WebpContainer.h"
+#include "WebpPixelConverter.h"
+#if WEBPIMAGEKIT_HAS_CODEC
+#include "WebpCodec.h"
+#endif
+
+// Frame size of the synthetic kernel benchmarks.
+#define WEBP_BENCHMARK_KERNEL_WIDTH 1920
+#define WEBP_BENCHMARK_KERNEL_HEIGHT 1080
+
+typedef struct {
+    const char *path;
+    uint8_t *bytes;
+    size_t size;
+} WebpBenchmarkFile;
+
+typedef struct {
+    double *values;         // milliseconds
+    size_t count;
+    size_t capacity;
+    double pixels;          // megapixels processed by all samples
+    double bytes;           // input bytes processed by all samples
+} WebpBenchmarkSamples;
+
+typedef struct {
+    int iterations;
+    int quality;
+    int isEncodeEnabled;
+} WebpBenchmarkOptions;
+
+static inline double webpBenchmarkNow(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec * 1000.0 + (double) now.tv_nsec / 1e6;
+}
+
+static void webpBenchmarkAddSample(WebpBenchmarkSamples *samples, double value, double pixels, double bytes) {
+    if (samples->count == samples->capacity) {
+        const size_t capacity = samples->capacity ? samples->capacity * 2 : 64;
+        double *values = realloc(samples->values, capacity * sizeof(double));
+        if (!values) {
+            return;
+        }
+        samples->values = values;
+        samples->capacity = capacity;
+    }
+    samples->values[samples->count++] = value;
+    samples->pixels += pixels / 1e6;
+    samples->bytes += bytes;
+}
+
+static void webpBenchmarkClearSamples(WebpBenchmarkSamples *samples) {
+    free(samples->values);
+    memset(samples, 0, sizeof(WebpBenchmarkSamples));
+}
+
+static int webpBenchmarkCompare(const void *lhs, const void *rhs) {
+    const double lhsValue = *(const double *) lhs;
+    const double rhsValue = *(const double *) rhs;
+    return lhsValue < rhsValue ? -1 : (lhsValue > rhsValue ? 1 : 0);
+}
+
+// Nearest rank percentile of the sorted samples.
+static double webpBenchmarkPercentile(const WebpBenchmarkSamples *samples, double percentile) {
+    if (0 == samples->count) {
+        return 0;
+    }
+    size_t rank = (size_t) (percentile / 100.0 * (double) samples->count + 0.5);
+    rank = rank < 1 ? 1 : (rank > samples->count ? samples->count : rank);
+    return samples->values[rank - 1];
+}
+
+static void webpBenchmarkPrintHeader(const char *title) {
+    printf("\n%s\n", title);
+    printf("%-28s %-24s %8s %10s %10s %9s %9s %9s %9s\n",
+           "stage", "input", "samples", "MP/s", "MB/s", "p50 ms", "p90 ms", "p99 ms", "max ms");
+}
+
+static void webpBenchmarkPrintSamples(const char *stage, const char *input, WebpBenchmarkSamples *samples) {
+    if (0 == samples->count) {
+        return;
+    }
+    qsort(samples->values, samples->count, sizeof(double), webpBenchmarkCompare);
+    double total = 0;
+    for (size_t idx = 0; idx < samples->count; ++idx) {
+        total += samples->values[idx];
+    }
+    const double seconds = total / 1000.0;
+    const char *name = strrchr(input, '/') ? strrchr(input, '/') + 1 : input;
+    printf("%-28s %-24.24s %8zu %10.1f %10.1f %9.3f %9.3f %9.3f %9.3f\n",
+           stage, name, samples->count,
+           0 < seconds ? samples->pixels / seconds : 0,
+           0 < seconds ? samples->bytes / 1e6 / seconds : 0,
+           webpBenchmarkPercentile(samples, 50),
+           webpBenchmarkPercentile(samples, 90),
+           webpBenchmarkPercentile(samples, 99),
+           samples->values[samples->count - 1]);
+}
+
+static int webpBenchmarkHasSuffix(const char *name, const char *suffix) {
+    const size_t length = strlen(name);
+    const size_t suffixLength = strlen(suffix);
+    return length >= suffixLength && 0 == strcasecmp(name + length - suffixLength, suffix);
+}
+
+static int webpBenchmarkLoadFile(const char *path, WebpBenchmarkFile *file) {
+    memset(file, 0, sizeof(WebpBenchmarkFile));
+    FILE *stream = fopen(path, "rb");
+    if (!stream) {
+        return 0;
+    }
+    int result = 0;
+    long size;
+    if (0 == fseek(stream, 0, SEEK_END) && 0 < (size = ftell(stream)) && 0 == fseek(stream, 0, SEEK_SET)) {
+        file->bytes = malloc((size_t) size);
+        file->size = (size_t) size;
+        result = file->bytes && 1 == fread(file->bytes, (size_t) size, 1, stream);
+    }
+    fclose(stream);
+    if (!result || !webpContainerHasSignature(file->bytes, file->size)) {
+        free(file->bytes);
+        return 0;
+    }
+    file->path = strdup(path);
+    return 1;
+}
+
+static int webpBenchmarkCompareFiles(const void *lhs, const void *rhs) {
+    return strcmp(((const WebpBenchmarkFile *) lhs)->path, ((const WebpBenchmarkFile *) rhs)->path);
+}
+
+// Collects files given on the command line and the .webp files of the given directories.
+static size_t webpBenchmarkLoadCorpus(char **paths, int count, WebpBenchmarkFile **files) {
+    size_t fileCount = 0;
+    size_t capacity = 0;
+    *files = NULL;
+    for (int pathIdx = 0; pathIdx < count; ++pathIdx) {
+        struct stat info;
+        if (0 != stat(paths[pathIdx], &info)) {
+            fprintf(stderr, "skipping %s: not found\n", paths[pathIdx]);
+            continue;
+        }
+        DIR *dir = S_ISDIR(info.st_mode) ? opendir(paths[pathIdx]) : NULL;
+        struct dirent *entry = NULL;
+        do {
+            char path[4096];
+            if (dir) {
+                if (!(entry = readdir(dir))) {
+                    break;
+                }
+                if (!webpBenchmarkHasSuffix(entry->d_name, ".webp")) {
+                    continue;
+                }
+                snprintf(path, sizeof(path), "%s/%s", paths[pathIdx], entry->d_name);
+            }
+            else {
+                snprintf(path, sizeof(path), "%s", paths[pathIdx]);
+            }
+            if (fileCount == capacity) {
+                const size_t grownCapacity = capacity ? capacity * 2 : 16;
+                WebpBenchmarkFile *grown = realloc(*files, grownCapacity * sizeof(WebpBenchmarkFile));
+                if (!grown) {
+                    break;
+                }
+                *files = grown;
+                capacity = grownCapacity;
+            }
+            if (webpBenchmarkLoadFile(path, &(*files)[fileCount])) {
+                fileCount++;
+            }
+            else {
+                fprintf(stderr, "skipping %s: not a WebP file\n", path);
+            }
+        } while (dir);
+        if (dir) {
+            closedir(dir);
+        }
+    }
+    if (1 < fileCount) {
+        qsort(*files, fileCount, sizeof(WebpBenchmarkFile), webpBenchmarkCompareFiles);
+    }
+    return fileCount;
+}
+
+// Premultiplied BGRA pixels with a gradient of alpha, so the blend kernels see every case.
+static void webpBenchmarkFillPixels(uint8_t *pixels, size_t width, size_t height, size_t stride) {
+    for (size_t y = 0; y < height; ++y) {
+        uint8_t *row = pixels + y * stride;
+        for (size_t x = 0; x < width; ++x) {
+            const uint32_t alpha = (uint32_t) ((x + y) & 0xff);
+            row[x * 4 + 0] = (uint8_t) (((x * 7) & 0xff) * alpha / 255);
+            row[x * 4 + 1] = (uint8_t) (((y * 3) & 0xff) * alpha / 255);
+            row[x * 4 + 2] = (uint8_t) (((x ^ y) & 0xff) * alpha / 255);
+            row[x * 4 + 3] = (uint8_t) alpha;
+        }
+    }
+}
+
+static void webpBenchmarkKernels(const WebpBenchmarkOptions *options) {
+    const size_t width = WEBP_BENCHMARK_KERNEL_WIDTH;
+    const size_t height = WEBP_BENCHMARK_KERNEL_HEIGHT;
+    const size_t stride = width * 4;
+    const double pixels = (double) (width * height);
+    uint8_t *src = malloc(stride * height);
+    uint8_t *dst = malloc(stride * height);
+    uint32_t *argb = malloc(width * height * sizeof(uint32_t));
+    if (!src || !dst || !argb) {
+        free(src);
+        free(dst);
+        free(argb);
+        return;
+    }
+    webpBenchmarkFillPixels(src, width, height, stride);
+    webpBenchmarkFillPixels(dst, width, height, stride);
+    const WebpPixelLayout layout = { .bytesPerPixel = 4, .red = 2, .green = 1, .blue = 0, .alpha = 3, .isPremultiplied = 1 };
+    char kernel[64];
+    snprintf(kernel, sizeof(kernel), "blend (%s)", webpCompositorKernelName());
+    char input[32];
+    snprintf(input, sizeof(input), "synthetic %zux%zu", width, height);
+
+    webpBenchmarkPrintHeader("Kernels");
+    WebpBenchmarkSamples samples = {0};
+    for (int iteration = 0; iteration < options->iterations; ++iteration) {
+        const double start = webpBenchmarkNow();
+        webpCompositorBlendRect(dst, stride, src, stride, width, height);
+        webpBenchmarkAddSample(&samples, webpBenchmarkNow() - start, pixels, (double) (stride * height));
+    }
+    webpBenchmarkPrintSamples(kernel, input, &samples);
+    webpBenchmarkClearSamples(&samples);
+    for (int iteration = 0; iteration < options->iterations; ++iteration) {
+        const double start = webpBenchmarkNow();
+        webpCompositorBlendRectScalar(dst, stride, src, stride, width, height);
+        webpBenchmarkAddSample(&samples, webpBenchmarkNow() - start, pixels, (double) (stride * height));
+    }
+    webpBenchmarkPrintSamples("blend (scalar)", input, &samples);
+    webpBenchmarkClearSamples(&samples);
+    for (int iteration = 0; iteration < options->iterations; ++iteration) {
+        const double start = webpBenchmarkNow();
+        webpCompositorCopyRect(dst, stride, src, stride, width, height);
+        webpBenchmarkAddSample(&samples, webpBenchmarkNow() - start, pixels, (double) (stride * height));
+    }
+    webpBenchmarkPrintSamples("copy", input, &samples);
+    webpBenchmarkClearSamples(&samples);
+    for (int iteration = 0; iteration < options->iterations; ++iteration) {
+        const double start = webpBenchmarkNow();
+        webpConvertPixelsToArgb(src, stride, &layout, argb, width, width, height);
+        webpBenchmarkAddSample(&samples, webpBenchmarkNow() - start, pixels, (double) (stride * height));
+    }
+    webpBenchmarkPrintSamples("import premultiplied BGRA", input, &samples);
+    webpBenchmarkClearSamples(&samples);
+    free(src);
+    free(dst);
+    free(argb);
+}
+
+static void webpBenchmarkContainer(const WebpBenchmarkFile *files, size_t fileCount, const WebpBenchmarkOptions *options) {
+    WebpBenchmarkSamples samples = {0};
+    for (size_t fileIdx = 0; fileIdx < fileCount; ++fileIdx) {
+        for (int iteration = 0; iteration < options->iterations; ++iteration) {
+            WebpContainerInfo info;
+            const double start = webpBenchmarkNow();
+            webpContainerParse(files[fileIdx].bytes, files[fileIdx].size, &info);
+            webpBenchmarkAddSample(&samples, webpBenchmarkNow() - start, 0, (double) files[fileIdx].size);
+        }
+    }
+    webpBenchmarkPrintSamples("container parse", "corpus", &samples);
+    webpBenchmarkClearSamples(&samples);
+}
+
+#if WEBPIMAGEKIT_HAS_CODEC
+
+static void webpBenchmarkMergeSamples(WebpBenchmarkSamples *total, const WebpBenchmarkSamples *samples) {
+    for (size_t idx = 0; idx < samples->count; ++idx) {
+        webpBenchmarkAddSample(total, samples->values[idx], 0, 0);
+    }
+    total->pixels += samples->pixels;
+    total->bytes += samples->bytes;
+}
+
+// Renders every frame of the file, each sample is the latency of one frame.
+static int webpBenchmarkDecode(const WebpBenchmarkFile *file, const WebpBenchmarkOptions *options,
+                               WebpBenchmarkSamples *samples, uint8_t **canvas, size_t *capacity,
+                               WebpCodecAnimationInfo *info) {
+    for (int iteration = 0; iteration < options->iterations; ++iteration) {
+        double start = webpBenchmarkNow();
+        WebpCodecAnimation *animation = webpCodecAnimationCreate(file->bytes, file->size);
+        if (!animation) {
+            return 0;
+        }
+        webpCodecAnimationGetInfo(animation, info);
+        const size_t stride = (size_t) info->canvasWidth * 4;
+        const size_t canvasSize = stride * info->canvasHeight;
+        if (*capacity < canvasSize) {
+            webpBufferPoolRelease(*canvas, *capacity);
+            *capacity = 0;
+            if (!(*canvas = webpBufferPoolAcquire(canvasSize, capacity))) {
+                webpCodecAnimationDelete(animation);
+                return 0;
+            }
+        }
+        const double pixels = (double) info->canvasWidth * (double) info->canvasHeight;
+        const double frameBytes = (double) file->size / info->frameCount;
+        for (uint32_t frameIdx = 0; frameIdx < info->frameCount; ++frameIdx) {
+            // The demux time is part of the first frame latency, like the time to first frame of a viewer.
+            if (!webpCodecAnimationRenderFrame(animation, frameIdx, *canvas, stride, NULL)) {
+                webpCodecAnimationDelete(animation);
+                return 0;
+            }
+            const double now = webpBenchmarkNow();
+            webpBenchmarkAddSample(samples, now - start, pixels, frameBytes);
+            start = now;
+        }
+        webpCodecAnimationDelete(animation);
+    }
+    return 1;
+}
+
+// Encodes the first frame, each sample covers the import of the pixels and the encode.
+static int webpBenchmarkEncode(const uint8_t *canvas, const WebpCodecAnimationInfo *info, int isLossless,
+                               const WebpBenchmarkOptions *options, WebpBenchmarkSamples *samples, size_t *outputSize) {
+    WebPConfig config;
+    if (!WebPConfigInit(&config)) {
+        return 0;
+    }
+    if (isLossless) {
+        WebPConfigLosslessPreset(&config, 6);
+    }
+    else {
+        config.quality = (float) options->quality;
+    }
+    config.thread_level = 1;
+    WebPPicture picture;
+    if (!WebPPictureInit(&picture)) {
+        return 0;
+    }
+    const WebpPixelLayout layout = { .bytesPerPixel = 4, .red = 2, .green = 1, .blue = 0, .alpha = 3, .isPremultiplied = 1 };
+    const double pixels = (double) info->canvasWidth * (double) info->canvasHeight;
+    int result = 1;
+    for (int iteration = 0; iteration < options->iterations && result; ++iteration) {
+        WebPMemoryWriter writer;
+        WebPMemoryWriterInit(&writer);
+        const double start = webpBenchmarkNow();
+        result = webpCodecPreparePicture(&picture, info->canvasWidth, info->canvasHeight)
+                && webpCodecImportPixels(&picture, canvas, (size_t) info->canvasWidth * 4, &layout)
+                && webpCodecEncode(&config, &picture, WebPMemoryWrite, &writer);
+        webpBenchmarkAddSample(samples, webpBenchmarkNow() - start, pixels, pixels * 4);
+        *outputSize = writer.size;
+        WebPMemoryWriterClear(&writer);
+        // The encoder converts the picture in place, every iteration starts from the same state.
+        WebPPictureFree(&picture);
+    }
+    return result;
+}
+
+// Returns the number of files which failed to decode or encode.
+static size_t webpBenchmarkCodec(const WebpBenchmarkFile *files, size_t fileCount, const WebpBenchmarkOptions *options) {
+    webpBenchmarkPrintHeader("Decode, per frame latency");
+    WebpBenchmarkSamples decodeTotal = {0};
+    WebpBenchmarkSamples lossyTotal = {0};
+    WebpBenchmarkSamples losslessTotal = {0};
+    uint8_t *canvas = NULL;
+    size_t capacity = 0;
+    size_t failureCount = 0;
+    char stage[64];
+    for (size_t fileIdx = 0; fileIdx < fileCount; ++fileIdx) {
+        const WebpBenchmarkFile *file = &files[fileIdx];
+        WebpBenchmarkSamples samples = {0};
+        WebpCodecAnimationInfo info;
+        if (!webpBenchmarkDecode(file, options, &samples, &canvas, &capacity, &info)) {
+            fprintf(stderr, "failed to decode %s\n", file->path);
+            ++failureCount;
+            webpBenchmarkClearSamples(&samples);
+            continue;
+        }
+        snprintf(stage, sizeof(stage), "decode %ux%u x%u", info.canvasWidth, info.canvasHeight, info.frameCount);
+        webpBenchmarkPrintSamples(stage, file->path, &samples);
+        webpBenchmarkMergeSamples(&decodeTotal, &samples);
+        webpBenchmarkClearSamples(&samples);
+        if (!options->isEncodeEnabled) {
+            continue;
+        }
+        // The first frame is encoded, the canvas holds the last one after the decode.
+        WebpCodecAnimation *animation = webpCodecAnimationCreate(file->bytes, file->size);
+        const int isRendered = animation
+                && webpCodecAnimationRenderFrame(animation, 0, canvas, (size_t) info.canvasWidth * 4, NULL);
+        webpCodecAnimationDelete(animation);
+        if (!isRendered) {
+            fprintf(stderr, "failed to decode %s\n", file->path);
+            ++failureCount;
+            continue;
+        }
+        size_t outputSize = 0;
+        int isEncoded = 1;
+        if (webpBenchmarkEncode(canvas, &info, 0, options, &samples, &outputSize)) {
+            snprintf(stage, sizeof(stage), "encode lossy q%d %zuB", options->quality, outputSize);
+            webpBenchmarkPrintSamples(stage, file->path, &samples);
+            webpBenchmarkMergeSamples(&lossyTotal, &samples);
+        }
+        else {
+            isEncoded = 0;
+        }
+        webpBenchmarkClearSamples(&samples);
+        if (webpBenchmarkEncode(canvas, &info, 1, options, &samples, &outputSize)) {
+            snprintf(stage, sizeof(stage), "encode lossless %zuB", outputSize);
+            webpBenchmarkPrintSamples(stage, file->path, &samples);
+            webpBenchmarkMergeSamples(&losslessTotal, &samples);
+        }
+        else {
+            isEncoded = 0;
+        }
+        webpBenchmarkClearSamples(&samples);
+        if (!isEncoded) {
+            fprintf(stderr, "failed to encode %s\n", file->path);
+            ++failureCount;
+        }
+    }
+    webpBufferPoolRelease(canvas, capacity);
+    webpBenchmarkPrintHeader("Corpus");
+    webpBenchmarkPrintSamples("decode frame", "all files", &decodeTotal);
+    webpBenchmarkPrintSamples("encode lossy", "all files", &lossyTotal);
+    webpBenchmarkPrintSamples("encode lossless", "all files", &losslessTotal);
+    webpBenchmarkClearSamples(&decodeTotal);
+    webpBenchmarkClearSamples(&lossyTotal);
+    webpBenchmarkClearSamples(&losslessTotal);
+    return failureCount;
+}
+
+#endif
+
+static size_t webpBenchmarkPeakRss(void) {
+    struct rusage usage;
+    if (0 != getrusage(RUSAGE_SELF, &usage)) {
+        return 0;
+    }
+#if defined(__APPLE__)
+    return (size_t) usage.ru_maxrss;
+#else
+    return (size_t) usage.ru_maxrss * 1024;
+#endif
+}
+
+static void webpBenchmarkUsage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [-n iterations] [-q quality] [-E] [file.webp | directory ...]\n"
+            "  -n  iterations of every measurement, 10 by default\n"
+            "  -q  quality of the lossy encode, 75 by default\n"
+            "  -E  skip the encode benchmarks\n"
+            "Without input files only the kernels are measured.\n",
+            name);
+}
+
+int main(int argc, char **argv) {
+    WebpBenchmarkOptions options = { .iterations = 10, .quality = 75, .isEncodeEnabled = 1 };
+    int option;
+    while (-1 != (option = getopt(argc, argv, "n:q:Eh"))) {
+        switch (option) {
+            case 'n':
+                options.iterations = atoi(optarg);
+                break;
+            case 'q':
+                options.quality = atoi(optarg);
+                break;
+            case 'E':
+                options.isEncodeEnabled = 0;
+                break;
+            default:
+                webpBenchmarkUsage(argv[0]);
+                return 'h' == option ? 0 : 1;
+        }
+    }
+    if (0 >= options.iterations || 0 > options.quality || 100 < options.quality) {
+        webpBenchmarkUsage(argv[0]);
+        return 1;
+    }
+    WebpBenchmarkFile *files = NULL;
+    const size_t fileCount = webpBenchmarkLoadCorpus(argv + optind, argc - optind, &files);
+    if (optind < argc && 0 == fileCount) {
+        fprintf(stderr, "no WebP files found\n");
+        return 1;
+    }
+    webpBenchmarkKernels(&options);
+    size_t failureCount = 0;
+    if (0 < fileCount) {
+        webpBenchmarkContainer(files, fileCount, &options);
+#if WEBPIMAGEKIT_HAS_CODEC
+        failureCount = webpBenchmarkCodec(files, fileCount, &options);
+#else
+        printf("\nThe core is built without libwebp, decode and encode are not measured.\n");
+#endif
+    }
+    printf("\npeak RSS: %.1f MB\n", (double) webpBenchmarkPeakRss() / (1024.0 * 1024.0));
+    for (size_t fileIdx = 0; fileIdx < fileCount; ++fileIdx) {
+        free((void *) files[fileIdx].path);
+        free(files[fileIdx].bytes);
+    }
+    free(files);
+    if (0 < failureCount) {
+        // Broken files would otherwise only leave a line in the output, scripts and CI must see them.
+        fprintf(stderr, "%zu of %zu files failed\n", failureCount, fileCount);
+        return 1;
+    }
+    return 0;
+}
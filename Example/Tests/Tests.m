@@ -7,6 +7,8 @@
 //
 
 @import XCTest;
+#import <libwebp/demux.h>
+#import <WebpImageKit/WebpImageKit.h>
 
 @interface Tests : XCTestCase
 
@@ -14,22 +16,250 @@
 
 @implementation Tests
 
-- (void)setUp
+- (UIImage *)imageWithSize:(CGSize)size
 {
-    [super setUp];
-    // Put setup code here. This method is called before the invocation of each test method in the class.
+    UIGraphicsImageRendererFormat *format = [UIGraphicsImageRendererFormat preferredFormat];
+    format.scale = 1.0;
+    UIGraphicsImageRenderer *renderer = [[UIGraphicsImageRenderer alloc] initWithSize:size format:format];
+    return [renderer imageWithActions:^(UIGraphicsImageRendererContext *context) {
+        [UIColor.redColor setFill];
+        [context fillRect:CGRectMake(0, 0, size.width / 2, size.height)];
+        [UIColor.blueColor setFill];
+        [context fillRect:CGRectMake(size.width / 2, 0, size.width / 2, size.height)];
+    }];
 }
 
-- (void)tearDown
+- (UIImage *)opaqueImageWithSize:(CGSize)size color:(UIColor *)color rect:(CGRect)rect
 {
-    // Put teardown code here. This method is called after the invocation of each test method in the class.
-    [super tearDown];
+    UIGraphicsImageRendererFormat *format = [UIGraphicsImageRendererFormat preferredFormat];
+    format.scale = 1.0;
+    format.opaque = YES;
+    UIGraphicsImageRenderer *renderer = [[UIGraphicsImageRenderer alloc] initWithSize:size format:format];
+    return [renderer imageWithActions:^(UIGraphicsImageRendererContext *context) {
+        [UIColor.redColor setFill];
+        [context fillRect:CGRectMake(0, 0, size.width / 2, size.height)];
+        [UIColor.blueColor setFill];
+        [context fillRect:CGRectMake(size.width / 2, 0, size.width / 2, size.height)];
+        [color setFill];
+        [context fillRect:rect];
+    }];
 }
 
-- (void)testExample
+// Encodes 64x32 frames: the base frame, a frame with a changed 8x6 square, the same frame again
+// and a frame which changes completely. Independent frames end with a smaller 32x16 frame.
+- (NSData *)animationDataWithMode:(WIKAnimationMode)mode path:(nullable NSString *)path
 {
-    XCTFail(@"No implementation for \"%s\"", __PRETTY_FUNCTION__);
+    WIKEncoderConfig *config = [[[[WIKEncoderConfigBuilder builderWithImageQuality:0.8]
+            setAnimationMode:mode]
+            setKeyFrameDistanceMin:0 max:0]
+            construct];
+    WIKAnimationEncoder *encoder = path
+            ? [[WIKAnimationEncoder alloc] initWithConfig:config loopCount:3 path:path]
+            : [[WIKAnimationEncoder alloc] initWithConfig:config loopCount:3];
+    XCTAssertNotNil(encoder);
+    const CGSize size = CGSizeMake(64, 32);
+    UIImage *baseImage = [self opaqueImageWithSize:size color:UIColor.redColor rect:CGRectZero];
+    UIImage *changedImage = [self opaqueImageWithSize:size color:UIColor.greenColor rect:CGRectMake(21, 11, 8, 6)];
+    UIImage *filledImage = [self opaqueImageWithSize:size color:UIColor.greenColor rect:CGRectMake(0, 0, 64, 32)];
+    XCTAssertTrue([encoder appendFrame:baseImage duration:0.25]);
+    XCTAssertTrue([encoder appendFrame:changedImage duration:0.5]);
+    XCTAssertTrue([encoder appendFrame:changedImage duration:0.25]);
+    XCTAssertTrue([encoder appendFrame:filledImage duration:0.125]);
+    if (WIKAnimationModeIndependentFrames == mode) {
+        UIImage *smallImage = [self opaqueImageWithSize:CGSizeMake(32, 16) color:UIColor.greenColor rect:CGRectZero];
+        XCTAssertTrue([encoder appendFrame:smallImage duration:0.125]);
+    }
+    XCTAssertTrue([encoder finish]);
+    XCTAssertEqual(encoder.frameCount, WIKAnimationModeIndependentFrames == mode ? 5u : 4u);
+    return path ? [NSData dataWithContentsOfFile:path] : encoder.data;
 }
 
-@end
+- (void)verifyAnimationData:(NSData *)data
+                     frames:(const WebPIterator *)expectedFrames
+                      count:(int)count
+                      flags:(uint32_t)flags
+{
+    WebPData webpData = { data.bytes, data.length };
+    WebPDemuxer *demuxer = WebPDemux(&webpData);
+    XCTAssertTrue(NULL != demuxer);
+    if (!demuxer) {
+        return;
+    }
+    XCTAssertEqual(WebPDemuxGetI(demuxer, WEBP_FF_FORMAT_FLAGS), flags);
+    XCTAssertEqual(WebPDemuxGetI(demuxer, WEBP_FF_CANVAS_WIDTH), 64u);
+    XCTAssertEqual(WebPDemuxGetI(demuxer, WEBP_FF_CANVAS_HEIGHT), 32u);
+    XCTAssertEqual(WebPDemuxGetI(demuxer, WEBP_FF_LOOP_COUNT), 3u);
+    XCTAssertEqual(WebPDemuxGetI(demuxer, WEBP_FF_FRAME_COUNT), (uint32_t) count);
+    for (int frameIdx = 0; frameIdx < count; ++frameIdx) {
+        WebPIterator iterator;
+        XCTAssertTrue(WebPDemuxGetFrame(demuxer, frameIdx + 1, &iterator));
+        const WebPIterator *expected = &expectedFrames[frameIdx];
+        XCTAssertEqual(iterator.x_offset, expected->x_offset, @"frame %d", frameIdx);
+        XCTAssertEqual(iterator.y_offset, expected->y_offset, @"frame %d", frameIdx);
+        XCTAssertEqual(iterator.width, expected->width, @"frame %d", frameIdx);
+        XCTAssertEqual(iterator.height, expected->height, @"frame %d", frameIdx);
+        XCTAssertEqual(iterator.duration, expected->duration, @"frame %d", frameIdx);
+        XCTAssertEqual(iterator.dispose_method, expected->dispose_method, @"frame %d", frameIdx);
+        XCTAssertEqual(iterator.blend_method, expected->blend_method, @"frame %d", frameIdx);
+        WebPDemuxReleaseIterator(&iterator);
+    }
+    WebPDemuxDelete(demuxer);
+    // The frames decode as well.
+    XCTAssertNotNil([UIImage webpImageWithData:data]);
+}
+
+- (NSString *)temporaryPathWithName:(NSString *)name
+{
+    NSString *directory = [NSTemporaryDirectory() stringByAppendingPathComponent:NSUUID.UUID.UUIDString];
+    XCTAssertTrue([NSFileManager.defaultManager createDirectoryAtPath:directory
+                                          withIntermediateDirectories:YES
+                                                           attributes:nil
+                                                                error:nil]);
+    [self addTeardownBlock:^{
+        [NSFileManager.defaultManager removeItemAtPath:directory error:nil];
+    }];
+    return [directory stringByAppendingPathComponent:name];
+}
+
+- (void)testAnimationEncoderInterFrames
+{
+    // Identical frames are merged, the changed square is encoded at even offsets.
+    const WebPIterator frames[] = {
+            { .x_offset = 0, .y_offset = 0, .width = 64, .height = 32, .duration = 250,
+              .dispose_method = WEBP_MUX_DISPOSE_NONE, .blend_method = WEBP_MUX_NO_BLEND },
+            { .x_offset = 20, .y_offset = 10, .width = 9, .height = 7, .duration = 750,
+              .dispose_method = WEBP_MUX_DISPOSE_NONE, .blend_method = WEBP_MUX_NO_BLEND },
+            { .x_offset = 0, .y_offset = 0, .width = 64, .height = 32, .duration = 125,
+              .dispose_method = WEBP_MUX_DISPOSE_NONE, .blend_method = WEBP_MUX_NO_BLEND },
+    };
+    NSData *data = [self animationDataWithMode:WIKAnimationModeInterFrame path:nil];
+    [self verifyAnimationData:data frames:frames count:3 flags:ANIMATION_FLAG];
+
+    NSString *path = [self temporaryPathWithName:@"inter.webp"];
+    NSData *fileData = [self animationDataWithMode:WIKAnimationModeInterFrame path:path];
+    XCTAssertEqualObjects(fileData, data);
+    // Only the destination is left, the temporary file is renamed into it.
+    NSArray *files = [NSFileManager.defaultManager contentsOfDirectoryAtPath:path.stringByDeletingLastPathComponent error:nil];
+    XCTAssertEqualObjects(files, @[@"inter.webp"]);
+}
+
+- (void)testAnimationEncoderIndependentFrames
+{
+    // Every frame is written in full, the smaller last frame makes the canvas partially transparent.
+    const WebPIterator frames[] = {
+            { .x_offset = 0, .y_offset = 0, .width = 64, .height = 32, .duration = 250,
+              .dispose_method = WEBP_MUX_DISPOSE_BACKGROUND, .blend_method = WEBP_MUX_NO_BLEND },
+            { .x_offset = 0, .y_offset = 0, .width = 64, .height = 32, .duration = 500,
+              .dispose_method = WEBP_MUX_DISPOSE_BACKGROUND, .blend_method = WEBP_MUX_NO_BLEND },
+            { .x_offset = 0, .y_offset = 0, .width = 64, .height = 32, .duration = 250,
+              .dispose_method = WEBP_MUX_DISPOSE_BACKGROUND, .blend_method = WEBP_MUX_NO_BLEND },
+            { .x_offset = 0, .y_offset = 0, .width = 64, .height = 32, .duration = 125,
+              .dispose_method = WEBP_MUX_DISPOSE_BACKGROUND, .blend_method = WEBP_MUX_NO_BLEND },
+            { .x_offset = 0, .y_offset = 0, .width = 32, .height = 16, .duration = 125,
+              .dispose_method = WEBP_MUX_DISPOSE_BACKGROUND, .blend_method = WEBP_MUX_NO_BLEND },
+    };
+    NSData *data = [self animationDataWithMode:WIKAnimationModeIndependentFrames path:nil];
+    [self verifyAnimationData:data frames:frames count:5 flags:ANIMATION_FLAG | ALPHA_FLAG];
+
+    NSString *path = [self temporaryPathWithName:@"independent.webp"];
+    NSData *fileData = [self animationDataWithMode:WIKAnimationModeIndependentFrames path:path];
+    XCTAssertEqualObjects(fileData, data);
+    NSArray *files = [NSFileManager.defaultManager contentsOfDirectoryAtPath:path.stringByDeletingLastPathComponent error:nil];
+    XCTAssertEqualObjects(files, @[@"independent.webp"]);
+}
+
+- (NSData *)webpDataWithSize:(CGSize)size
+{
+    WIKEncoderConfig *config = [[WIKEncoderConfigBuilder builderWithImageQuality:0.8] construct];
+    return [[self imageWithSize:size] webpDataWithConfig:config];
+}
+
+- (void)testEncodeDecodeRoundTrip
+{
+    NSData *data = [self webpDataWithSize:CGSizeMake(64, 32)];
+    XCTAssertNotNil(data);
+    CGImageRef image = WebpImageCreateFromDataWithSize((__bridge CFDataRef) data, 0);
+    XCTAssertTrue(NULL != image);
+    XCTAssertEqual(CGImageGetWidth(image), 64u);
+    XCTAssertEqual(CGImageGetHeight(image), 32u);
+    CGImageRelease(image);
+}
+
+- (void)testRegionDecode
+{
+    NSData *data = [self webpDataWithSize:CGSizeMake(64, 32)];
+    CGImageRef image = WebpImageCreateFromDataWithRect((__bridge CFDataRef) data, CGRectMake(48, 16, 32, 32), 0);
+    XCTAssertTrue(NULL != image);
+    XCTAssertEqual(CGImageGetWidth(image), 16u);
+    XCTAssertEqual(CGImageGetHeight(image), 16u);
+    CGImageRelease(image);
+}
+
+- (void)testRegionOutsideOfImage
+{
+    NSData *data = [self webpDataWithSize:CGSizeMake(64, 32)];
+    CGImageRef image = WebpImageCreateFromDataWithRect((__bridge CFDataRef) data, CGRectMake(100, 100, 10, 10), 0);
+    XCTAssertTrue(NULL == image);
+    XCTAssertNil([UIImage webpImageWithData:data rect:CGRectMake(100, 100, 10, 10) displaySize:CGSizeZero scaleFactor:1.0]);
+}
+
+- (void)testBuilderConstructsSnapshots
+{
+    WIKEncoderConfigBuilder *builder = [WIKEncoderConfigBuilder builderWithImageQuality:0.6];
+    WIKEncoderConfig *lossy = [builder construct];
+    WIKEncoderConfig *lossless = [[builder setMode:WIKEncoderModeLossLess] construct];
+    XCTAssertNotEqual(lossy, lossless);
+    XCTAssertEqual(lossy.mode, WIKEncoderModeLossy);
+    XCTAssertEqual(lossless.mode, WIKEncoderModeLossLess);
+}
+
+- (void)testCancelAllRequests
+{
+    WIKImageOperationQueue *queue = [[WIKImageOperationQueue alloc] initWithMaxConcurrentOperationCount:1];
+    NSData *data = [self webpDataWithSize:CGSizeMake(64, 32)];
+    WIKImageRequest *request = [queue decodeImageWithData:data
+                                              displaySize:CGSizeZero
+                                              scaleFactor:1.0
+                                                 priority:WIKRequestPriorityNormal
+                                          completionQueue:nil
+                                               completion:^(UIImage *image) {
+        XCTFail(@"Completion of a cancelled request is called");
+    }];
+    [queue cancelAllRequests];
+    XCTAssertTrue(request.isCancelled);
+    [[NSRunLoop mainRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.2]];
+}
 
+- (void)testRequestAfterCancelledCoalescedRequests
+{
+    WIKImageOperationQueue *queue = [[WIKImageOperationQueue alloc] initWithMaxConcurrentOperationCount:1];
+    NSData *data = [self webpDataWithSize:CGSizeMake(2048, 2048)];
+    NSMutableArray<WIKImageRequest *> *requests = [NSMutableArray array];
+    for (int requestIdx = 0; requestIdx < 2; ++requestIdx) {
+        [requests addObject:[queue decodeImageWithData:data
+                                           displaySize:CGSizeZero
+                                           scaleFactor:1.0
+                                              priority:WIKRequestPriorityNormal
+                                       completionQueue:nil
+                                            completion:^(UIImage *image) {
+            XCTFail(@"Completion of a cancelled request is called");
+        }]];
+    }
+    // Both requests are cancelled at the same time, the operation must stay closed for new requests.
+    dispatch_apply(requests.count, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t requestIdx) {
+        [requests[requestIdx] cancel];
+    });
+    XCTestExpectation *expectation = [self expectationWithDescription:@"decoded"];
+    [queue decodeImageWithData:data
+                   displaySize:CGSizeZero
+                   scaleFactor:1.0
+                      priority:WIKRequestPriorityNormal
+               completionQueue:nil
+                    completion:^(UIImage *image) {
+        XCTAssertNotNil(image);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+}
+
+@end
@@ -0,0 +1,111 @@
+//
+//  WebpBufferPoolTests.c
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#include <pthread.h>
+#include <string.h>
+
+#include "WebpBufferPool.h"
+#include "WebpTestSupport.h"
+
+static void webpTestCapacity(void) {
+    static const size_t sizes[] = {1, 4096, 4097, 10000, 65536, 65537, 1920 * 1080 * 4, 3 * 1000 * 1000 + 1};
+    for (size_t sizeIdx = 0; sizeIdx < sizeof(sizes) / sizeof(sizes[0]); ++sizeIdx) {
+        const size_t size = sizes[sizeIdx];
+        size_t capacity = 0;
+        uint8_t *buffer = webpBufferPoolAcquire(size, &capacity);
+        WEBP_TEST_EXPECT(buffer);
+        // Four classes per power of two keep the rounding waste below 25%.
+        WEBP_TEST_EXPECT(size <= capacity);
+        WEBP_TEST_EXPECT(4096 >= size || capacity - size < size / 4);
+        if (buffer) {
+            memset(buffer, 0xa5, capacity);
+        }
+        webpBufferPoolRelease(buffer, capacity);
+    }
+    webpBufferPoolPurge();
+}
+
+static void webpTestReuse(void) {
+    webpBufferPoolPurge();
+    size_t capacity;
+    uint8_t *buffer = webpBufferPoolAcquire(100000, &capacity);
+    WEBP_TEST_EXPECT(buffer);
+    webpBufferPoolRelease(buffer, capacity);
+    WEBP_TEST_EXPECT(capacity == webpBufferPoolCachedSize());
+    // A size of the same class gets the cached buffer back.
+    size_t reusedCapacity;
+    uint8_t *reused = webpBufferPoolAcquire(capacity - 100, &reusedCapacity);
+    WEBP_TEST_EXPECT(reused == buffer && reusedCapacity == capacity);
+    WEBP_TEST_EXPECT(0 == webpBufferPoolCachedSize());
+    webpBufferPoolRelease(reused, reusedCapacity);
+    webpBufferPoolPurge();
+    WEBP_TEST_EXPECT(0 == webpBufferPoolCachedSize());
+}
+
+static void webpTestLimit(void) {
+    webpBufferPoolPurge();
+    // Two buffers of the class fit into the limit, the class itself could cache four.
+    webpBufferPoolSetLimit(128 * 1024);
+    uint8_t *buffers[8];
+    size_t capacities[8];
+    for (int index = 0; index < 8; ++index) {
+        buffers[index] = webpBufferPoolAcquire(64 * 1024, &capacities[index]);
+        WEBP_TEST_EXPECT(buffers[index]);
+    }
+    for (int index = 0; index < 8; ++index) {
+        webpBufferPoolRelease(buffers[index], capacities[index]);
+        WEBP_TEST_EXPECT(128 * 1024 >= webpBufferPoolCachedSize());
+    }
+    WEBP_TEST_EXPECT(0 < webpBufferPoolCachedSize());
+    webpBufferPoolSetLimit(0);
+    WEBP_TEST_EXPECT(0 == webpBufferPoolCachedSize());
+    webpBufferPoolSetLimit(32u << 20);
+}
+
+static void *webpTestWorker(void *argument) {
+    const size_t seed = (size_t) argument;
+    for (size_t iteration = 0; iteration < 2000; ++iteration) {
+        size_t capacity;
+        const size_t size = 4096 + ((seed * 7919 + iteration * 104729) % (512 * 1024));
+        uint8_t *buffer = webpBufferPoolAcquire(size, &capacity);
+        if (!buffer) {
+            return (void *) 1;
+        }
+        // Buffers of other threads must never alias this one.
+        memset(buffer, (int) seed, size);
+        for (size_t offset = 0; offset < size; offset += 997) {
+            if ((uint8_t) seed != buffer[offset]) {
+                webpBufferPoolRelease(buffer, capacity);
+                return (void *) 1;
+            }
+        }
+        webpBufferPoolRelease(buffer, capacity);
+    }
+    return NULL;
+}
+
+static void webpTestConcurrency(void) {
+    pthread_t threads[4];
+    for (size_t index = 0; index < 4; ++index) {
+        WEBP_TEST_EXPECT(0 == pthread_create(&threads[index], NULL, webpTestWorker, (void *) (index + 1)));
+    }
+    for (size_t index = 0; index < 4; ++index) {
+        void *result = NULL;
+        pthread_join(threads[index], &result);
+        WEBP_TEST_EXPECT(NULL == result);
+    }
+    webpBufferPoolPurge();
+}
+
+int main(void) {
+    WEBP_TEST_RUN(webpTestCapacity);
+    WEBP_TEST_RUN(webpTestReuse);
+    WEBP_TEST_RUN(webpTestLimit);
+    WEBP_TEST_RUN(webpTestConcurrency);
+    return 0 == webpTestFailures ? 0 : 1;
+}
@@ -0,0 +1,286 @@
+//
+//  WebpCodecTests.c
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "WebpCodec.h"
+#include "WebpTestSupport.h"
+
+#define WEBP_TEST_CANVAS_SIZE 32
+
+static const WebpPixelLayout webpTestLayout = {
+        .bytesPerPixel = 4, .red = 2, .green = 1, .blue = 0, .alpha = 3, .isPremultiplied = 1
+};
+
+// Premultiplied MODE_bgrA pixels, opaque pixels survive a lossless round trip bit exact.
+static void webpTestFillPixels(uint8_t *pixels, size_t width, size_t height, size_t stride, uint8_t alpha, uint32_t seed) {
+    for (size_t row = 0; row < height; ++row) {
+        for (size_t column = 0; column < width; ++column) {
+            uint8_t *pixel = pixels + row * stride + column * 4;
+            seed = seed * 1664525u + 1013904223u;
+            for (int channel = 0; channel < 3; ++channel) {
+                pixel[channel] = (uint8_t) (((seed >> (8 * channel)) & 0xff) * alpha / 255);
+            }
+            pixel[3] = alpha;
+        }
+    }
+}
+
+static int webpTestEncode(const uint8_t *pixels, size_t width, size_t height, int isLossless, WebPMemoryWriter *writer) {
+    WebPConfig config;
+    WebPPicture picture;
+    if (!WebPConfigInit(&config) || !WebPPictureInit(&picture)) {
+        return 0;
+    }
+    if (isLossless) {
+        WebPConfigLosslessPreset(&config, 1);
+    }
+    WebPMemoryWriterInit(writer);
+    const int result = webpCodecPreparePicture(&picture, width, height)
+            && webpCodecImportPixels(&picture, pixels, width * 4, &webpTestLayout)
+            && webpCodecEncode(&config, &picture, WebPMemoryWrite, writer);
+    WebPPictureFree(&picture);
+    return result;
+}
+
+static int webpTestDecode(const WebPMemoryWriter *writer, const WebpCodecRect *crop, size_t targetWidth, size_t targetHeight,
+                          uint8_t *pixels, size_t capacity, size_t *width, size_t *height) {
+    WebPDecoderConfig config;
+    return WebPInitDecoderConfig(&config)
+            && VP8_STATUS_OK == WebPGetFeatures(writer->mem, writer->size, &config.input)
+            && webpCodecSetupDecoder(&config, crop, targetWidth, targetHeight, width, height)
+            && *width * *height * 4 <= capacity
+            && webpCodecDecode(writer->mem, writer->size, &config, MODE_bgrA, *width, *height, pixels, *width * 4);
+}
+
+static void webpTestRoundTrip(void) {
+    const size_t size = WEBP_TEST_CANVAS_SIZE;
+    uint8_t source[WEBP_TEST_CANVAS_SIZE * WEBP_TEST_CANVAS_SIZE * 4];
+    uint8_t decoded[WEBP_TEST_CANVAS_SIZE * WEBP_TEST_CANVAS_SIZE * 4];
+    webpTestFillPixels(source, size, size, size * 4, 255, 1);
+    WebPMemoryWriter writer;
+    WEBP_TEST_EXPECT(webpTestEncode(source, size, size, 1, &writer));
+    size_t width, height;
+    WEBP_TEST_EXPECT(webpTestDecode(&writer, NULL, 0, 0, decoded, sizeof(decoded), &width, &height));
+    WEBP_TEST_EXPECT(size == width && size == height);
+    WEBP_TEST_EXPECT(0 == memcmp(source, decoded, sizeof(source)));
+    WebPMemoryWriterClear(&writer);
+}
+
+static void webpTestCropAndScale(void) {
+    const size_t size = WEBP_TEST_CANVAS_SIZE;
+    uint8_t source[WEBP_TEST_CANVAS_SIZE * WEBP_TEST_CANVAS_SIZE * 4];
+    uint8_t decoded[WEBP_TEST_CANVAS_SIZE * WEBP_TEST_CANVAS_SIZE * 4];
+    webpTestFillPixels(source, size, size, size * 4, 255, 2);
+    WebPMemoryWriter writer;
+    WEBP_TEST_EXPECT(webpTestEncode(source, size, size, 1, &writer));
+    size_t width, height;
+
+    // The crop is clipped to the image and matches the region of the source.
+    const WebpCodecRect crop = { 20, 8, 16, 10 };
+    WEBP_TEST_EXPECT(webpTestDecode(&writer, &crop, 0, 0, decoded, sizeof(decoded), &width, &height));
+    WEBP_TEST_EXPECT(12 == width && 10 == height);
+    for (size_t row = 0; row < height; ++row) {
+        WEBP_TEST_EXPECT(0 == memcmp(decoded + row * width * 4, source + (crop.y + row) * size * 4 + crop.x * 4, width * 4));
+    }
+
+    // A crop outside of the image decodes nothing.
+    const WebpCodecRect outside = { size, 0, 4, 4 };
+    WEBP_TEST_EXPECT(!webpTestDecode(&writer, &outside, 0, 0, decoded, sizeof(decoded), &width, &height));
+
+    // The cropped region is scaled, a solid region stays solid up to the rounding of the rescaler.
+    uint8_t solid[WEBP_TEST_CANVAS_SIZE * WEBP_TEST_CANVAS_SIZE * 4];
+    for (size_t offset = 0; offset < sizeof(solid); offset += 4) {
+        const uint8_t pixel[4] = { 40, 120, 200, 255 };
+        memcpy(solid + offset, pixel, 4);
+    }
+    WebPMemoryWriterClear(&writer);
+    WEBP_TEST_EXPECT(webpTestEncode(solid, size, size, 1, &writer));
+    const WebpCodecRect half = { 0, 0, size / 2, size };
+    WEBP_TEST_EXPECT(webpTestDecode(&writer, &half, 5, 7, decoded, sizeof(decoded), &width, &height));
+    WEBP_TEST_EXPECT(5 == width && 7 == height);
+    for (size_t offset = 0; offset < width * height * 4; offset += 4) {
+        WEBP_TEST_EXPECT(1 >= abs(40 - decoded[offset]) && 1 >= abs(120 - decoded[offset + 1])
+                         && 1 >= abs(200 - decoded[offset + 2]) && 255 == decoded[offset + 3]);
+    }
+    WebPMemoryWriterClear(&writer);
+}
+
+typedef struct {
+    int x;
+    int y;
+    int size;
+    uint8_t alpha;
+    WebPMuxAnimDispose dispose;
+    WebPMuxAnimBlend blend;
+} WebpTestFrame;
+
+// Blended, disposed and covering frames, the frame at index 4 covers the canvas and is a key frame.
+static const WebpTestFrame webpTestFrames[] = {
+        { 0, 0, WEBP_TEST_CANVAS_SIZE, 255, WEBP_MUX_DISPOSE_NONE, WEBP_MUX_NO_BLEND },
+        { 0, 0, 16, 128, WEBP_MUX_DISPOSE_NONE, WEBP_MUX_BLEND },
+        { 16, 16, 16, 96, WEBP_MUX_DISPOSE_BACKGROUND, WEBP_MUX_BLEND },
+        { 8, 8, 16, 255, WEBP_MUX_DISPOSE_NONE, WEBP_MUX_NO_BLEND },
+        { 0, 0, WEBP_TEST_CANVAS_SIZE, 200, WEBP_MUX_DISPOSE_NONE, WEBP_MUX_NO_BLEND },
+        { 4, 4, 8, 64, WEBP_MUX_DISPOSE_BACKGROUND, WEBP_MUX_BLEND },
+        { 12, 2, 10, 160, WEBP_MUX_DISPOSE_NONE, WEBP_MUX_BLEND },
+};
+#define WEBP_TEST_FRAME_COUNT (sizeof(webpTestFrames) / sizeof(webpTestFrames[0]))
+
+static int webpTestCreateAnimation(WebPData *output) {
+    WebPMux *mux = WebPMuxNew();
+    if (!mux) {
+        return 0;
+    }
+    int result = WEBP_MUX_OK == WebPMuxSetCanvasSize(mux, WEBP_TEST_CANVAS_SIZE, WEBP_TEST_CANVAS_SIZE);
+    const WebPMuxAnimParams params = { .bgcolor = 0, .loop_count = 0 };
+    result = result && WEBP_MUX_OK == WebPMuxSetAnimationParams(mux, &params);
+    uint8_t pixels[WEBP_TEST_CANVAS_SIZE * WEBP_TEST_CANVAS_SIZE * 4];
+    for (size_t frameIdx = 0; frameIdx < WEBP_TEST_FRAME_COUNT && result; ++frameIdx) {
+        const WebpTestFrame *frame = &webpTestFrames[frameIdx];
+        webpTestFillPixels(pixels, (size_t) frame->size, (size_t) frame->size, (size_t) frame->size * 4,
+                           frame->alpha, (uint32_t) frameIdx + 10);
+        WebPMemoryWriter writer;
+        result = webpTestEncode(pixels, (size_t) frame->size, (size_t) frame->size, 1, &writer);
+        const WebPMuxFrameInfo info = {
+                .bitstream = { writer.mem, writer.size },
+                .x_offset = frame->x,
+                .y_offset = frame->y,
+                .duration = 40 + (int) frameIdx,
+                .id = WEBP_CHUNK_ANMF,
+                .dispose_method = frame->dispose,
+                .blend_method = frame->blend
+        };
+        result = result && WEBP_MUX_OK == WebPMuxPushFrame(mux, &info, 1);
+        WebPMemoryWriterClear(&writer);
+    }
+    result = result && webpCodecAssemble(mux, output);
+    WebPMuxDelete(mux);
+    return result;
+}
+
+// Checks that rendering any frame directly matches rendering all frames in order.
+static void webpTestRenderFrames(const WebPData *data, uint32_t outputSize) {
+    const size_t stride = (size_t) outputSize * 4;
+    const size_t canvasSize = stride * outputSize;
+    uint8_t *sequential = calloc(WEBP_TEST_FRAME_COUNT, canvasSize);
+    uint8_t *canvas = calloc(1, canvasSize);
+    WebpCodecAnimation *animation = webpCodecAnimationCreate(data->bytes, data->size);
+    WEBP_TEST_EXPECT(sequential && canvas && animation);
+    if (!sequential || !canvas || !animation) {
+        free(sequential);
+        free(canvas);
+        webpCodecAnimationDelete(animation);
+        return;
+    }
+    webpCodecAnimationSetOutputSize(animation, outputSize, outputSize);
+    for (uint32_t frameIdx = 0; frameIdx < WEBP_TEST_FRAME_COUNT; ++frameIdx) {
+        uint32_t duration = 0;
+        WEBP_TEST_EXPECT(webpCodecAnimationRenderFrame(animation, frameIdx, canvas, stride, &duration));
+        WEBP_TEST_EXPECT(40 + frameIdx == duration);
+        memcpy(sequential + frameIdx * canvasSize, canvas, canvasSize);
+    }
+    webpCodecAnimationDelete(animation);
+
+    for (uint32_t frameIdx = 0; frameIdx < WEBP_TEST_FRAME_COUNT; ++frameIdx) {
+        // A new animation starts from the key frame of the requested frame.
+        animation = webpCodecAnimationCreate(data->bytes, data->size);
+        webpCodecAnimationSetOutputSize(animation, outputSize, outputSize);
+        memset(canvas, 0xa5, canvasSize);
+        WEBP_TEST_EXPECT(webpCodecAnimationRenderFrame(animation, frameIdx, canvas, stride, NULL));
+        WEBP_TEST_EXPECT(0 == memcmp(sequential + frameIdx * canvasSize, canvas, canvasSize));
+        webpCodecAnimationDelete(animation);
+    }
+
+    // Seeking backwards and forwards on the same canvas.
+    static const uint32_t order[] = { 6, 2, 5, 3, 0, 6, 1 };
+    animation = webpCodecAnimationCreate(data->bytes, data->size);
+    webpCodecAnimationSetOutputSize(animation, outputSize, outputSize);
+    for (size_t orderIdx = 0; orderIdx < sizeof(order) / sizeof(order[0]); ++orderIdx) {
+        WEBP_TEST_EXPECT(webpCodecAnimationRenderFrame(animation, order[orderIdx], canvas, stride, NULL));
+        WEBP_TEST_EXPECT(0 == memcmp(sequential + order[orderIdx] * canvasSize, canvas, canvasSize));
+    }
+    webpCodecAnimationDelete(animation);
+    free(sequential);
+    free(canvas);
+}
+
+static void webpTestAnimation(void) {
+    WebPData data;
+    WebPDataInit(&data);
+    WEBP_TEST_EXPECT(webpTestCreateAnimation(&data));
+    WebpCodecAnimation *animation = webpCodecAnimationCreate(data.bytes, data.size);
+    WEBP_TEST_EXPECT(animation);
+    if (!animation) {
+        WebPDataClear(&data);
+        return;
+    }
+    WebpCodecAnimationInfo info;
+    webpCodecAnimationGetInfo(animation, &info);
+    WEBP_TEST_EXPECT(info.isAnimated && info.hasAlpha);
+    WEBP_TEST_EXPECT(WEBP_TEST_CANVAS_SIZE == info.canvasWidth && WEBP_TEST_CANVAS_SIZE == info.canvasHeight);
+    WEBP_TEST_EXPECT(WEBP_TEST_FRAME_COUNT == info.frameCount);
+    WEBP_TEST_EXPECT(0 == webpCodecAnimationGetFrame(animation, 3)->keyFrame);
+    WEBP_TEST_EXPECT(4 == webpCodecAnimationGetFrame(animation, 6)->keyFrame);
+    WEBP_TEST_EXPECT(NULL == webpCodecAnimationGetFrame(animation, WEBP_TEST_FRAME_COUNT));
+    webpCodecAnimationDelete(animation);
+
+    webpTestRenderFrames(&data, WEBP_TEST_CANVAS_SIZE);
+    // Frames decoded right at a smaller output size.
+    webpTestRenderFrames(&data, 20);
+    WebPDataClear(&data);
+}
+
+static void webpTestYuvDecode(void) {
+    const size_t size = WEBP_TEST_CANVAS_SIZE;
+    uint8_t source[WEBP_TEST_CANVAS_SIZE * WEBP_TEST_CANVAS_SIZE * 4];
+    webpTestFillPixels(source, size, size, size * 4, 255, 3);
+    WebPMemoryWriter writer;
+    WEBP_TEST_EXPECT(webpTestEncode(source, size, size, 0, &writer));
+
+    // The planes match the YUV decode of libwebp itself.
+    int width, height, stride, uvStride;
+    uint8_t *u, *v;
+    uint8_t *y = WebPDecodeYUV(writer.mem, writer.size, &width, &height, &u, &v, &stride, &uvStride);
+    WEBP_TEST_EXPECT(y && (int) size == width && (int) size == height);
+
+    uint8_t planeY[WEBP_TEST_CANVAS_SIZE * WEBP_TEST_CANVAS_SIZE];
+    uint8_t planeU[WEBP_TEST_CANVAS_SIZE * WEBP_TEST_CANVAS_SIZE / 4];
+    uint8_t planeV[WEBP_TEST_CANVAS_SIZE * WEBP_TEST_CANVAS_SIZE / 4];
+    const WebPYUVABuffer buffer = {
+            .y = planeY, .u = planeU, .v = planeV, .a = NULL,
+            .y_stride = (int) size, .u_stride = (int) size / 2, .v_stride = (int) size / 2,
+            .y_size = sizeof(planeY), .u_size = sizeof(planeU), .v_size = sizeof(planeV)
+    };
+    WebPDecoderConfig config;
+    size_t decodedWidth, decodedHeight;
+    WEBP_TEST_EXPECT(WebPInitDecoderConfig(&config)
+                     && VP8_STATUS_OK == WebPGetFeatures(writer.mem, writer.size, &config.input)
+                     && webpCodecSetupDecoder(&config, NULL, 0, 0, &decodedWidth, &decodedHeight)
+                     && webpCodecDecodeYuv(writer.mem, writer.size, &config, &buffer));
+    if (y) {
+        for (size_t row = 0; row < size; ++row) {
+            WEBP_TEST_EXPECT(0 == memcmp(planeY + row * size, y + row * (size_t) stride, size));
+        }
+        for (size_t row = 0; row < size / 2; ++row) {
+            WEBP_TEST_EXPECT(0 == memcmp(planeU + row * size / 2, u + row * (size_t) uvStride, size / 2));
+            WEBP_TEST_EXPECT(0 == memcmp(planeV + row * size / 2, v + row * (size_t) uvStride, size / 2));
+        }
+    }
+    WebPFree(y);
+    WebPMemoryWriterClear(&writer);
+}
+
+int main(void) {
+    WEBP_TEST_RUN(webpTestRoundTrip);
+    WEBP_TEST_RUN(webpTestCropAndScale);
+    WEBP_TEST_RUN(webpTestAnimation);
+    WEBP_TEST_RUN(webpTestYuvDecode);
+    return 0 == webpTestFailures ? 0 : 1;
+}
@@ -0,0 +1,115 @@
+//
+//  WebpCompositorTests.c
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "WebpCompositor.h"
+#include "WebpTestSupport.h"
+
+// Premultiplied pixels with all alpha values, including fully transparent and opaque ones.
+static void webpTestFillPixels(uint8_t *pixels, size_t size, uint32_t seed) {
+    for (size_t offset = 0; offset + 4 <= size; offset += 4) {
+        seed = seed * 1664525u + 1013904223u;
+        const uint8_t alpha = (uint8_t) (seed >> 24);
+        pixels[offset + 3] = alpha;
+        for (int channel = 0; channel < 3; ++channel) {
+            seed = seed * 1664525u + 1013904223u;
+            pixels[offset + channel] = (uint8_t) ((seed >> 24) % ((uint32_t) alpha + 1));
+        }
+    }
+}
+
+static void webpTestBlendMatchesScalar(void) {
+    // Odd widths leave tails after the vector loops, the source stride is unaligned.
+    static const size_t widths[] = {1, 2, 3, 4, 5, 7, 8, 15, 16, 17, 33, 100};
+    const size_t height = 5;
+    for (size_t widthIdx = 0; widthIdx < sizeof(widths) / sizeof(widths[0]); ++widthIdx) {
+        const size_t width = widths[widthIdx];
+        const size_t dstStride = width * 4 + 12;
+        const size_t srcStride = width * 4 + 4;
+        uint8_t *src = malloc(srcStride * height);
+        uint8_t *dst = malloc(dstStride * height);
+        uint8_t *expected = malloc(dstStride * height);
+        WEBP_TEST_EXPECT(src && dst && expected);
+        if (src && dst && expected) {
+            webpTestFillPixels(src, srcStride * height, (uint32_t) width);
+            webpTestFillPixels(dst, dstStride * height, (uint32_t) width * 31u);
+            memcpy(expected, dst, dstStride * height);
+            webpCompositorBlendRect(dst, dstStride, src, srcStride, width, height);
+            webpCompositorBlendRectScalar(expected, dstStride, src, srcStride, width, height);
+            WEBP_TEST_EXPECT(0 == memcmp(dst, expected, dstStride * height));
+        }
+        free(src);
+        free(dst);
+        free(expected);
+    }
+}
+
+static void webpTestBlendEdgeValues(void) {
+    // Opaque source replaces the destination, transparent source leaves it untouched.
+    uint8_t src[8] = {10, 20, 30, 255, 0, 0, 0, 0};
+    uint8_t dst[8] = {200, 100, 50, 255, 40, 50, 60, 128};
+    webpCompositorBlendRect(dst, sizeof(dst), src, sizeof(src), 2, 1);
+    static const uint8_t expected[8] = {10, 20, 30, 255, 40, 50, 60, 128};
+    WEBP_TEST_EXPECT(0 == memcmp(dst, expected, sizeof(dst)));
+}
+
+static void webpTestClearAndCopy(void) {
+    uint8_t canvas[4 * 4 * 4];
+    memset(canvas, 0xff, sizeof(canvas));
+    webpCompositorClearRect(canvas, 16, 1, 1, 2, 2);
+    for (size_t y = 0; y < 4; ++y) {
+        for (size_t x = 0; x < 4; ++x) {
+            const int isCleared = 1 <= x && x < 3 && 1 <= y && y < 3;
+            WEBP_TEST_EXPECT((isCleared ? 0x00 : 0xff) == canvas[y * 16 + x * 4]);
+        }
+    }
+    uint8_t src[2 * 4] = {1, 2, 3, 4, 5, 6, 7, 8};
+    webpCompositorCopyRect(canvas + 16 + 4, 16, src, 8, 2, 1);
+    WEBP_TEST_EXPECT(0 == memcmp(canvas + 16 + 4, src, sizeof(src)));
+    WEBP_TEST_EXPECT(0 == canvas[2 * 16 + 4]);
+}
+
+static WebpCompositorFrame webpTestFrame(int x, int y, int width, int height,
+                                         int disposeToBackground, int blend, int hasAlpha) {
+    return (WebpCompositorFrame) {
+            .x = x, .y = y, .width = width, .height = height, .duration = 100,
+            .disposeToBackground = disposeToBackground, .blend = blend, .hasAlpha = hasAlpha
+    };
+}
+
+static void webpTestKeyFrames(void) {
+    WebpCompositorFrame frames[] = {
+            webpTestFrame(0, 0, 10, 10, 0, 1, 1),   // first frame is always a key frame
+            webpTestFrame(2, 2, 4, 4, 0, 1, 1),     // partial frame depends on the canvas
+            webpTestFrame(0, 0, 10, 10, 0, 1, 0),   // opaque full frame replaces the canvas
+            webpTestFrame(0, 0, 10, 10, 1, 1, 1),   // blended full frame depends on the canvas
+            webpTestFrame(2, 2, 4, 4, 1, 1, 1),     // canvas cleared by the full previous frame
+            webpTestFrame(3, 3, 4, 4, 0, 1, 1),     // previous key frame cleared its own rectangle
+            webpTestFrame(0, 0, 10, 10, 1, 0, 1),   // full frame without blending
+            webpTestFrame(1, 1, 4, 4, 0, 1, 1),     // previous frame cleared the whole canvas
+            webpTestFrame(1, 1, 4, 4, 1, 1, 1),     // previous partial frame isn't disposed
+            webpTestFrame(1, 1, 4, 4, 0, 1, 1),     // previous frame is partial and not a key frame
+    };
+    static const uint32_t expected[] = {0, 0, 2, 2, 4, 5, 6, 7, 7, 7};
+    const size_t count = sizeof(frames) / sizeof(frames[0]);
+    webpCompositorFindKeyFrames(frames, count, 10, 10);
+    for (size_t index = 0; index < count; ++index) {
+        WEBP_TEST_EXPECT(expected[index] == frames[index].keyFrame);
+    }
+}
+
+int main(void) {
+    printf("blend kernel: %s\n", webpCompositorKernelName());
+    WEBP_TEST_RUN(webpTestBlendMatchesScalar);
+    WEBP_TEST_RUN(webpTestBlendEdgeValues);
+    WEBP_TEST_RUN(webpTestClearAndCopy);
+    WEBP_TEST_RUN(webpTestKeyFrames);
+    return 0 == webpTestFailures ? 0 : 1;
+}
@@ -0,0 +1,176 @@
+//
+//  WebpContainerTests.c
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#include <string.h>
+
+#include "WebpContainer.h"
+#include "WebpTestSupport.h"
+
+typedef struct {
+    uint8_t bytes[512];
+    size_t size;
+} WebpTestFile;
+
+static void webpTestPutLE(uint8_t *bytes, uint32_t value, int count) {
+    for (int index = 0; index < count; ++index) {
+        bytes[index] = (uint8_t) (value >> (8 * index));
+    }
+}
+
+static void webpTestBegin(WebpTestFile *file) {
+    memcpy(file->bytes, "RIFF\0\0\0\0WEBP", 12);
+    file->size = 12;
+}
+
+static uint8_t *webpTestAddChunk(WebpTestFile *file, const char fourcc[4], const uint8_t *payload, uint32_t size) {
+    uint8_t *chunk = file->bytes + file->size;
+    memcpy(chunk, fourcc, 4);
+    webpTestPutLE(chunk + 4, size, 4);
+    if (payload) {
+        memcpy(chunk + 8, payload, size);
+    }
+    else {
+        memset(chunk + 8, 0, size);
+    }
+    file->size += 8 + size + (size & 1);
+    return chunk + 8;
+}
+
+static void webpTestEnd(WebpTestFile *file) {
+    webpTestPutLE(file->bytes + 4, (uint32_t) file->size - 8, 4);
+}
+
+// VP8L header of the given size: signature, 14 bit width - 1, 14 bit height - 1, alpha hint.
+static void webpTestLosslessHeader(uint8_t *payload, uint32_t width, uint32_t height, int hasAlpha) {
+    payload[0] = 0x2f;
+    webpTestPutLE(payload + 1, (width - 1) | ((height - 1) << 14) | ((uint32_t) (hasAlpha ? 1 : 0) << 28), 4);
+}
+
+// VP8 key frame header: frame tag, start code, 14 bit width and height.
+static void webpTestLossyHeader(uint8_t *payload, uint32_t width, uint32_t height) {
+    static const uint8_t startCode[3] = {0x9d, 0x01, 0x2a};
+    memcpy(payload + 3, startCode, sizeof(startCode));
+    webpTestPutLE(payload + 6, width, 2);
+    webpTestPutLE(payload + 8, height, 2);
+}
+
+static void webpTestSimpleLossless(void) {
+    WebpTestFile file;
+    webpTestBegin(&file);
+    uint8_t *payload = webpTestAddChunk(&file, "VP8L", NULL, 16);
+    webpTestLosslessHeader(payload, 300, 200, 1);
+    webpTestEnd(&file);
+    WebpContainerInfo info;
+    WEBP_TEST_EXPECT(webpContainerHasSignature(file.bytes, file.size));
+    WEBP_TEST_EXPECT(webpContainerParse(file.bytes, file.size, &info));
+    WEBP_TEST_EXPECT(300 == info.canvasWidth && 200 == info.canvasHeight);
+    WEBP_TEST_EXPECT(info.hasAlpha && !info.isAnimated && 1 == info.frameCount);
+    WEBP_TEST_EXPECT(WebpContainerFormatLossless == info.format);
+}
+
+static void webpTestSimpleLossy(void) {
+    WebpTestFile file;
+    webpTestBegin(&file);
+    uint8_t *payload = webpTestAddChunk(&file, "VP8 ", NULL, 20);
+    webpTestLossyHeader(payload, 640, 480);
+    webpTestEnd(&file);
+    WebpContainerInfo info;
+    WEBP_TEST_EXPECT(webpContainerParse(file.bytes, file.size, &info));
+    WEBP_TEST_EXPECT(640 == info.canvasWidth && 480 == info.canvasHeight);
+    WEBP_TEST_EXPECT(!info.hasAlpha && WebpContainerFormatLossy == info.format);
+}
+
+static void webpTestAddFrame(WebpTestFile *file, uint32_t duration, int isLossless) {
+    uint8_t payload[16 + 8 + 20];
+    memset(payload, 0, sizeof(payload));
+    webpTestPutLE(payload + 6, 9, 3);           // width - 1
+    webpTestPutLE(payload + 9, 9, 3);           // height - 1
+    webpTestPutLE(payload + 12, duration, 3);
+    memcpy(payload + 16, isLossless ? "VP8L" : "VP8 ", 4);
+    webpTestPutLE(payload + 20, 20, 4);
+    if (isLossless) {
+        webpTestLosslessHeader(payload + 24, 10, 10, 0);
+    }
+    else {
+        webpTestLossyHeader(payload + 24, 10, 10);
+    }
+    webpTestAddChunk(file, "ANMF", payload, sizeof(payload));
+}
+
+static void webpTestAnimation(void) {
+    WebpTestFile file;
+    webpTestBegin(&file);
+    uint8_t *header = webpTestAddChunk(&file, "VP8X", NULL, 10);
+    header[0] = 0x10 | 0x02 | 0x08;             // alpha, animation, EXIF
+    webpTestPutLE(header + 4, 9, 3);
+    webpTestPutLE(header + 7, 19, 3);
+    uint8_t animation[6] = {0};
+    webpTestPutLE(animation + 4, 3, 2);
+    webpTestAddChunk(&file, "ANIM", animation, sizeof(animation));
+    webpTestAddFrame(&file, 40, 1);
+    webpTestAddFrame(&file, 60, 1);
+    webpTestAddChunk(&file, "EXIF", NULL, 3);
+    webpTestEnd(&file);
+
+    WebpContainerInfo info;
+    WEBP_TEST_EXPECT(webpContainerParse(file.bytes, file.size, &info));
+    WEBP_TEST_EXPECT(10 == info.canvasWidth && 20 == info.canvasHeight);
+    WEBP_TEST_EXPECT(info.isAnimated && info.hasAlpha);
+    WEBP_TEST_EXPECT(2 == info.frameCount && 3 == info.loopCount && 100 == info.duration);
+    WEBP_TEST_EXPECT(WebpContainerFormatLossless == info.format);
+    WEBP_TEST_EXPECT(info.hasEXIF && !info.hasICC && !info.hasXMP);
+
+    // Frames of both formats make the animation format undefined.
+    webpTestAddFrame(&file, 10, 0);
+    webpTestEnd(&file);
+    WEBP_TEST_EXPECT(webpContainerParse(file.bytes, file.size, &info));
+    WEBP_TEST_EXPECT(3 == info.frameCount && WebpContainerFormatUndefined == info.format);
+}
+
+static void webpTestTruncated(void) {
+    WebpTestFile file;
+    webpTestBegin(&file);
+    uint8_t *header = webpTestAddChunk(&file, "VP8X", NULL, 10);
+    header[0] = 0x02;
+    webpTestPutLE(header + 4, 99, 3);
+    webpTestPutLE(header + 7, 49, 3);
+    webpTestAddChunk(&file, "ANIM", NULL, 6);
+    webpTestAddFrame(&file, 50, 0);
+    webpTestAddFrame(&file, 50, 0);
+    webpTestEnd(&file);
+    // The canvas is known from the extended header, the frames are counted as far as the data goes.
+    WebpContainerInfo info;
+    for (size_t size = 12 + 8 + 10; size < file.size; ++size) {
+        WEBP_TEST_EXPECT(webpContainerParse(file.bytes, size, &info));
+        WEBP_TEST_EXPECT(100 == info.canvasWidth && 50 == info.canvasHeight);
+        WEBP_TEST_EXPECT(info.frameCount <= 2);
+    }
+    WEBP_TEST_EXPECT(!webpContainerParse(file.bytes, 12 + 8 + 5, &info));
+}
+
+static void webpTestInvalid(void) {
+    static const uint8_t png[16] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    WebpContainerInfo info;
+    WEBP_TEST_EXPECT(!webpContainerHasSignature(png, sizeof(png)));
+    WEBP_TEST_EXPECT(!webpContainerParse(png, sizeof(png), &info));
+    WEBP_TEST_EXPECT(!webpContainerParse(NULL, 0, &info));
+    WebpTestFile file;
+    webpTestBegin(&file);
+    webpTestEnd(&file);
+    WEBP_TEST_EXPECT(webpContainerHasSignature(file.bytes, file.size));
+    WEBP_TEST_EXPECT(!webpContainerParse(file.bytes, file.size, &info));
+}
+
+int main(void) {
+    WEBP_TEST_RUN(webpTestSimpleLossless);
+    WEBP_TEST_RUN(webpTestSimpleLossy);
+    WEBP_TEST_RUN(webpTestAnimation);
+    WEBP_TEST_RUN(webpTestTruncated);
+    WEBP_TEST_RUN(webpTestInvalid);
+    return 0 == webpTestFailures ? 0 : 1;
+}
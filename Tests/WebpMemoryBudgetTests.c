@@ -0,0 +1,128 @@
+//
+//  WebpMemoryBudgetTests.c
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "WebpMemoryBudget.h"
+#include "WebpTestSupport.h"
+
+#define WEBP_TEST_LIMIT 1000
+
+static double webpTestNow(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void webpTestSleep(double seconds) {
+    const struct timespec duration = { (time_t) seconds, (long) ((seconds - (time_t) seconds) * 1e9) };
+    nanosleep(&duration, NULL);
+}
+
+static void webpTestSetUp(WebpMemoryPolicy policy, double timeout) {
+    webpMemoryBudgetSetLimit(WEBP_TEST_LIMIT);
+    webpMemoryBudgetSetPolicy(policy);
+    webpMemoryBudgetSetWaitTimeout(timeout);
+    webpMemoryBudgetResetStats();
+}
+
+static size_t webpTestUsed(void) {
+    WebpMemoryBudgetStats stats;
+    webpMemoryBudgetGetStats(&stats);
+    return stats.used;
+}
+
+static void webpTestGrant(void) {
+    webpTestSetUp(WebpMemoryPolicyWait, 1.0);
+    WEBP_TEST_EXPECT(400 == webpMemoryBudgetReserve(400, 400));
+    WEBP_TEST_EXPECT(600 == webpMemoryBudgetReserve(600, 100));
+    WEBP_TEST_EXPECT(WEBP_TEST_LIMIT == webpTestUsed());
+    webpMemoryBudgetRelease(1000);
+    WEBP_TEST_EXPECT(0 == webpTestUsed());
+    // A request larger than the whole budget is granted when nothing else is reserved.
+    WEBP_TEST_EXPECT(5000 == webpMemoryBudgetReserve(5000, 5000));
+    webpMemoryBudgetRelease(5000);
+    // Without a limit everything fits.
+    webpMemoryBudgetSetLimit(0);
+    webpMemoryBudgetCharge(300);
+    WEBP_TEST_EXPECT(5000 == webpMemoryBudgetReserve(5000, 5000));
+    webpMemoryBudgetRelease(5300);
+    WebpMemoryBudgetStats stats;
+    webpMemoryBudgetGetStats(&stats);
+    WEBP_TEST_EXPECT(0 == stats.used && 5300 == stats.peak);
+    WEBP_TEST_EXPECT(0 == stats.downscaledCount && 0 == stats.waitCount && 0 == stats.failedCount);
+}
+
+static void webpTestPartialGrant(void) {
+    webpTestSetUp(WebpMemoryPolicyDownscale, 0.05);
+    webpMemoryBudgetCharge(700);
+    // What is left is granted if it covers the minimum size.
+    WEBP_TEST_EXPECT(300 == webpMemoryBudgetReserve(500, 200));
+    WEBP_TEST_EXPECT(WEBP_TEST_LIMIT == webpTestUsed());
+    // Nothing is left, the request waits for the minimum size and times out.
+    WEBP_TEST_EXPECT(0 == webpMemoryBudgetReserve(500, 200));
+    WebpMemoryBudgetStats stats;
+    webpMemoryBudgetGetStats(&stats);
+    WEBP_TEST_EXPECT(1 == stats.downscaledCount && 1 == stats.waitCount && 1 == stats.failedCount);
+    webpMemoryBudgetRelease(1000);
+}
+
+static void *webpTestReleaseLater(void *context) {
+    webpTestSleep(0.05);
+    webpMemoryBudgetRelease((size_t) (uintptr_t) context);
+    return NULL;
+}
+
+static void webpTestWait(void) {
+    webpTestSetUp(WebpMemoryPolicyWait, 0.1);
+    webpMemoryBudgetCharge(800);
+    // The request waits for the whole size and fails after the timeout.
+    double start = webpTestNow();
+    WEBP_TEST_EXPECT(0 == webpMemoryBudgetReserve(500, 100));
+    WEBP_TEST_EXPECT(0.09 <= webpTestNow() - start);
+    WEBP_TEST_EXPECT(800 == webpTestUsed());
+
+    // A release wakes the waiting request up before the timeout.
+    webpMemoryBudgetSetWaitTimeout(5.0);
+    pthread_t thread;
+    WEBP_TEST_EXPECT(0 == pthread_create(&thread, NULL, webpTestReleaseLater, (void *) (uintptr_t) 800));
+    start = webpTestNow();
+    WEBP_TEST_EXPECT(500 == webpMemoryBudgetReserve(500, 100));
+    WEBP_TEST_EXPECT(2.0 > webpTestNow() - start);
+    pthread_join(thread, NULL);
+    WEBP_TEST_EXPECT(500 == webpTestUsed());
+    webpMemoryBudgetRelease(500);
+
+    WebpMemoryBudgetStats stats;
+    webpMemoryBudgetGetStats(&stats);
+    WEBP_TEST_EXPECT(2 == stats.waitCount && 1 == stats.failedCount && 0 == stats.downscaledCount);
+}
+
+static void webpTestFail(void) {
+    webpTestSetUp(WebpMemoryPolicyFail, 5.0);
+    webpMemoryBudgetCharge(800);
+    // The request fails right away instead of waiting.
+    const double start = webpTestNow();
+    WEBP_TEST_EXPECT(0 == webpMemoryBudgetReserve(500, 100));
+    WEBP_TEST_EXPECT(1.0 > webpTestNow() - start);
+    WEBP_TEST_EXPECT(200 == webpMemoryBudgetReserve(200, 200));
+    webpMemoryBudgetRelease(1000);
+    WebpMemoryBudgetStats stats;
+    webpMemoryBudgetGetStats(&stats);
+    WEBP_TEST_EXPECT(0 == stats.waitCount && 1 == stats.failedCount && 0 == stats.used);
+}
+
+int main(void) {
+    WEBP_TEST_RUN(webpTestGrant);
+    WEBP_TEST_RUN(webpTestPartialGrant);
+    WEBP_TEST_RUN(webpTestWait);
+    WEBP_TEST_RUN(webpTestFail);
+    return 0 == webpTestFailures ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+//
+//  WebpMetricsTests.c
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#include <pthread.h>
+#include <string.h>
+
+#include "WebpMetrics.h"
+#include "WebpTestSupport.h"
+
+static pthread_mutex_t webpTestLock = PTHREAD_MUTEX_INITIALIZER;
+static int webpTestReportCount = 0;
+static WebpMetricsReport webpTestLastReport;
+
+static void webpTestHandler(const WebpMetricsReport *report, void *context) {
+    (void) context;
+    pthread_mutex_lock(&webpTestLock);
+    ++webpTestReportCount;
+    webpTestLastReport = *report;
+    pthread_mutex_unlock(&webpTestLock);
+}
+
+static void webpTestReset(void) {
+    pthread_mutex_lock(&webpTestLock);
+    webpTestReportCount = 0;
+    memset(&webpTestLastReport, 0, sizeof(webpTestLastReport));
+    pthread_mutex_unlock(&webpTestLock);
+}
+
+static void webpTestNestedOperations(void) {
+    webpTestReset();
+    webpMetricsSetHandler(webpTestHandler, NULL);
+    webpMetricsOperationBegin(WebpMetricsOperationDecode);
+    webpMetricsStageEnd(WebpMetricsStageDemux, webpMetricsStageBegin(), 10);
+    webpMetricsOperationBegin(WebpMetricsOperationEncode);
+    webpMetricsStageEnd(WebpMetricsStageDecode, webpMetricsStageBegin(), 20);
+    webpMetricsMemoryAcquired(1000);
+    webpMetricsMemoryReleased(1000);
+    webpMetricsOperationEnd();
+    WEBP_TEST_EXPECT(0 == webpTestReportCount);
+    webpMetricsOperationEnd();
+    WEBP_TEST_EXPECT(1 == webpTestReportCount);
+    WEBP_TEST_EXPECT(WebpMetricsOperationDecode == webpTestLastReport.operation);
+    WEBP_TEST_EXPECT(10 == webpTestLastReport.stageBytes[WebpMetricsStageDemux]);
+    WEBP_TEST_EXPECT(20 == webpTestLastReport.stageBytes[WebpMetricsStageDecode]);
+    WEBP_TEST_EXPECT(1000 == webpTestLastReport.peakMemory);
+    webpMetricsSetHandler(NULL, NULL);
+}
+
+static void *webpTestWorker(void *argument) {
+    webpMetricsOperationAttach(argument);
+    const uint64_t start = webpMetricsStageBegin();
+    webpMetricsMemoryAcquired(500);
+    webpMetricsMemoryReleased(500);
+    webpMetricsStageEnd(WebpMetricsStageDecode, start, 100);
+    webpMetricsOperationDetach();
+    return NULL;
+}
+
+static void webpTestSharedOperation(void) {
+    webpTestReset();
+    webpMetricsSetHandler(webpTestHandler, NULL);
+    webpMetricsOperationBegin(WebpMetricsOperationDecode);
+    WebpMetricsShared *shared = webpMetricsOperationShare();
+    WEBP_TEST_EXPECT(shared);
+    pthread_t threads[4];
+    for (int index = 0; index < 4; ++index) {
+        pthread_create(&threads[index], NULL, webpTestWorker, shared);
+    }
+    for (int index = 0; index < 4; ++index) {
+        pthread_join(threads[index], NULL);
+    }
+    webpMetricsSharedRelease(shared);
+    // Stages of the workers are part of the operation instead of separate reports.
+    WEBP_TEST_EXPECT(0 == webpTestReportCount);
+    webpMetricsOperationEnd();
+    WEBP_TEST_EXPECT(1 == webpTestReportCount);
+    WEBP_TEST_EXPECT(400 == webpTestLastReport.stageBytes[WebpMetricsStageDecode]);
+    WEBP_TEST_EXPECT(500 <= webpTestLastReport.peakMemory);
+    webpMetricsSetHandler(NULL, NULL);
+}
+
+static void webpTestStandaloneStages(void) {
+    webpTestReset();
+    webpMetricsSetHandler(webpTestHandler, NULL);
+    WEBP_TEST_EXPECT(NULL == webpMetricsOperationShare());
+    webpTestWorker(NULL);
+    WEBP_TEST_EXPECT(1 == webpTestReportCount);
+    WEBP_TEST_EXPECT(WebpMetricsOperationNone == webpTestLastReport.operation);
+    webpMetricsSetHandler(NULL, NULL);
+    webpTestWorker(NULL);
+    WEBP_TEST_EXPECT(1 == webpTestReportCount);
+}
+
+int main(void) {
+    WEBP_TEST_RUN(webpTestNestedOperations);
+    WEBP_TEST_RUN(webpTestSharedOperation);
+    WEBP_TEST_RUN(webpTestStandaloneStages);
+    return 0 == webpTestFailures ? 0 : 1;
+}
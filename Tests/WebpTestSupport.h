@@ -0,0 +1,36 @@
+//
+//  WebpTestSupport.h
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#ifndef WebpTestSupport_h
+#define WebpTestSupport_h
+
+#include <stdio.h>
+
+/**
+ * Minimal checks for the tests of the core, every test file is an executable which returns
+ * non-zero if any check failed.
+ */
+
+static int webpTestFailures = 0;
+
+#define WEBP_TEST_EXPECT(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: expected %s\n", __FILE__, __LINE__, #condition); \
+            ++webpTestFailures; \
+        } \
+    } while (0)
+
+#define WEBP_TEST_RUN(test) \
+    do { \
+        const int failures = webpTestFailures; \
+        test(); \
+        printf("%s %s\n", failures == webpTestFailures ? "PASS" : "FAIL", #test); \
+    } while (0)
+
+#endif /* WebpTestSupport_h */
@@ -0,0 +1,106 @@
+//
+//  CFData+WebP.h
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+CF_EXTERN_C_BEGIN
+
+/*
+ * Functions below edit chunks and frames of the WebP container, the compressed image data is
+ * copied as is. Nothing is decoded or encoded, so the time depends on the file size rather than
+ * on the number of pixels, and the image quality doesn't change.
+ */
+
+typedef NS_OPTIONS(NSUInteger, WebpMetadata) {
+    WebpMetadataICCProfile = 1 << 0,
+    WebpMetadataEXIF = 1 << 1,
+    WebpMetadataXMP = 1 << 2,
+    WebpMetadataAll = WebpMetadataICCProfile | WebpMetadataEXIF | WebpMetadataXMP
+};
+
+/**
+ * Returns a copy of the animation with the new loop count. Non-animated images are returned unchanged.
+ *
+ * @param dataRef
+ *        Image data in WebP format.
+ * @param loopCount
+ *        Number of times to repeat the animation, 0 means infinite.
+ * @return
+ *        An image data, or NULL if an error occurs. You are responsible for releasing this object using CFRelease.
+ */
+CFDataRef __nullable WebpDataCreateWithLoopCount(CFDataRef __nonnull dataRef, UInt32 loopCount) CF_RETURNS_RETAINED;
+
+/**
+ * Returns a copy of the image without the metadata chunks.
+ *
+ * @param dataRef
+ *        Image data in WebP format.
+ * @param metadata
+ *        Kinds of metadata to remove.
+ * @return
+ *        An image data, or NULL if an error occurs. You are responsible for releasing this object using CFRelease.
+ */
+CFDataRef __nullable WebpDataCreateWithoutMetadata(CFDataRef __nonnull dataRef, WebpMetadata metadata) CF_RETURNS_RETAINED;
+
+/**
+ * Returns a copy of the image with the metadata chunk replaced.
+ *
+ * @param dataRef
+ *        Image data in WebP format.
+ * @param metadata
+ *        Kind of the metadata, a single value.
+ * @param payload
+ *        Chunk content: an ICC profile, EXIF or XMP data. For NULL - the chunk is removed.
+ * @return
+ *        An image data, or NULL if an error occurs. You are responsible for releasing this object using CFRelease.
+ */
+CFDataRef __nullable WebpDataCreateWithMetadata(CFDataRef __nonnull dataRef,
+                                                WebpMetadata metadata,
+                                                CFDataRef __nullable payload) CF_RETURNS_RETAINED;
+
+/**
+ * Returns the content of the metadata chunk.
+ *
+ * @param dataRef
+ *        Image data in WebP format.
+ * @param metadata
+ *        Kind of the metadata, a single value.
+ * @return
+ *        Chunk content, or NULL if the image has no such chunk. You are responsible for releasing this object using CFRelease.
+ */
+CFDataRef __nullable WebpDataCopyMetadata(CFDataRef __nonnull dataRef, WebpMetadata metadata) CF_RETURNS_RETAINED;
+
+/**
+ * Returns the animation frame as a still image with the metadata of the animation.
+ * Only frames which cover the canvas and don't depend on the previous frames can be
+ * extracted without decoding, use `WIKAnimatedImage` for the others.
+ *
+ * @param dataRef
+ *        Image data in WebP format.
+ * @param frameIndex
+ *        Zero-based index of the frame.
+ * @return
+ *        An image data, or NULL if an error occurs or the frame depends on the previous ones.
+ *        You are responsible for releasing this object using CFRelease.
+ */
+CFDataRef __nullable WebpDataCreateWithFrame(CFDataRef __nonnull dataRef, UInt32 frameIndex) CF_RETURNS_RETAINED;
+
+/**
+ * Returns an animation with the range of frames. Canvas, loop count and metadata are kept.
+ *
+ * @param dataRef
+ *        Image data in WebP format.
+ * @param range
+ *        Range of frames, it is clipped to the frame count.
+ * @return
+ *        An image data, or NULL if an error occurs, the range is empty or its first frame
+ *        depends on the frames before the range. You are responsible for releasing this object using CFRelease.
+ */
+CFDataRef __nullable WebpDataCreateWithFrameRange(CFDataRef __nonnull dataRef, CFRange range) CF_RETURNS_RETAINED;
+
+CF_EXTERN_C_END
@@ -0,0 +1,319 @@
+//
+//  CFData+WebP.m
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#import <libwebp/decode.h>
+#import <libwebp/mux.h>
+
+#import "CFData+WebP.h"
+#import "WebpCodec.h"
+#import "WebpMetrics.h"
+#import "WebpImageKitMacro.h"
+
+static const char *webpMetadataChunkId(WebpMetadata metadata) {
+    switch (metadata) {
+        case WebpMetadataICCProfile:
+            return "ICCP";
+        case WebpMetadataEXIF:
+            return "EXIF";
+        case WebpMetadataXMP:
+            return "XMP ";
+        default:
+            return NULL;
+    }
+}
+
+// The mux references the bytes of the data object, which must outlive it.
+static WebPMux *webpMuxCreateWithData(CFDataRef dataRef) {
+    if (!dataRef) {
+        return NULL;
+    }
+    WebPData webpData = { .bytes = CFDataGetBytePtr(dataRef), .size = (size_t) CFDataGetLength(dataRef) };
+    return WebPMuxCreate(&webpData, 0);
+}
+
+static CFDataRef webpMuxCreateData(WebPMux *mux) CF_RETURNS_RETAINED {
+    WebPData outputData;
+    if (!webpCodecAssemble(mux, &outputData)) {
+        return NULL;
+    }
+    CFDataRef dataRef = CFDataCreate(kCFAllocatorDefault, outputData.bytes, (CFIndex) outputData.size);
+    WebPDataClear(&outputData);
+    return dataRef;
+}
+
+static BOOL webpMuxIsAnimated(const WebPMux *mux) {
+    uint32_t flags = 0;
+    return WEBP_MUX_OK == WebPMuxGetFeatures(mux, &flags) && 0 != (flags & ANIMATION_FLAG);
+}
+
+static BOOL webpMuxCopyMetadata(const WebPMux *source, WebPMux *destination) {
+    const WebpMetadata kinds[] = { WebpMetadataICCProfile, WebpMetadataEXIF, WebpMetadataXMP };
+    for (size_t kindIdx = 0; kindIdx < sizeof(kinds) / sizeof(kinds[0]); ++kindIdx) {
+        const char *chunkId = webpMetadataChunkId(kinds[kindIdx]);
+        WebPData chunk;
+        if (WEBP_MUX_OK == WebPMuxGetChunk(source, chunkId, &chunk)
+                && WEBP_MUX_OK != WebPMuxSetChunk(destination, chunkId, &chunk, 0)) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+// The frame bitstream is a still image in WebP format owned by the caller.
+static BOOL webpMuxGetFrame(const WebPMux *mux, uint32_t frameIndex,
+                            WebPMuxFrameInfo *frame, WebPBitstreamFeatures *features) {
+    if (WEBP_MUX_OK != WebPMuxGetFrame(mux, frameIndex + 1, frame)) {
+        return NO;
+    }
+    if (VP8_STATUS_OK != WebPGetFeatures(frame->bitstream.bytes, frame->bitstream.size, features)) {
+        WebPDataClear(&frame->bitstream);
+        return NO;
+    }
+    return YES;
+}
+
+static BOOL webpFrameCoversCanvas(const WebPMuxFrameInfo *frame, const WebPBitstreamFeatures *features,
+                                  int canvasWidth, int canvasHeight) {
+    return 0 == frame->x_offset && 0 == frame->y_offset
+            && canvasWidth == features->width && canvasHeight == features->height;
+}
+
+// A frame doesn't depend on the previous ones if it replaces the whole canvas, or if the canvas
+// is cleared before it. Uses the key frame rules of the compositor.
+static BOOL webpMuxIsKeyFrame(const WebPMux *mux, uint32_t frameIndex, int canvasWidth, int canvasHeight) {
+    WebpCompositorFrame *frames = calloc(frameIndex + 1, sizeof(WebpCompositorFrame));
+    if (!frames) {
+        return NO;
+    }
+    @webp_defer {
+        free(frames);
+    };
+    for (uint32_t index = 0; index <= frameIndex; ++index) {
+        WebPMuxFrameInfo frame;
+        WebPBitstreamFeatures features;
+        if (!webpMuxGetFrame(mux, index, &frame, &features)) {
+            return NO;
+        }
+        WebPDataClear(&frame.bitstream);
+        frames[index] = (WebpCompositorFrame) {
+                .x = frame.x_offset,
+                .y = frame.y_offset,
+                .width = features.width,
+                .height = features.height,
+                .duration = frame.duration,
+                .disposeToBackground = WEBP_MUX_DISPOSE_BACKGROUND == frame.dispose_method,
+                .blend = WEBP_MUX_BLEND == frame.blend_method,
+                .hasAlpha = features.has_alpha
+        };
+    }
+    webpCompositorFindKeyFrames(frames, frameIndex + 1, canvasWidth, canvasHeight);
+    return frameIndex == frames[frameIndex].keyFrame;
+}
+
+CFDataRef __nullable WebpDataCreateWithLoopCount(CFDataRef __nonnull dataRef, UInt32 loopCount) CF_RETURNS_RETAINED {
+    webpMetricsOperationBegin(WebpMetricsOperationTransmux);
+    @webp_defer {
+        webpMetricsOperationEnd();
+    };
+    WebPMux *mux;
+    if (!(mux = webpMuxCreateWithData(dataRef))) {
+        return NULL;
+    }
+    @webp_defer {
+        WebPMuxDelete(mux);
+    };
+    if (!webpMuxIsAnimated(mux)) {
+        return (CFDataRef) CFRetain(dataRef);
+    }
+    WebPMuxAnimParams params;
+    if (WEBP_MUX_OK != WebPMuxGetAnimationParams(mux, &params)) {
+        return NULL;
+    }
+    const int newLoopCount = (int) MIN(loopCount, 0xffff);
+    if (newLoopCount == params.loop_count) {
+        return (CFDataRef) CFRetain(dataRef);
+    }
+    params.loop_count = newLoopCount;
+    if (WEBP_MUX_OK != WebPMuxSetAnimationParams(mux, &params)) {
+        return NULL;
+    }
+    return webpMuxCreateData(mux);
+}
+
+CFDataRef __nullable WebpDataCreateWithoutMetadata(CFDataRef __nonnull dataRef, WebpMetadata metadata) CF_RETURNS_RETAINED {
+    webpMetricsOperationBegin(WebpMetricsOperationTransmux);
+    @webp_defer {
+        webpMetricsOperationEnd();
+    };
+    WebPMux *mux;
+    if (!(mux = webpMuxCreateWithData(dataRef))) {
+        return NULL;
+    }
+    @webp_defer {
+        WebPMuxDelete(mux);
+    };
+    BOOL isModified = NO;
+    const WebpMetadata kinds[] = { WebpMetadataICCProfile, WebpMetadataEXIF, WebpMetadataXMP };
+    for (size_t kindIdx = 0; kindIdx < sizeof(kinds) / sizeof(kinds[0]); ++kindIdx) {
+        if (0 == (metadata & kinds[kindIdx])) {
+            continue;
+        }
+        const __auto_type error = WebPMuxDeleteChunk(mux, webpMetadataChunkId(kinds[kindIdx]));
+        if (WEBP_MUX_OK != error && WEBP_MUX_NOT_FOUND != error) {
+            return NULL;
+        }
+        isModified = isModified || WEBP_MUX_OK == error;
+    }
+    // Images without the metadata are shared, the sanitized data is usually identical to the source.
+    return isModified ? webpMuxCreateData(mux) : (CFDataRef) CFRetain(dataRef);
+}
+
+CFDataRef __nullable WebpDataCreateWithMetadata(CFDataRef __nonnull dataRef,
+                                                WebpMetadata metadata,
+                                                CFDataRef __nullable payload) CF_RETURNS_RETAINED {
+    const char *chunkId;
+    if (!(chunkId = webpMetadataChunkId(metadata))) {
+        return NULL;
+    }
+    if (!payload) {
+        return WebpDataCreateWithoutMetadata(dataRef, metadata);
+    }
+    webpMetricsOperationBegin(WebpMetricsOperationTransmux);
+    @webp_defer {
+        webpMetricsOperationEnd();
+    };
+    WebPMux *mux;
+    if (!(mux = webpMuxCreateWithData(dataRef))) {
+        return NULL;
+    }
+    @webp_defer {
+        WebPMuxDelete(mux);
+    };
+    WebPData chunk = { .bytes = CFDataGetBytePtr(payload), .size = (size_t) CFDataGetLength(payload) };
+    if (WEBP_MUX_OK != WebPMuxSetChunk(mux, chunkId, &chunk, 0)) {
+        return NULL;
+    }
+    return webpMuxCreateData(mux);
+}
+
+CFDataRef __nullable WebpDataCopyMetadata(CFDataRef __nonnull dataRef, WebpMetadata metadata) CF_RETURNS_RETAINED {
+    webpMetricsOperationBegin(WebpMetricsOperationTransmux);
+    @webp_defer {
+        webpMetricsOperationEnd();
+    };
+    const char *chunkId;
+    WebPMux *mux;
+    if (!(chunkId = webpMetadataChunkId(metadata)) || !(mux = webpMuxCreateWithData(dataRef))) {
+        return NULL;
+    }
+    WebPData chunk;
+    CFDataRef chunkRef = NULL;
+    if (WEBP_MUX_OK == WebPMuxGetChunk(mux, chunkId, &chunk)) {
+        chunkRef = CFDataCreate(kCFAllocatorDefault, chunk.bytes, (CFIndex) chunk.size);
+    }
+    WebPMuxDelete(mux);
+    return chunkRef;
+}
+
+CFDataRef __nullable WebpDataCreateWithFrame(CFDataRef __nonnull dataRef, UInt32 frameIndex) CF_RETURNS_RETAINED {
+    webpMetricsOperationBegin(WebpMetricsOperationTransmux);
+    @webp_defer {
+        webpMetricsOperationEnd();
+    };
+    WebPMux *mux;
+    if (!(mux = webpMuxCreateWithData(dataRef))) {
+        return NULL;
+    }
+    @webp_defer {
+        WebPMuxDelete(mux);
+    };
+    if (!webpMuxIsAnimated(mux)) {
+        return 0 == frameIndex ? (CFDataRef) CFRetain(dataRef) : NULL;
+    }
+    int canvasWidth, canvasHeight;
+    if (WEBP_MUX_OK != WebPMuxGetCanvasSize(mux, &canvasWidth, &canvasHeight)
+            || !webpMuxIsKeyFrame(mux, frameIndex, canvasWidth, canvasHeight)) {
+        return NULL;
+    }
+    __block WebPMuxFrameInfo frame;
+    WebPBitstreamFeatures features;
+    if (!webpMuxGetFrame(mux, frameIndex, &frame, &features)) {
+        return NULL;
+    }
+    @webp_defer {
+        WebPDataClear(&frame.bitstream);
+    };
+    // A smaller frame would lose its offset and the transparent part of the canvas.
+    if (!webpFrameCoversCanvas(&frame, &features, canvasWidth, canvasHeight)) {
+        return NULL;
+    }
+    WebPMux *frameMux;
+    if (!(frameMux = WebPMuxNew())) {
+        return NULL;
+    }
+    @webp_defer {
+        WebPMuxDelete(frameMux);
+    };
+    if (WEBP_MUX_OK != WebPMuxSetImage(frameMux, &frame.bitstream, 0) || !webpMuxCopyMetadata(mux, frameMux)) {
+        return NULL;
+    }
+    return webpMuxCreateData(frameMux);
+}
+
+CFDataRef __nullable WebpDataCreateWithFrameRange(CFDataRef __nonnull dataRef, CFRange range) CF_RETURNS_RETAINED {
+    webpMetricsOperationBegin(WebpMetricsOperationTransmux);
+    @webp_defer {
+        webpMetricsOperationEnd();
+    };
+    WebPMux *mux;
+    if (0 > range.location || 0 >= range.length || !(mux = webpMuxCreateWithData(dataRef))) {
+        return NULL;
+    }
+    @webp_defer {
+        WebPMuxDelete(mux);
+    };
+    int frameCount = 0;
+    if (!webpMuxIsAnimated(mux) || WEBP_MUX_OK != WebPMuxNumChunks(mux, WEBP_CHUNK_ANMF, &frameCount)
+            || range.location >= frameCount) {
+        return NULL;
+    }
+    const __auto_type firstFrame = (uint32_t) range.location;
+    const __auto_type endFrame = (uint32_t) MIN((CFIndex) frameCount, range.location + range.length);
+    int canvasWidth, canvasHeight;
+    WebPMuxAnimParams params;
+    if (WEBP_MUX_OK != WebPMuxGetCanvasSize(mux, &canvasWidth, &canvasHeight)
+            || WEBP_MUX_OK != WebPMuxGetAnimationParams(mux, &params)
+            || !webpMuxIsKeyFrame(mux, firstFrame, canvasWidth, canvasHeight)) {
+        return NULL;
+    }
+    WebPMux *rangeMux;
+    if (!(rangeMux = WebPMuxNew())) {
+        return NULL;
+    }
+    @webp_defer {
+        WebPMuxDelete(rangeMux);
+    };
+    if (WEBP_MUX_OK != WebPMuxSetCanvasSize(rangeMux, canvasWidth, canvasHeight)
+            || WEBP_MUX_OK != WebPMuxSetAnimationParams(rangeMux, &params)
+            || !webpMuxCopyMetadata(mux, rangeMux)) {
+        return NULL;
+    }
+    // Frames keep their offsets, durations and blending, the bitstreams are copied without decoding.
+    for (uint32_t frameIdx = firstFrame; frameIdx < endFrame; ++frameIdx) {
+        WebPMuxFrameInfo frame;
+        if (WEBP_MUX_OK != WebPMuxGetFrame(mux, frameIdx + 1, &frame)) {
+            return NULL;
+        }
+        const __auto_type error = WebPMuxPushFrame(rangeMux, &frame, 1);
+        WebPDataClear(&frame.bitstream);
+        if (WEBP_MUX_OK != error) {
+            return NULL;
+        }
+    }
+    return webpMuxCreateData(rangeMux);
+}
@@ -24,6 +24,22 @@ CF_EXTERN_C_BEGIN
  */
 CFDataRef __nullable WebpDataCreateFromImage(CGImageRef __nonnull imageRef, WIKEncoderConfig * const __nonnull config) CF_RETURNS_RETAINED;
 
+/**
+ * Returns an array of data objects that contain the image in WebP format, one for each encoder
+ * configuration. The image is converted once, smaller renditions are downscaled from larger ones
+ * and all renditions are encoded in parallel.
+ *
+ * @param imageRef
+ *        The original image data.
+ * @param configs
+ *        WebP encoder configurations, usually with different `maxPixelSize` values.
+ * @return
+ *        An array of image data in the order of `configs`, or NULL if any rendition fails to encode.
+ *        You are responsible for releasing this object using CFRelease.
+ */
+CFArrayRef __nullable WebpDataCreateRenditionsFromImage(CGImageRef __nonnull imageRef,
+                                                        NSArray<WIKEncoderConfig *> * const __nonnull configs) CF_RETURNS_RETAINED;
+
 /**
  * Returns an image object from the binary data in WebP format.
  * @warning This method doesn't support animated images. Use UIImage's methods for animations.
@@ -49,6 +65,93 @@ CGImageRef __nullable WebpImageCreateFromData(CFDataRef __nonnull dataRef) CF_RE
  */
 CGImageRef __nullable WebpImageCreateFromDataWithSize(CFDataRef __nonnull dataRef, UInt32 maxDisplaySize) CF_RETURNS_RETAINED;
 
+/**
+ * Returns an image object with the region of the image in WebP format. Only the region is
+ * decoded, so memory and time depend on the region size rather than on the image size.
+ * The resulting image size is limited to the `maxDimension` value.
+ * @warning This method doesn't support animated images. Use UIImage's methods for animations.
+ *
+ * @param dataRef
+ *        Image data in WebP format.
+ * @param rect
+ *        The region in pixels, with the origin in the top left corner of the image. The region is
+ *        clipped to the image bounds, CGRectNull decodes the whole image.
+ * @param maxDisplaySize
+ *        Maximum size of the decoded region in pixels. For '0' - uses the region size.
+ * @return
+ *        An image object, or NULL if an error occurs or the region is outside of the image.
+ *        You are responsible for releasing this object using CFRelease.
+ */
+CGImageRef __nullable WebpImageCreateFromDataWithRect(CFDataRef __nonnull dataRef,
+                                                      CGRect rect,
+                                                      UInt32 maxDisplaySize) CF_RETURNS_RETAINED;
+
+/**
+ * Returns an image object from the file in WebP format. The file is memory-mapped, so its
+ * content isn't copied to memory. The resulting image size is limited to the `maxDimension` value.
+ * @warning This method doesn't support animated images. Use UIImage's methods for animations.
+ *
+ * @param path
+ *        Path to the image file in WebP format.
+ * @param maxDisplaySize
+ *        Maximum size of the image in pixels. For '0' - uses the original image size.
+ * @return
+ *        An image object, or NULL if an error occurs. You are responsible for releasing this object using CFRelease.
+ */
+CGImageRef __nullable WebpImageCreateFromFile(CFStringRef __nonnull path, UInt32 maxDisplaySize) CF_RETURNS_RETAINED;
+
+/**
+ * Encodes the image in WebP format directly into the file. Encoder output is written to
+ * a temporary file without buffering in memory, which atomically replaces the file at `path`.
+ *
+ * @param imageRef
+ *        The original image data.
+ * @param config
+ *        WebP encoder configuration.
+ * @param path
+ *        Destination file path.
+ * @return
+ *        YES if the file is written.
+ */
+BOOL WebpImageWriteToFile(CGImageRef __nonnull imageRef, WIKEncoderConfig * const __nonnull config, CFStringRef __nonnull path);
+
+/**
+ * Decodes the image into the caller-provided memory, without allocating the pixel buffer.
+ * Pixels are written as 32-bit premultiplied BGRA, which matches the
+ * `kCGBitmapByteOrder32Host | kCGImageAlphaPremultipliedFirst` bitmap layout.
+ * @warning This method doesn't support animated images, only the first frame is decoded.
+ *
+ * @param dataRef
+ *        Image data in WebP format.
+ * @param pixels
+ *        Destination buffer of at least `bytesPerRow * height` bytes.
+ * @param width
+ *        Width of the decoded image in pixels, the image is scaled if it differs from the original width.
+ * @param height
+ *        Height of the decoded image in pixels, the image is scaled if it differs from the original height.
+ * @param bytesPerRow
+ *        Stride of the destination buffer, at least `width * 4`.
+ * @return
+ *        YES if the image is decoded.
+ */
+BOOL WebpImageDecodeIntoBuffer(CFDataRef __nonnull dataRef,
+                               void * __nonnull pixels,
+                               size_t width,
+                               size_t height,
+                               size_t bytesPerRow);
+
+/**
+ * Sets the maximum size of the pixel buffer pool in bytes. Pixel buffers of decoded images
+ * and animation frames return to the pool when images are released and are reused for the
+ * next images of similar size. The default limit is 32 MB, '0' disables the pool.
+ */
+void WebpSetBufferPoolLimit(size_t limit);
+
+/**
+ * Frees all pixel buffers cached by the pool. The pool is also purged on memory warnings.
+ */
+void WebpPurgeBufferPool(void);
+
 /**
  * Returns YES if given data contains image in WebP format.
  *
@@ -59,4 +162,37 @@ CGImageRef __nullable WebpImageCreateFromDataWithSize(CFDataRef __nonnull dataRe
  */
 BOOL WebpIsImageData(CFDataRef __nonnull dataRef);
 
+typedef NS_ENUM(NSInteger, WebpImageFormat) {
+    WebpImageFormatUndefined = 0,   // unknown, or animation with both lossy and lossless frames
+    WebpImageFormatLossy = 1,
+    WebpImageFormatLossless = 2
+};
+
+typedef struct {
+    UInt32 width;                   // canvas width in pixels
+    UInt32 height;                  // canvas height in pixels
+    BOOL hasAlpha;
+    BOOL isAnimated;
+    UInt32 frameCount;              // 1 for non-animated images
+    UInt32 loopCount;               // 0 means infinite, for non-animated images 0
+    NSTimeInterval duration;        // duration of one animation cycle, for non-animated images 0
+    WebpImageFormat format;
+    BOOL hasICCProfile;
+    BOOL hasEXIF;
+    BOOL hasXMP;
+} WebpImageInfo;
+
+/**
+ * Reads image properties from the WebP container without decoding the image. Only the
+ * RIFF header and the chunk table are read, no memory is allocated.
+ *
+ * @param dataRef
+ *        Image data in WebP format. Truncated data is parsed as far as it goes.
+ * @param info
+ *        Receives the image properties.
+ * @return
+ *        YES if data contains image in WebP format and at least the canvas size is known.
+ */
+BOOL WebpGetImageInfo(CFDataRef __nonnull dataRef, WebpImageInfo * __nonnull info);
+
 CF_EXTERN_C_END
@@ -8,6 +8,10 @@
 
 #import "CGImage+WebP.h"
 #import "CoreGraphics+WebP.h"
+#import "NSData+WebP.h"
+#import "WebpBufferPool.h"
+#import "WebpContainer.h"
+#import "WebpMetrics.h"
 #import "WebpImageKitMacro.h"
 
 CFDataRef __nullable WebpDataCreateFromImage(CGImageRef __nonnull imageRef, WIKEncoderConfig * const __nonnull config) CF_RETURNS_RETAINED {
@@ -17,20 +21,38 @@ CFDataRef __nullable WebpDataCreateFromImage(CGImageRef __nonnull imageRef, WIKE
     return webpCreateDataFromCGImage(imageRef, config);
 }
 
+CFArrayRef __nullable WebpDataCreateRenditionsFromImage(CGImageRef __nonnull imageRef,
+                                                        NSArray<WIKEncoderConfig *> * const __nonnull configs) CF_RETURNS_RETAINED {
+    if (!imageRef || 0 == configs.count) {
+        return NULL;
+    }
+    return (__bridge_retained CFArrayRef) webpDataRenditionsFromCGImage(imageRef, configs);
+}
+
 CGImageRef __nullable WebpImageCreateFromData(CFDataRef __nonnull dataRef) CF_RETURNS_RETAINED {
     return WebpImageCreateFromDataWithSize(dataRef, 0);
 }
 
 CGImageRef __nullable WebpImageCreateFromDataWithSize(CFDataRef __nonnull dataRef, UInt32 maxDisplaySize) CF_RETURNS_RETAINED {
+    return WebpImageCreateFromDataWithRect(dataRef, CGRectNull, maxDisplaySize);
+}
+
+CGImageRef __nullable WebpImageCreateFromDataWithRect(CFDataRef __nonnull dataRef,
+                                                      CGRect rect,
+                                                      UInt32 maxDisplaySize) CF_RETURNS_RETAINED {
     if (!WebpIsImageData(dataRef)) {
         return NULL;
     }
+    webpMetricsOperationBegin(WebpMetricsOperationDecode);
+    @webp_defer {
+        webpMetricsOperationEnd();
+    };
     WebPData webpData;
     WebPDataInit(&webpData);
     webpData.bytes = CFDataGetBytePtr(dataRef);
     webpData.size = (size_t) CFDataGetLength(dataRef);
     WebPDemuxer *demuxer;
-    if (!(demuxer = WebPDemux(&webpData))) {
+    if (!(demuxer = webpCodecCreateDemuxer(&webpData))) {
         return nil;
     }
     WebPIterator iterator;
@@ -42,29 +64,111 @@ CGImageRef __nullable WebpImageCreateFromDataWithSize(CFDataRef __nonnull dataRe
     __auto_type colorSpace = webpCreateColorSpace(demuxer);
     __auto_type canvasWidth = (size_t) WebPDemuxGetI(demuxer, WEBP_FF_CANVAS_WIDTH);
     __auto_type canvasHeight = (size_t) WebPDemuxGetI(demuxer, WEBP_FF_CANVAS_HEIGHT);
-    CGSize scaledSize = CGSizeZero;
-    if (0 < maxDisplaySize && maxDisplaySize < MAX(canvasWidth, canvasHeight)) {
-        const __auto_type originalSize = CGSizeMake(canvasWidth, canvasHeight);
-        __auto_type limitedSize = scaledImageSize(originalSize, CGSizeMake(maxDisplaySize, maxDisplaySize), 1.0);
-        if (!CGSizeEqualToSize(originalSize, scaledSize)) {
-            scaledSize = limitedSize;
+    CGRect cropRect = CGRectNull;
+    CGSize originalSize = CGSizeMake(canvasWidth, canvasHeight);
+    if (!CGRectIsNull(rect)) {
+        // The rectangle is given on the canvas, the frame bitstream may be placed at an offset.
+        const __auto_type frameRect = CGRectMake(iterator.x_offset, iterator.y_offset, iterator.width, iterator.height);
+        cropRect = CGRectIntegral(CGRectIntersection(rect, frameRect));
+        // CGRectIsEmpty is true for the null rectangle of disjoint rectangles as well.
+        if (CGRectIsEmpty(cropRect)) {
+            CFRelease(colorSpace);
+            WebPDemuxReleaseIterator(&iterator);
+            WebPDemuxDelete(demuxer);
+            return NULL;
         }
+        originalSize = cropRect.size;
+        cropRect = CGRectOffset(cropRect, -iterator.x_offset, -iterator.y_offset);
     }
-    __auto_type image = webpCreateCGImage(iterator.fragment, colorSpace, scaledSize);
+    CGSize scaledSize = CGSizeZero;
+    if (0 < maxDisplaySize && maxDisplaySize < MAX(originalSize.width, originalSize.height)) {
+        scaledSize = scaledImageSize(originalSize, CGSizeMake(maxDisplaySize, maxDisplaySize), 1.0);
+    }
+    CGImageRef image = webpCreateCGImageWithRect(iterator.fragment, colorSpace, cropRect, scaledSize);
     CFRelease(colorSpace);
     WebPDemuxReleaseIterator(&iterator);
     WebPDemuxDelete(demuxer);
     return image;
 }
 
+CGImageRef __nullable WebpImageCreateFromFile(CFStringRef __nonnull path, UInt32 maxDisplaySize) CF_RETURNS_RETAINED {
+    NSData *data;
+    if (!path || !(data = [NSData webpDataWithContentsOfMappedFile:(__bridge NSString *)path])) {
+        return NULL;
+    }
+    return WebpImageCreateFromDataWithSize((__bridge CFDataRef)data, maxDisplaySize);
+}
+
+BOOL WebpImageWriteToFile(CGImageRef __nonnull imageRef, WIKEncoderConfig * const __nonnull config, CFStringRef __nonnull path) {
+    if (!imageRef || !config || !path) {
+        return NO;
+    }
+    return webpWriteCGImageToFile(imageRef, config, (__bridge NSString *)path);
+}
+
+BOOL WebpImageDecodeIntoBuffer(CFDataRef __nonnull dataRef,
+                               void * __nonnull pixels,
+                               size_t width,
+                               size_t height,
+                               size_t bytesPerRow) {
+    if (!pixels || 0 == width || 0 == height || bytesPerRow < width * 4 || !WebpIsImageData(dataRef)) {
+        return NO;
+    }
+    webpMetricsOperationBegin(WebpMetricsOperationDecode);
+    @webp_defer {
+        webpMetricsOperationEnd();
+    };
+    WebPData webpData;
+    WebPDataInit(&webpData);
+    webpData.bytes = CFDataGetBytePtr(dataRef);
+    webpData.size = (size_t) CFDataGetLength(dataRef);
+    WebPDemuxer *demuxer;
+    if (!(demuxer = webpCodecCreateDemuxer(&webpData))) {
+        return NO;
+    }
+    WebPIterator iterator;
+    BOOL result = NO;
+    if (WebPDemuxGetFrame(demuxer, 1, &iterator)) {
+        result = webpDecodeIntoBuffer(iterator.fragment, CGSizeMake(width, height), pixels, bytesPerRow);
+    }
+    WebPDemuxReleaseIterator(&iterator);
+    WebPDemuxDelete(demuxer);
+    return result;
+}
+
+void WebpSetBufferPoolLimit(size_t limit) {
+    webpBufferPoolSetLimit(limit);
+}
+
+void WebpPurgeBufferPool(void) {
+    webpBufferPoolPurge();
+}
+
 BOOL WebpIsImageData(CFDataRef __nonnull dataRef) {
-    UInt8 magicString[12];
-    if (!dataRef || CFDataGetLength(dataRef) < sizeof(magicString)) {
+    if (!dataRef) {
+        return NO;
+    }
+    return 0 != webpContainerHasSignature(CFDataGetBytePtr(dataRef), (size_t) CFDataGetLength(dataRef));
+}
+
+BOOL WebpGetImageInfo(CFDataRef __nonnull dataRef, WebpImageInfo * __nonnull info) {
+    WebpContainerInfo containerInfo;
+    if (!dataRef || !info
+            || !webpContainerParse(CFDataGetBytePtr(dataRef), (size_t) CFDataGetLength(dataRef), &containerInfo)) {
         return NO;
     }
-    CFDataGetBytes(dataRef, CFRangeMake(0, sizeof(magicString)), magicString);
-    const UInt8 prefix[4] = "RIFF";
-    const UInt8 suffix[4] = "WEBP";
-    return 0 == memcmp(magicString, prefix, sizeof(prefix))
-            && 0 == memcmp(magicString + (sizeof(magicString) - sizeof(suffix)), suffix, sizeof(suffix));
+    *info = (WebpImageInfo) {
+            .width = containerInfo.canvasWidth,
+            .height = containerInfo.canvasHeight,
+            .hasAlpha = 0 != containerInfo.hasAlpha,
+            .isAnimated = 0 != containerInfo.isAnimated,
+            .frameCount = containerInfo.frameCount,
+            .loopCount = containerInfo.loopCount,
+            .duration = containerInfo.duration / 1000.0,
+            .format = (WebpImageFormat) containerInfo.format,
+            .hasICCProfile = 0 != containerInfo.hasICC,
+            .hasEXIF = 0 != containerInfo.hasEXIF,
+            .hasXMP = 0 != containerInfo.hasXMP
+    };
+    return YES;
 }
@@ -0,0 +1,110 @@
+//
+//  CVPixelBuffer+WebP.h
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreVideo/CoreVideo.h>
+
+CF_EXTERN_C_BEGIN
+
+@class WIKEncoderConfig;
+
+/**
+ * 8-bit YUV 4:2:0 image planes. Chroma planes are `(width + 1) / 2` by `(height + 1) / 2` samples.
+ */
+typedef struct {
+    uint8_t * __nullable y;
+    uint8_t * __nullable u;
+    uint8_t * __nullable v;
+    uint8_t * __nullable a;         // optional alpha plane of the luma size
+    size_t yStride;
+    size_t uStride;
+    size_t vStride;
+    size_t aStride;
+    size_t chromaStep;              // bytes between chroma samples: 1 for planar (I420), 2 for interleaved CbCr (NV12)
+    size_t width;                   // luma size in pixels
+    size_t height;
+    BOOL isFullRange;               // 0-255 samples instead of the video range (16-235 luma, 16-240 chroma)
+} WebpYUVPlanes;
+
+/**
+ * Returns a data object that contains the YUV image in WebP format. Lossy encoding takes the planes
+ * as they are, without conversion to RGB. Video range planar input is encoded without copying,
+ * interleaved chroma and full range samples are copied once into the video range planes of WebP.
+ * The planes aren't modified, except for the color of fully transparent pixels when the alpha
+ * plane is given. Lossless encoding works in RGB, so the planes are converted.
+ * @warning Samples are expected in the BT.601 color matrix used by WebP.
+ *
+ * @param planes
+ *        The image planes, the alpha plane is optional.
+ * @param config
+ *        WebP encoder configuration.
+ * @return
+ *        An image data, or NULL if an error occurs. You are responsible for releasing this object using CFRelease.
+ */
+CFDataRef __nullable WebpDataCreateFromYUVPlanes(const WebpYUVPlanes * __nonnull planes,
+                                                 WIKEncoderConfig * const __nonnull config) CF_RETURNS_RETAINED;
+
+/**
+ * Decodes the image into the caller-provided YUV planes, without conversion to RGB. The image is
+ * scaled to the planes size. Planar video range output is written by the decoder directly,
+ * interleaved chroma and full range samples are converted in place. Lossless images are RGB
+ * internally, so the decoder converts them.
+ * @warning This method doesn't support animated images, only the first frame is decoded.
+ *
+ * @param dataRef
+ *        Image data in WebP format.
+ * @param planes
+ *        Destination planes. Alpha is written if the alpha plane is given.
+ * @return
+ *        YES if the image is decoded.
+ */
+BOOL WebpDecodeIntoYUVPlanes(CFDataRef __nonnull dataRef, const WebpYUVPlanes * __nonnull planes);
+
+/**
+ * Same as `WebpDataCreateFromYUVPlanes` for the 4:2:0 pixel buffer formats:
+ * kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange, kCVPixelFormatType_420YpCbCr8BiPlanarFullRange,
+ * kCVPixelFormatType_420YpCbCr8Planar and kCVPixelFormatType_420YpCbCr8PlanarFullRange.
+ *
+ * @param pixelBuffer
+ *        The original image.
+ * @param config
+ *        WebP encoder configuration.
+ * @return
+ *        An image data, or NULL if an error occurs or the pixel format isn't supported.
+ *        You are responsible for releasing this object using CFRelease.
+ */
+CFDataRef __nullable WebpDataCreateFromPixelBuffer(CVPixelBufferRef __nonnull pixelBuffer,
+                                                   WIKEncoderConfig * const __nonnull config) CF_RETURNS_RETAINED;
+
+/**
+ * Same as `WebpDecodeIntoYUVPlanes` for the 4:2:0 pixel buffer formats, see `WebpDataCreateFromPixelBuffer`.
+ *
+ * @param dataRef
+ *        Image data in WebP format.
+ * @param pixelBuffer
+ *        Destination pixel buffer, the image is scaled to its size.
+ * @return
+ *        YES if the image is decoded.
+ */
+BOOL WebpDecodeIntoPixelBuffer(CFDataRef __nonnull dataRef, CVPixelBufferRef __nonnull pixelBuffer);
+
+/**
+ * Returns a kCVPixelFormatType_420YpCbCr8Planar pixel buffer with the image, the decoder writes
+ * straight into its planes. The resulting image size is limited to the `maxDisplaySize` value.
+ * @warning This method doesn't support animated images, only the first frame is decoded.
+ *
+ * @param dataRef
+ *        Image data in WebP format.
+ * @param maxDisplaySize
+ *        Maximum size of the image in pixels. For '0' - uses the original image size.
+ * @return
+ *        A pixel buffer, or NULL if an error occurs. You are responsible for releasing this object using CVPixelBufferRelease.
+ */
+CVPixelBufferRef __nullable WebpPixelBufferCreateFromData(CFDataRef __nonnull dataRef, UInt32 maxDisplaySize) CF_RETURNS_RETAINED;
+
+CF_EXTERN_C_END
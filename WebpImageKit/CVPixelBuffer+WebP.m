@@ -0,0 +1,288 @@
+//
+//  CVPixelBuffer+WebP.m
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#import "CVPixelBuffer+WebP.h"
+#import "CGImage+WebP.h"
+#import "CoreGraphics+WebP.h"
+#import "WebpBufferPool.h"
+#import "WebpMemoryBudget.h"
+#import "WebpMetrics.h"
+#import "WebpPixelConverter.h"
+#import "WebpImageKitMacro.h"
+
+NS_INLINE BOOL webpIsValidPlanes(const WebpYUVPlanes * const planes) {
+    return planes && planes->y && planes->u && planes->v
+            && 0 < planes->width && 0 < planes->height
+            && planes->width <= WEBP_MAX_DIMENSION && planes->height <= WEBP_MAX_DIMENSION
+            && planes->width <= planes->yStride
+            && (!planes->a || planes->width <= planes->aStride);
+}
+
+// Calls the block with the bitstream of the first frame, so animations decode their first frame.
+static BOOL webpWithFirstFrame(CFDataRef __nonnull dataRef, BOOL (^ const __nonnull block)(WebPData fragment, CGSize frameSize)) {
+    webpMetricsOperationBegin(WebpMetricsOperationDecode);
+    @webp_defer {
+        webpMetricsOperationEnd();
+    };
+    WebPData webpData;
+    WebPDataInit(&webpData);
+    webpData.bytes = CFDataGetBytePtr(dataRef);
+    webpData.size = (size_t) CFDataGetLength(dataRef);
+    WebPDemuxer *demuxer;
+    if (!(demuxer = webpCodecCreateDemuxer(&webpData))) {
+        return NO;
+    }
+    WebPIterator iterator;
+    BOOL result = NO;
+    if (WebPDemuxGetFrame(demuxer, 1, &iterator)) {
+        result = block(iterator.fragment, CGSizeMake(iterator.width, iterator.height));
+    }
+    WebPDemuxReleaseIterator(&iterator);
+    WebPDemuxDelete(demuxer);
+    return result;
+}
+
+static BOOL webpDecodeFrameIntoPlanes(WebPData fragment, const WebpYUVPlanes * __nonnull planes) {
+    const size_t width = planes->width;
+    const size_t height = planes->height;
+    const size_t chromaWidth = (width + 1) / 2;
+    const size_t chromaHeight = (height + 1) / 2;
+    const size_t chromaStep = MAX(planes->chromaStep, (size_t) 1);
+    WebPYUVABuffer buffer = {
+            .y = planes->y,
+            .y_stride = (int) planes->yStride,
+            .y_size = planes->yStride * (height - 1) + width,
+            .u = planes->u,
+            .u_stride = (int) planes->uStride,
+            .u_size = planes->uStride * (chromaHeight - 1) + chromaWidth,
+            .v = planes->v,
+            .v_stride = (int) planes->vStride,
+            .v_size = planes->vStride * (chromaHeight - 1) + chromaWidth,
+            .a = planes->a,
+            .a_stride = (int) planes->aStride,
+            .a_size = planes->a ? planes->aStride * (height - 1) + width : 0
+    };
+    // libwebp writes planar chroma only, interleaved chroma goes through pooled planes.
+    __block uint8_t *chroma = NULL;
+    __block size_t chromaCapacity = 0;
+    @webp_defer {
+        webpBufferPoolRelease(chroma, chromaCapacity);
+    };
+    if (1 != chromaStep) {
+        const size_t stride = webpByteAlign(chromaWidth, 64);
+        if (!(chroma = webpAcquirePooledBuffer(2 * stride * chromaHeight, &chromaCapacity))) {
+            return NO;
+        }
+        buffer.u = chroma;
+        buffer.v = chroma + stride * chromaHeight;
+        buffer.u_stride = buffer.v_stride = (int) stride;
+        buffer.u_size = buffer.v_size = stride * chromaHeight;
+    }
+    if (!webpDecodeIntoYuvBuffer(fragment, CGSizeMake(width, height), &buffer)) {
+        return NO;
+    }
+    uint8_t table[256];
+    if (planes->isFullRange) {
+        webpYuvRangeTable(table, 0, 1);
+        webpCopyPlane(planes->y, planes->yStride, 1, planes->y, planes->yStride, 1, width, height, table);
+        webpYuvRangeTable(table, 1, 1);
+    }
+    if (1 != chromaStep || planes->isFullRange) {
+        const uint8_t *chromaTable = planes->isFullRange ? table : NULL;
+        webpCopyPlane(buffer.u, (size_t) buffer.u_stride, 1, planes->u, planes->uStride, chromaStep,
+                      chromaWidth, chromaHeight, chromaTable);
+        webpCopyPlane(buffer.v, (size_t) buffer.v_stride, 1, planes->v, planes->vStride, chromaStep,
+                      chromaWidth, chromaHeight, chromaTable);
+    }
+    return YES;
+}
+
+// Fills the planes of the locked pixel buffer.
+static BOOL webpGetPixelBufferPlanes(CVPixelBufferRef __nonnull pixelBuffer, WebpYUVPlanes * __nonnull planes) {
+    const OSType format = CVPixelBufferGetPixelFormatType(pixelBuffer);
+    memset(planes, 0, sizeof(WebpYUVPlanes));
+    planes->width = CVPixelBufferGetWidth(pixelBuffer);
+    planes->height = CVPixelBufferGetHeight(pixelBuffer);
+    planes->y = CVPixelBufferGetBaseAddressOfPlane(pixelBuffer, 0);
+    planes->yStride = CVPixelBufferGetBytesPerRowOfPlane(pixelBuffer, 0);
+    switch (format) {
+        case kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange:
+        case kCVPixelFormatType_420YpCbCr8BiPlanarFullRange:
+            planes->u = CVPixelBufferGetBaseAddressOfPlane(pixelBuffer, 1);
+            planes->v = planes->u ? planes->u + 1 : NULL;
+            planes->uStride = planes->vStride = CVPixelBufferGetBytesPerRowOfPlane(pixelBuffer, 1);
+            planes->chromaStep = 2;
+            break;
+        case kCVPixelFormatType_420YpCbCr8Planar:
+        case kCVPixelFormatType_420YpCbCr8PlanarFullRange:
+            planes->u = CVPixelBufferGetBaseAddressOfPlane(pixelBuffer, 1);
+            planes->v = CVPixelBufferGetBaseAddressOfPlane(pixelBuffer, 2);
+            planes->uStride = CVPixelBufferGetBytesPerRowOfPlane(pixelBuffer, 1);
+            planes->vStride = CVPixelBufferGetBytesPerRowOfPlane(pixelBuffer, 2);
+            planes->chromaStep = 1;
+            break;
+        default:
+            return NO;
+    }
+    planes->isFullRange = kCVPixelFormatType_420YpCbCr8BiPlanarFullRange == format
+            || kCVPixelFormatType_420YpCbCr8PlanarFullRange == format;
+    return webpIsValidPlanes(planes);
+}
+
+CFDataRef __nullable WebpDataCreateFromYUVPlanes(const WebpYUVPlanes * __nonnull planes,
+                                                 WIKEncoderConfig * const __nonnull config) CF_RETURNS_RETAINED {
+    if (!webpIsValidPlanes(planes) || !config) {
+        return NULL;
+    }
+    const size_t width = planes->width;
+    const size_t height = planes->height;
+    const size_t chromaWidth = (width + 1) / 2;
+    const size_t chromaHeight = (height + 1) / 2;
+    const size_t chromaStep = MAX(planes->chromaStep, (size_t) 1);
+    webpMetricsOperationBegin(WebpMetricsOperationEncode);
+    @webp_defer {
+        webpMetricsOperationEnd();
+    };
+    WebPPicture *picture = calloc(1, sizeof(WebPPicture));
+    if (!picture || !WebPPictureInit(picture)) {
+        if (picture) free(picture);
+        return NULL;
+    }
+    __block uint8_t *luma = NULL, *chroma = NULL;
+    __block size_t lumaCapacity = 0, chromaCapacity = 0;
+    @webp_defer {
+        WebPPictureFree(picture);
+        free(picture);
+        webpBufferPoolRelease(luma, lumaCapacity);
+        webpBufferPoolRelease(chroma, chromaCapacity);
+    };
+    // The picture views the caller's planes, WebP's own video range planar layout is encoded as is.
+    picture->use_argb = 0;
+    picture->colorspace = planes->a ? WEBP_YUV420A : WEBP_YUV420;
+    picture->width = (int) width;
+    picture->height = (int) height;
+    picture->y = planes->y;
+    picture->y_stride = (int) planes->yStride;
+    picture->u = planes->u;
+    picture->v = planes->v;
+    picture->uv_stride = (int) planes->uStride;
+    picture->a = planes->a;
+    picture->a_stride = (int) planes->aStride;
+    // Conversion of the planes is the import stage of this encode.
+    const uint64_t metricsStart = webpMetricsStageBegin();
+    uint8_t table[256];
+    if (planes->isFullRange) {
+        const size_t stride = webpByteAlign(width, 64);
+        if (!(luma = webpAcquirePooledBuffer(stride * height, &lumaCapacity))) {
+            return NULL;
+        }
+        webpYuvRangeTable(table, 0, 0);
+        webpCopyPlane(planes->y, planes->yStride, 1, luma, stride, 1, width, height, table);
+        picture->y = luma;
+        picture->y_stride = (int) stride;
+    }
+    if (planes->isFullRange || 1 != chromaStep || planes->uStride != planes->vStride) {
+        const size_t stride = webpByteAlign(chromaWidth, 64);
+        if (!(chroma = webpAcquirePooledBuffer(2 * stride * chromaHeight, &chromaCapacity))) {
+            return NULL;
+        }
+        if (planes->isFullRange) {
+            webpYuvRangeTable(table, 1, 0);
+        }
+        const uint8_t *chromaTable = planes->isFullRange ? table : NULL;
+        picture->u = chroma;
+        picture->v = chroma + stride * chromaHeight;
+        picture->uv_stride = (int) stride;
+        webpCopyPlane(planes->u, planes->uStride, chromaStep, picture->u, stride, 1,
+                      chromaWidth, chromaHeight, chromaTable);
+        webpCopyPlane(planes->v, planes->vStride, chromaStep, picture->v, stride, 1,
+                      chromaWidth, chromaHeight, chromaTable);
+    }
+    webpMetricsStageEnd(WebpMetricsStageImport, metricsStart, lumaCapacity + chromaCapacity);
+    const __auto_type targetSize = webpEncoderTargetSize(CGSizeMake(width, height), config);
+    if ((size_t) targetSize.width != width || (size_t) targetSize.height != height) {
+        if (!webpCodecScalePicture(picture, picture, (int) targetSize.width, (int) targetSize.height)) {
+            return NULL;
+        }
+    }
+    return webpCreateDataFromPicture(picture, config);
+}
+
+BOOL WebpDecodeIntoYUVPlanes(CFDataRef __nonnull dataRef, const WebpYUVPlanes * __nonnull planes) {
+    if (!webpIsValidPlanes(planes) || !WebpIsImageData(dataRef)) {
+        return NO;
+    }
+    return webpWithFirstFrame(dataRef, ^BOOL(WebPData fragment, __unused CGSize frameSize) {
+        return webpDecodeFrameIntoPlanes(fragment, planes);
+    });
+}
+
+CFDataRef __nullable WebpDataCreateFromPixelBuffer(CVPixelBufferRef __nonnull pixelBuffer,
+                                                   WIKEncoderConfig * const __nonnull config) CF_RETURNS_RETAINED {
+    if (!pixelBuffer || !config
+            || kCVReturnSuccess != CVPixelBufferLockBaseAddress(pixelBuffer, kCVPixelBufferLock_ReadOnly)) {
+        return NULL;
+    }
+    WebpYUVPlanes planes;
+    CFDataRef dataRef = NULL;
+    if (webpGetPixelBufferPlanes(pixelBuffer, &planes)) {
+        dataRef = WebpDataCreateFromYUVPlanes(&planes, config);
+    }
+    CVPixelBufferUnlockBaseAddress(pixelBuffer, kCVPixelBufferLock_ReadOnly);
+    return dataRef;
+}
+
+BOOL WebpDecodeIntoPixelBuffer(CFDataRef __nonnull dataRef, CVPixelBufferRef __nonnull pixelBuffer) {
+    if (!pixelBuffer || kCVReturnSuccess != CVPixelBufferLockBaseAddress(pixelBuffer, 0)) {
+        return NO;
+    }
+    WebpYUVPlanes planes;
+    const BOOL result = webpGetPixelBufferPlanes(pixelBuffer, &planes) && WebpDecodeIntoYUVPlanes(dataRef, &planes);
+    CVPixelBufferUnlockBaseAddress(pixelBuffer, 0);
+    return result;
+}
+
+CVPixelBufferRef __nullable WebpPixelBufferCreateFromData(CFDataRef __nonnull dataRef, UInt32 maxDisplaySize) CF_RETURNS_RETAINED {
+    if (!WebpIsImageData(dataRef)) {
+        return NULL;
+    }
+    __block CVPixelBufferRef pixelBuffer = NULL;
+    webpWithFirstFrame(dataRef, ^BOOL(WebPData fragment, CGSize frameSize) {
+        __auto_type size = frameSize;
+        if (0 < maxDisplaySize && maxDisplaySize < MAX(frameSize.width, frameSize.height)) {
+            size = scaledImageSize(frameSize, CGSizeMake(maxDisplaySize, maxDisplaySize), 1.0);
+        }
+        const size_t width = (size_t) size.width;
+        const size_t height = (size_t) size.height;
+        // Luma plus two quarter size chroma planes.
+        const size_t memorySize = width * height + 2 * ((width + 1) / 2) * ((height + 1) / 2);
+        const size_t reserved = webpMemoryBudgetReserve(memorySize, memorySize);
+        @webp_defer {
+            webpMemoryBudgetRelease(reserved);
+        };
+        NSDictionary *attributes = @{ (__bridge NSString *) kCVPixelBufferIOSurfacePropertiesKey: @{} };
+        if (0 == reserved || kCVReturnSuccess != CVPixelBufferCreate(kCFAllocatorDefault,
+                                                                     width,
+                                                                     height,
+                                                                     kCVPixelFormatType_420YpCbCr8Planar,
+                                                                     (__bridge CFDictionaryRef) attributes,
+                                                                     &pixelBuffer)) {
+            return NO;
+        }
+        CVPixelBufferLockBaseAddress(pixelBuffer, 0);
+        WebpYUVPlanes planes;
+        const BOOL result = webpGetPixelBufferPlanes(pixelBuffer, &planes) && webpDecodeFrameIntoPlanes(fragment, &planes);
+        CVPixelBufferUnlockBaseAddress(pixelBuffer, 0);
+        if (!result) {
+            CVPixelBufferRelease(pixelBuffer);
+            pixelBuffer = NULL;
+        }
+        return result;
+    });
+    return pixelBuffer;
+}
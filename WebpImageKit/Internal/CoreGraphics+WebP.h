@@ -9,23 +9,114 @@
 #ifndef CoreGraphics_WebP_h
 #define CoreGraphics_WebP_h
 
+#import <Foundation/Foundation.h>
 #import <libwebp/demux.h>
 #import <libwebp/decode.h>
+#import <libwebp/encode.h>
 #import <CoreGraphics/CoreGraphics.h>
 
+#import "WebpCodec.h"
+
 @class WIKEncoderConfig;
 
 extern CGColorSpaceRef __nonnull webpCreateColorSpace(WebPDemuxer * __nonnull demuxer) CF_RETURNS_RETAINED;
 extern CGColorSpaceRef __nonnull webpCreateDeviceRgbColorSpace(void) CF_RETURNS_RETAINED;
 
+// Same as `webpBufferPoolAcquire`, also purges the pool on memory warnings.
+extern uint8_t * __nullable webpAcquirePooledBuffer(size_t size, size_t * __nonnull capacity);
+
+// Decoded size of `count` buffers of `size` pixels.
+extern size_t webpImageMemorySize(CGSize size, size_t count);
+// Reserves the memory budget for `count` buffers of `size` pixels and returns the size to decode at.
+// With `canDownscale` the size shrinks to the granted memory. Returns CGSizeZero if nothing is granted.
+extern CGSize webpReserveImageMemory(CGSize size, size_t count, BOOL canDownscale, size_t * __nonnull reserved);
+
 extern CGImageRef __nullable webpCreateCGImage(WebPData webpData,
                                                CGColorSpaceRef __nonnull colorSpace,
                                                CGSize targetSize) CF_RETURNS_RETAINED;
+// `cropRect` is in bitstream pixels, CGRectNull decodes the whole image. The cropped region is scaled to `targetSize`.
+extern CGImageRef __nullable webpCreateCGImageWithRect(WebPData webpData,
+                                                       CGColorSpaceRef __nonnull colorSpace,
+                                                       CGRect cropRect,
+                                                       CGSize targetSize) CF_RETURNS_RETAINED;
+extern BOOL webpDecodeIntoBuffer(WebPData webpData,
+                                 CGSize targetSize,
+                                 uint8_t * __nonnull pixels,
+                                 size_t stride);
+extern BOOL webpDecodeRectIntoBuffer(WebPData webpData,
+                                     CGRect cropRect,
+                                     CGSize targetSize,
+                                     uint8_t * __nonnull pixels,
+                                     size_t stride);
+// Decodes into the Y, U, V and, if given, alpha planes of the buffer, chroma is subsampled 2x2.
+extern BOOL webpDecodeIntoYuvBuffer(WebPData webpData,
+                                    CGSize targetSize,
+                                    const WebPYUVABuffer * __nonnull buffer);
+extern CGImageRef __nullable webpCreateCGImageFromBuffer(const uint8_t * __nonnull pixels,
+                                                         size_t width,
+                                                         size_t height,
+                                                         size_t stride,
+                                                         BOOL hasAlpha,
+                                                         CGColorSpaceRef __nonnull colorSpace) CF_RETURNS_RETAINED;
+// Takes ownership of the `pixels` acquired from the buffer pool, they return to the pool with the image or on failure.
+extern CGImageRef __nullable webpCreateCGImageWithPooledBuffer(uint8_t * __nonnull pixels,
+                                                               size_t capacity,
+                                                               size_t width,
+                                                               size_t height,
+                                                               size_t stride,
+                                                               BOOL hasAlpha,
+                                                               CGColorSpaceRef __nonnull colorSpace) CF_RETURNS_RETAINED;
 extern CGImageRef __nullable webpCreateScaledCGImage(CGImageRef __nonnull sourceImg, CGSize size) CF_RETURNS_RETAINED;
 
 extern BOOL webpCGImageContainsAlpha(CGImageRef __nonnull const cgImage);
 
+// Fills the picture ARGB plane at `targetSize`, or at the image size for CGSizeZero.
+extern BOOL webpImportCGImage(CGImageRef __nonnull imageRef, WebPPicture * __nonnull picture, CGSize targetSize);
+// Same as `webpImportCGImage`, keeps the ARGB plane of a picture of the same size and the bitmap
+// context of the conversion in `cachedContext`. The caller releases the context.
+extern BOOL webpImportCGImageWithContext(CGImageRef __nonnull imageRef,
+                                         WebPPicture * __nonnull picture,
+                                         CGSize targetSize,
+                                         CGContextRef __nullable * __nullable cachedContext);
+extern CGSize webpEncoderTargetSize(CGSize size, WIKEncoderConfig * const __nonnull config);
+
+// Applies the rate control of the config when it has a target file size.
+extern BOOL webpEncodePicture(WebPPicture * __nonnull picture,
+                              WIKEncoderConfig * const __nonnull config,
+                              WebPWriterFunction __nonnull writer,
+                              void * __nullable customPtr);
+// Same as `webpEncodePicture` with the libwebp configuration already set up from the config.
+extern BOOL webpEncodePictureWithConfig(WebPPicture * __nonnull picture,
+                                        const WebPConfig * __nonnull webpConfig,
+                                        WIKEncoderConfig * const __nonnull config,
+                                        WebPWriterFunction __nonnull writer,
+                                        void * __nullable customPtr);
+extern BOOL webpEncodeCGImage(CGImageRef __nonnull imageRef,
+                              WIKEncoderConfig * const __nonnull config,
+                              WebPWriterFunction __nonnull writer,
+                              void * __nullable customPtr);
+/**
+ * Creates a temporary file next to `path` for writing, its mode is 0666 limited by the umask.
+ * The name is stored to `tmpPath`, which must be freed with free().
+ *
+ * @return File descriptor, or -1 on failure.
+ */
+extern int webpCreateTemporaryFile(const char * __nonnull path, char * __nullable * __nonnull tmpPath);
+
+/**
+ * Replaces the file at `path` with the written temporary file, closes the descriptor and removes
+ * the temporary file on failure. `result` tells whether the temporary file was written completely.
+ */
+extern BOOL webpCommitTemporaryFile(int fd, const char * __nonnull tmpPath, const char * __nonnull path, BOOL result);
+extern BOOL webpWriteCGImageToFile(CGImageRef __nonnull imageRef,
+                                   WIKEncoderConfig * const __nonnull config,
+                                   NSString * __nonnull path);
+
+extern CFDataRef __nullable webpCreateDataFromPicture(WebPPicture * __nonnull picture,
+                                                     WIKEncoderConfig * const __nonnull config) CF_RETURNS_RETAINED;
 extern CFDataRef __nullable webpCreateDataFromCGImage(CGImageRef __nonnull imageRef,
                                                      WIKEncoderConfig * const __nonnull config) CF_RETURNS_RETAINED;
+extern NSArray<NSData *> * __nullable webpDataRenditionsFromCGImage(CGImageRef __nonnull imageRef,
+                                                                    NSArray<WIKEncoderConfig *> * const __nonnull configs);
 
 #endif /* CoreGraphics_WebP_h */
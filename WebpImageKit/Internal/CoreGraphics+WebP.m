@@ -9,8 +9,17 @@
 #import <Foundation/Foundation.h>
 #import <Accelerate/Accelerate.h>
 #import <UIKit/UIKit.h>
+#import <fcntl.h>
+#import <stdatomic.h>
+#import <sys/stat.h>
 
 #import "CoreGraphics+WebP.h"
+#import "WebpBufferPool.h"
+#import "WebpMemoryBudget.h"
+#import "WebpMetrics.h"
+#import "WebpModeSelection.h"
+#import "WebpPixelConverter.h"
+#import "WebpRateControl.h"
 #import "WebpImageKitMacro.h"
 #import "WIKEncoderConfig+Internal.h"
 
@@ -23,16 +32,57 @@ CGColorSpaceRef __nonnull webpSharedDeviceColorSpace(void) {
     return colorSpace;
 }
 
-NS_INLINE size_t webpByteAlign(size_t size, size_t alignment) {
-    return ((size + (alignment - 1)) / alignment) * alignment;
+static void ReleasePooledBuffer(void *info, const void *data, __unused size_t size) {
+    webpBufferPoolRelease((uint8_t *) data, (size_t) (uintptr_t) info);
 }
 
-static void FreeWebpOutputBuffer(__unused void *info, const void *data, __unused size_t size) {
-    if (!data) { return; }
-    free((void *) data);
+uint8_t * __nullable webpAcquirePooledBuffer(size_t size, size_t * __nonnull capacity) {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        // Cached buffers are the first thing to give back when the system is low on memory.
+        [NSNotificationCenter.defaultCenter addObserverForName:UIApplicationDidReceiveMemoryWarningNotification
+                                                        object:nil
+                                                         queue:nil
+                                                    usingBlock:^(__unused NSNotification *notification) {
+            webpBufferPoolPurge();
+        }];
+    });
+    return webpBufferPoolAcquire(size, capacity);
+}
+
+size_t webpImageMemorySize(CGSize size, size_t count) {
+    return webpByteAlign((size_t) size.width * 4, 64) * (size_t) size.height * count;
+}
+
+CGSize webpReserveImageMemory(CGSize size, size_t count, BOOL canDownscale, size_t * __nonnull reserved) {
+    const size_t requested = webpImageMemorySize(size, count);
+    const size_t granted = webpMemoryBudgetReserve(requested, canDownscale ? requested / 16 : requested);
+    *reserved = granted;
+    if (0 == granted) {
+        return CGSizeZero;
+    }
+    if (granted >= requested) {
+        return size;
+    }
+    // The area follows the granted memory, row padding may take a few more pixels off.
+    const double factor = sqrt((double) granted / (double) requested);
+    __auto_type result = CGSizeMake(MAX(floor(size.width * factor), 1), MAX(floor(size.height * factor), 1));
+    while (webpImageMemorySize(result, count) > granted && (1 < result.width || 1 < result.height)) {
+        result = CGSizeMake(MAX(result.width - 1, 1), MAX(result.height - 1, 1));
+    }
+    const size_t used = webpImageMemorySize(result, count);
+    if (used < granted) {
+        webpMemoryBudgetRelease(granted - used);
+        *reserved = used;
+    }
+    return result;
 }
 
 CGColorSpaceRef __nonnull webpCreateColorSpace(WebPDemuxer * __nonnull demuxer) CF_RETURNS_RETAINED {
+    const uint64_t metricsStart = webpMetricsStageBegin();
+    @webp_defer {
+        webpMetricsStageEnd(WebpMetricsStageColorSpace, metricsStart, 0);
+    };
     CGColorSpaceRef colorSpace = NULL;
     uint32_t flags = WebPDemuxGetI(demuxer, WEBP_FF_FORMAT_FLAGS);
     if (flags & ICCP_FLAG) {
@@ -59,54 +109,194 @@ CGColorSpaceRef __nonnull webpCreateDeviceRgbColorSpace(void) CF_RETURNS_RETAINE
     return webpSharedDeviceColorSpace();
 }
 
+// Sets up cropping and scaling, returns the size of the decoded image.
+static BOOL webpSetupDecoderOptions(WebPDecoderConfig * __nonnull config,
+                                    CGRect cropRect,
+                                    CGSize targetSize,
+                                    size_t * __nonnull width,
+                                    size_t * __nonnull height) {
+    WebpCodecRect crop = {0};
+    if (!CGRectIsNull(cropRect)) {
+        const CGRect imageRect = CGRectMake(0, 0, config->input.width, config->input.height);
+        const CGRect bounds = CGRectIntegral(CGRectIntersection(cropRect, imageRect));
+        if (CGRectIsEmpty(bounds)) {
+            return NO;
+        }
+        crop = (WebpCodecRect) {
+                .x = (size_t) bounds.origin.x,
+                .y = (size_t) bounds.origin.y,
+                .width = (size_t) bounds.size.width,
+                .height = (size_t) bounds.size.height
+        };
+    }
+    const BOOL hasTargetSize = 0 < targetSize.width && 0 < targetSize.height;
+    return 0 != webpCodecSetupDecoder(config, CGRectIsNull(cropRect) ? NULL : &crop,
+                                      hasTargetSize ? (size_t) trunc(targetSize.width) : 0,
+                                      hasTargetSize ? (size_t) trunc(targetSize.height) : 0,
+                                      width, height);
+}
+
+static BOOL webpDecodeWithConfig(WebPData webpData,
+                                 WebPDecoderConfig * __nonnull config,
+                                 size_t width,
+                                 size_t height,
+                                 uint8_t * __nonnull pixels,
+                                 size_t stride) {
+    return 0 != webpCodecDecode(webpData.bytes, webpData.size, config, MODE_bgrA, width, height, pixels, stride);
+}
+
 CGImageRef __nullable webpCreateCGImage(WebPData webpData,
                                         CGColorSpaceRef __nonnull colorSpace,
                                         CGSize targetSize) CF_RETURNS_RETAINED {
+    return webpCreateCGImageWithRect(webpData, colorSpace, CGRectNull, targetSize);
+}
+
+CGImageRef __nullable webpCreateCGImageWithRect(WebPData webpData,
+                                                CGColorSpaceRef __nonnull colorSpace,
+                                                CGRect cropRect,
+                                                CGSize targetSize) CF_RETURNS_RETAINED {
     WebPDecoderConfig config;
-    if (!WebPInitDecoderConfig(&config)) {
+    if (!WebPInitDecoderConfig(&config)
+            || VP8_STATUS_OK != WebPGetFeatures(webpData.bytes, webpData.size, &config.input)) {
         return NULL;
     }
-    if (VP8_STATUS_OK != WebPGetFeatures(webpData.bytes, webpData.size, &config.input)) {
+    size_t width, height;
+    if (!webpSetupDecoderOptions(&config, cropRect, targetSize, &width, &height)) {
         return NULL;
     }
-    CGBitmapInfo bitmapInfo = kCGBitmapByteOrder32Host;
-    bitmapInfo |= config.input.has_alpha ? kCGImageAlphaPremultipliedFirst : kCGImageAlphaNoneSkipFirst;
-    config.options.use_threads = 1;
-    config.output.colorspace = MODE_bgrA;
-    if (0 < targetSize.width && 0 < targetSize.height) {
-        config.options.use_scaling = 1;
-        config.options.scaled_width = (int)trunc(targetSize.width);
-        config.options.scaled_height = (int)trunc(targetSize.height);
+    // The reservation covers the decode, the image memory belongs to the caller afterwards.
+    size_t reserved;
+    const __auto_type requestedSize = CGSizeMake(width, height);
+    const __auto_type size = webpReserveImageMemory(requestedSize, 1, YES, &reserved);
+    @webp_defer {
+        webpMemoryBudgetRelease(reserved);
+    };
+    if (0 == reserved
+            || (!CGSizeEqualToSize(size, requestedSize)
+                && !webpSetupDecoderOptions(&config, cropRect, size, &width, &height))) {
+        return NULL;
+    }
+    // libwebp decodes into a pooled buffer instead of allocating its own, the buffer returns
+    // to the pool when the image is released.
+    const size_t stride = webpByteAlign(width * 4, 64);
+    size_t capacity;
+    uint8_t *pixels = webpAcquirePooledBuffer(stride * height, &capacity);
+    if (!pixels) {
+        return NULL;
+    }
+    if (!webpDecodeWithConfig(webpData, &config, width, height, pixels, stride)) {
+        webpBufferPoolRelease(pixels, capacity);
+        return NULL;
+    }
+    return webpCreateCGImageWithPooledBuffer(pixels, capacity, width, height, stride, config.input.has_alpha, colorSpace);
+}
+
+BOOL webpDecodeIntoBuffer(WebPData webpData,
+                          CGSize targetSize,
+                          uint8_t * __nonnull pixels,
+                          size_t stride) {
+    return webpDecodeRectIntoBuffer(webpData, CGRectNull, targetSize, pixels, stride);
+}
+
+BOOL webpDecodeRectIntoBuffer(WebPData webpData,
+                              CGRect cropRect,
+                              CGSize targetSize,
+                              uint8_t * __nonnull pixels,
+                              size_t stride) {
+    WebPDecoderConfig config;
+    if (!WebPInitDecoderConfig(&config)
+            || VP8_STATUS_OK != WebPGetFeatures(webpData.bytes, webpData.size, &config.input)) {
+        return NO;
+    }
+    size_t width, height;
+    if (!webpSetupDecoderOptions(&config, cropRect, targetSize, &width, &height)) {
+        return NO;
+    }
+    return webpDecodeWithConfig(webpData, &config, width, height, pixels, stride);
+}
+
+BOOL webpDecodeIntoYuvBuffer(WebPData webpData,
+                             CGSize targetSize,
+                             const WebPYUVABuffer * __nonnull buffer) {
+    WebPDecoderConfig config;
+    if (!WebPInitDecoderConfig(&config)
+            || VP8_STATUS_OK != WebPGetFeatures(webpData.bytes, webpData.size, &config.input)) {
+        return NO;
     }
+    size_t width, height;
+    if (!webpSetupDecoderOptions(&config, CGRectNull, targetSize, &width, &height)) {
+        return NO;
+    }
+    return 0 != webpCodecDecodeYuv(webpData.bytes, webpData.size, &config, buffer);
+}
 
-    if (VP8_STATUS_OK != WebPDecode(webpData.bytes, webpData.size, &config)) {
+CGImageRef __nullable webpCreateCGImageFromBuffer(const uint8_t * __nonnull pixels,
+                                                  size_t width,
+                                                  size_t height,
+                                                  size_t stride,
+                                                  BOOL hasAlpha,
+                                                  CGColorSpaceRef __nonnull colorSpace) CF_RETURNS_RETAINED {
+    if (!pixels || 0 == width || 0 == height) {
+        return NULL;
+    }
+    const size_t bytesPerRow = webpByteAlign(width * 4, 64);
+    size_t capacity;
+    uint8_t *copy = webpAcquirePooledBuffer(bytesPerRow * height, &capacity);
+    if (!copy) {
         return NULL;
     }
+    if (bytesPerRow == stride) {
+        memcpy(copy, pixels, bytesPerRow * height);
+    }
+    else {
+        for (size_t rowIdx = 0; rowIdx < height; ++rowIdx) {
+            memcpy(copy + rowIdx * bytesPerRow, pixels + rowIdx * stride, width * 4);
+        }
+    }
+    return webpCreateCGImageWithPooledBuffer(copy, capacity, width, height, bytesPerRow, hasAlpha, colorSpace);
+}
 
-    __auto_type dataProvider = CGDataProviderCreateWithData(&config.output,
-                                                            config.output.u.RGBA.rgba,
-                                                            config.output.u.RGBA.size,
-                                                            FreeWebpOutputBuffer);
-    size_t bitsPerComponent = 8;
-    size_t bitsPerPixel = 32;
-    size_t bytesPerRow = (size_t) config.output.u.RGBA.stride;
-    size_t width = (size_t) config.output.width;
-    size_t height = (size_t) config.output.height;
-    CGColorRenderingIntent renderingIntent = kCGRenderingIntentDefault;
+// Consumes the data provider.
+static CGImageRef __nullable webpCreateCGImageWithProvider(CGDataProviderRef __nonnull dataProvider,
+                                                           size_t width,
+                                                           size_t height,
+                                                           size_t stride,
+                                                           BOOL hasAlpha,
+                                                           CGColorSpaceRef __nonnull colorSpace) CF_RETURNS_RETAINED {
+    CGBitmapInfo bitmapInfo = kCGBitmapByteOrder32Host;
+    bitmapInfo |= hasAlpha ? kCGImageAlphaPremultipliedFirst : kCGImageAlphaNoneSkipFirst;
     CGImageRef image = CGImageCreate(width, height,
-                                     bitsPerComponent,
-                                     bitsPerPixel,
-                                     bytesPerRow,
+                                     8,
+                                     32,
+                                     stride,
                                      colorSpace,
                                      bitmapInfo,
                                      dataProvider,
                                      NULL,
                                      NO,
-                                     renderingIntent);
+                                     kCGRenderingIntentDefault);
     CGDataProviderRelease(dataProvider);
     return image;
 }
 
+CGImageRef __nullable webpCreateCGImageWithPooledBuffer(uint8_t * __nonnull pixels,
+                                                        size_t capacity,
+                                                        size_t width,
+                                                        size_t height,
+                                                        size_t stride,
+                                                        BOOL hasAlpha,
+                                                        CGColorSpaceRef __nonnull colorSpace) CF_RETURNS_RETAINED {
+    __auto_type dataProvider = CGDataProviderCreateWithData((void *) (uintptr_t) capacity,
+                                                            pixels,
+                                                            stride * height,
+                                                            ReleasePooledBuffer);
+    if (!dataProvider) {
+        webpBufferPoolRelease(pixels, capacity);
+        return NULL;
+    }
+    return webpCreateCGImageWithProvider(dataProvider, width, height, stride, hasAlpha, colorSpace);
+}
+
 CGImageRef __nullable webpCreateScaledCGImage(CGImageRef __nonnull sourceImg, CGSize size) CF_RETURNS_RETAINED {
     NSCParameterAssert(sourceImg);
     __auto_type width = CGImageGetWidth(sourceImg);
@@ -116,7 +306,9 @@ CGImageRef __nullable webpCreateScaledCGImage(CGImageRef __nonnull sourceImg, CG
         return sourceImg;
     }
     __block vImage_Buffer input_buffer = {}, output_buffer = {};
+    const uint64_t metricsStart = webpMetricsStageBegin();
     @webp_defer {
+        webpMetricsStageEnd(WebpMetricsStageRescale, metricsStart, output_buffer.rowBytes * output_buffer.height);
         if (input_buffer.data) free(input_buffer.data);
         if (output_buffer.data) free(output_buffer.data);
     };
@@ -171,109 +363,313 @@ BOOL webpCGImageContainsAlpha(CGImageRef __nonnull const cgImage) {
     return webpHasAlpha(CGImageGetAlphaInfo(cgImage));
 }
 
-CFDataRef __nullable webpCreateDataFromCGImage(CGImageRef __nonnull imageRef,
-                                              WIKEncoderConfig * const __nonnull config) CF_RETURNS_RETAINED {
-    const size_t width = CGImageGetWidth(imageRef);
-    const size_t height = CGImageGetHeight(imageRef);
-    if (0 >= width || 0 >= height || !config) {
-        return NULL;
+NS_INLINE int webpComponentOffset(int index, BOOL isReversed) {
+    return isReversed ? 3 - index : index;
+}
+
+// WebP files carry no ICC profile here, so only pixels already in sRGB are written as they are.
+static BOOL webpIsSRGBColorSpace(CGColorSpaceRef __nullable colorSpace) {
+    static dispatch_once_t onceToken;
+    static CGColorSpaceRef deviceColorSpace = NULL;
+    dispatch_once(&onceToken, ^{
+        deviceColorSpace = CGColorSpaceCreateDeviceRGB();
+    });
+    if (!colorSpace || kCGColorSpaceModelRGB != CGColorSpaceGetModel(colorSpace)) {
+        return NO;
     }
-    size_t bytesPerRow = CGImageGetBytesPerRow(imageRef);
-    const size_t bitsPerComponent = CGImageGetBitsPerComponent(imageRef);
-    const size_t bitsPerPixel = CGImageGetBitsPerPixel(imageRef);
-    const size_t components = bitsPerPixel / bitsPerComponent;
-    __auto_type bitmapInfo = CGImageGetBitmapInfo(imageRef);
+    if (CFEqual(colorSpace, webpSharedDeviceColorSpace()) || CFEqual(colorSpace, deviceColorSpace)) {
+        return YES;
+    }
+    CFStringRef name = CGColorSpaceCopyName(colorSpace);
+    const BOOL isSRGB = name && CFEqual(name, kCGColorSpaceSRGB);
+    if (name) {
+        CFRelease(name);
+    }
+    return isSRGB;
+}
+
+// Describes the native bitmap layout of the image, if its pixels can be read without conversion.
+static BOOL webpGetPixelLayout(CGImageRef __nonnull imageRef, WebpPixelLayout * __nonnull layout) {
+    const __auto_type bitmapInfo = CGImageGetBitmapInfo(imageRef);
     const CGImageAlphaInfo alphaInfo = (CGImageAlphaInfo) (bitmapInfo & kCGBitmapAlphaInfoMask);
     const CGBitmapInfo byteOrderInfo = bitmapInfo & kCGBitmapByteOrderMask;
-    const BOOL hasAlpha = webpHasAlpha(alphaInfo);
-    BOOL byteOrderNormal;
-    switch (byteOrderInfo) {
-        case kCGBitmapByteOrderDefault:
-            byteOrderNormal = YES;
+    const size_t bitsPerPixel = CGImageGetBitsPerPixel(imageRef);
+    CGColorSpaceRef colorSpace = CGImageGetColorSpace(imageRef);
+    if (8 != CGImageGetBitsPerComponent(imageRef)
+            || (bitmapInfo & kCGBitmapFloatComponents)
+            || !webpIsSRGBColorSpace(colorSpace)
+            || CGImageGetDecode(imageRef)) {
+        return NO;
+    }
+    if (24 == bitsPerPixel) {
+        if (kCGImageAlphaNone != alphaInfo || kCGBitmapByteOrder32Little == byteOrderInfo) {
+            return NO;
+        }
+        *layout = (WebpPixelLayout) { .bytesPerPixel = 3, .red = 0, .green = 1, .blue = 2, .alpha = -1 };
+        return YES;
+    }
+    if (32 != bitsPerPixel
+            || (kCGBitmapByteOrderDefault != byteOrderInfo
+                && kCGBitmapByteOrder32Big != byteOrderInfo
+                && kCGBitmapByteOrder32Little != byteOrderInfo)) {
+        return NO;
+    }
+    // Component order of the 32-bit word, little-endian words are stored in reverse.
+    int alpha, red;
+    switch (alphaInfo) {
+        case kCGImageAlphaPremultipliedFirst:
+        case kCGImageAlphaFirst:
+        case kCGImageAlphaNoneSkipFirst:
+            alpha = 0;
+            red = 1;
             break;
-        case kCGBitmapByteOrder32Big:
-            byteOrderNormal = YES;
+        case kCGImageAlphaPremultipliedLast:
+        case kCGImageAlphaLast:
+        case kCGImageAlphaNoneSkipLast:
+            red = 0;
+            alpha = 3;
             break;
-        case kCGBitmapByteOrder32Little:
         default:
-            byteOrderNormal = NO;
-            break;
+            return NO;
     }
-    CGDataProviderRef dataProvider = CGImageGetDataProvider(imageRef);
-    if (!dataProvider) {
-        return NULL;
+    const BOOL isReversed = kCGBitmapByteOrder32Little == byteOrderInfo;
+    *layout = (WebpPixelLayout) {
+            .bytesPerPixel = 4,
+            .red = webpComponentOffset(red, isReversed),
+            .green = webpComponentOffset(red + 1, isReversed),
+            .blue = webpComponentOffset(red + 2, isReversed),
+            .alpha = webpHasAlpha(alphaInfo) ? webpComponentOffset(alpha, isReversed) : -1,
+            .isPremultiplied = kCGImageAlphaPremultipliedFirst == alphaInfo || kCGImageAlphaPremultipliedLast == alphaInfo
+    };
+    return YES;
+}
+
+// Scales and converts the image right into the picture memory. CoreGraphics handles any source
+// layout and converts any color space to sRGB, ARGB words in host order match the 32-bit host byte order.
+// The context is kept in `cachedContext`, if given, and reused while it draws into the same picture memory.
+static BOOL webpDrawCGImageIntoPicture(CGImageRef __nonnull imageRef,
+                                       WebPPicture * __nonnull picture,
+                                       CGContextRef __nullable * __nullable cachedContext) {
+    const size_t width = (size_t) picture->width;
+    const size_t height = (size_t) picture->height;
+    const size_t bytesPerRow = (size_t) picture->argb_stride * 4;
+    CGColorSpaceRef colorSpace = webpSharedDeviceColorSpace();
+    CGContextRef context = cachedContext ? *cachedContext : NULL;
+    if (context && (CGBitmapContextGetData(context) != picture->argb
+            || CGBitmapContextGetWidth(context) != width
+            || CGBitmapContextGetHeight(context) != height
+            || CGBitmapContextGetBytesPerRow(context) != bytesPerRow
+            || !CFEqual(CGBitmapContextGetColorSpace(context), colorSpace))) {
+        CGContextRelease(context);
+        context = NULL;
     }
-    CGColorSpaceRef colorSpace = CGImageGetColorSpace(imageRef);
-    BOOL isRGB = CGColorSpaceGetModel(colorSpace) == kCGColorSpaceModelRGB;
-    CFDataRef dataRef;
-    uint8_t *rgba = NULL;
-    BOOL isRGB888 = isRGB && byteOrderNormal && alphaInfo == kCGImageAlphaNone && components == 3;
-    BOOL isRGBA8888 = isRGB && byteOrderNormal && alphaInfo == kCGImageAlphaLast && components == 4;
-    if (isRGB888 || isRGBA8888) {
-        if (!(dataRef = CGDataProviderCopyData(dataProvider))) {
-            return NULL;
+    if (!context) {
+        context = CGBitmapContextCreate(picture->argb, width, height, 8, bytesPerRow, colorSpace,
+                                        kCGBitmapByteOrder32Host | kCGImageAlphaPremultipliedFirst);
+        if (!context) {
+            if (cachedContext) *cachedContext = NULL;
+            return NO;
         }
-        rgba = (uint8_t *)CFDataGetBytePtr(dataRef);
+        // The picture memory isn't initialized, so pixels are copied instead of blended.
+        CGContextSetBlendMode(context, kCGBlendModeCopy);
+        CGContextSetInterpolationQuality(context, kCGInterpolationHigh);
+    }
+    CGContextDrawImage(context, CGRectMake(0, 0, width, height), imageRef);
+    if (cachedContext) {
+        *cachedContext = context;
     }
     else {
-        vImageConverterRef convertor = NULL;
-        vImage_Error error = kvImageNoError;
-
-        vImage_CGImageFormat srcFormat = {
-                .bitsPerComponent = (uint32_t)bitsPerComponent,
-                .bitsPerPixel = (uint32_t)bitsPerPixel,
-                .colorSpace = colorSpace,
-                .bitmapInfo = bitmapInfo,
-                .renderingIntent = CGImageGetRenderingIntent(imageRef)
-        };
-        vImage_CGImageFormat destFormat = {
-                .bitsPerComponent = 8,
-                .bitsPerPixel = hasAlpha ? 32 : 24,
-                .colorSpace = webpSharedDeviceColorSpace(),
-                .bitmapInfo = (CGBitmapInfo) ((hasAlpha ? kCGImageAlphaLast : kCGImageAlphaNone) | kCGBitmapByteOrderDefault)
-        };
-        convertor = vImageConverter_CreateWithCGImageFormat(&srcFormat, &destFormat, NULL, kvImageNoFlags, &error);
-        if (!convertor || kvImageNoError != error) {
-            return NULL;
-        }
-        @webp_defer {
-            vImageConverter_Release(convertor);
-        };
-        vImage_Buffer src;
-        if (kvImageNoError != vImageBuffer_InitWithCGImage(&src, &srcFormat, nil, imageRef, kvImageNoFlags)) {
-            return NULL;
-        }
-        vImage_Buffer dest;
-        @webp_defer {
-            free(src.data);
-        };
-        if (kvImageNoError != vImageBuffer_Init(&dest, height, width, destFormat.bitsPerPixel, kvImageNoFlags)) {
-            return NULL;
-        }
-        if (kvImageNoError != vImageConvert_AnyToAny(convertor, &src, &dest, NULL, kvImageNoFlags)) {
-            return NULL;
-        }
-        rgba = dest.data;
-        bytesPerRow = dest.rowBytes;
-        dataRef = CFDataCreateWithBytesNoCopy(kCFAllocatorDefault, rgba, bytesPerRow * height, kCFAllocatorDefault);
+        CGContextRelease(context);
     }
-    @webp_defer {
-        CFRelease(dataRef);
-    };
+    if (webpCGImageContainsAlpha(imageRef)) {
+        // Bitmap contexts only support premultiplied alpha, WebP pictures expect straight alpha.
+        const WebpPixelLayout layout = { .bytesPerPixel = 4, .red = 2, .green = 1, .blue = 0, .alpha = 3, .isPremultiplied = 1 };
+        webpConvertPixelsToArgb((const uint8_t *) picture->argb, bytesPerRow, &layout,
+                                picture->argb, (size_t) picture->argb_stride, width, height);
+    }
+    return YES;
+}
+
+BOOL webpImportCGImage(CGImageRef __nonnull imageRef, WebPPicture * __nonnull picture, CGSize targetSize) {
+    return webpImportCGImageWithContext(imageRef, picture, targetSize, NULL);
+}
+
+BOOL webpImportCGImageWithContext(CGImageRef __nonnull imageRef,
+                                  WebPPicture * __nonnull picture,
+                                  CGSize targetSize,
+                                  CGContextRef __nullable * __nullable cachedContext) {
+    const size_t sourceWidth = CGImageGetWidth(imageRef);
+    const size_t sourceHeight = CGImageGetHeight(imageRef);
+    if (0 >= sourceWidth || 0 >= sourceHeight || !picture) {
+        return NO;
+    }
+    size_t width = sourceWidth;
+    size_t height = sourceHeight;
+    if (0 < targetSize.width && 0 < targetSize.height) {
+        width = (size_t) trunc(targetSize.width);
+        height = (size_t) trunc(targetSize.height);
+    }
+    if (0 == width || 0 == height) {
+        return NO;
+    }
+    if (!webpCodecPreparePicture(picture, width, height)) {
+        return NO;
+    }
+    WebpPixelLayout layout;
+    CGDataProviderRef dataProvider;
+    if (width != sourceWidth || height != sourceHeight
+            || !webpGetPixelLayout(imageRef, &layout)
+            || !(dataProvider = CGImageGetDataProvider(imageRef))) {
+        // Images are downscaled while they are converted, the full size picture never exists.
+        const uint64_t metricsStart = webpMetricsStageBegin();
+        const BOOL result = webpDrawCGImageIntoPicture(imageRef, picture, cachedContext);
+        webpMetricsStageEnd(WebpMetricsStageImport, metricsStart, width * height * 4);
+        return result;
+    }
+    // For bitmaps backed by immutable data the copy only retains the bytes.
+    CFDataRef dataRef;
+    if (!(dataRef = CGDataProviderCopyData(dataProvider))) {
+        return NO;
+    }
+    const size_t bytesPerRow = CGImageGetBytesPerRow(imageRef);
+    const BOOL isComplete = (size_t) CFDataGetLength(dataRef) >= bytesPerRow * (height - 1) + width * layout.bytesPerPixel;
+    if (isComplete) {
+        webpCodecImportPixels(picture, CFDataGetBytePtr(dataRef), bytesPerRow, &layout);
+    }
+    CFRelease(dataRef);
+    return isComplete;
+}
+
+CGSize webpEncoderTargetSize(CGSize size, WIKEncoderConfig * const __nonnull config) {
+    if (!config.maxPixelSize) {
+        return size;
+    }
+    __auto_type maxSize = [config.maxPixelSize CGSizeValue];
+    __auto_type currentRatio = size.width / size.height;
+    __auto_type maxRatio = maxSize.width / maxSize.height;
+    CGFloat targetWidth, targetHeight;
+    if (currentRatio > maxRatio) {
+        targetWidth = MIN(size.width, maxSize.width);
+        targetHeight = ceil(targetWidth / currentRatio);
+    }
+    else {
+        targetHeight = MIN(size.height, maxSize.height);
+        targetWidth = ceil(targetHeight * currentRatio);
+    }
+    return CGSizeMake(targetWidth, targetHeight);
+}
+
+BOOL webpEncodePicture(WebPPicture * __nonnull picture,
+                       WIKEncoderConfig * const __nonnull config,
+                       WebPWriterFunction __nonnull writer,
+                       void * __nullable customPtr) {
     WebPConfig webpConfig;
     if (![config setupWebpEncoderConfiguration:&webpConfig]) {
-        return NULL;
+        return NO;
+    }
+    return webpEncodePictureWithConfig(picture, &webpConfig, config, writer, customPtr);
+}
+
+// Passes the output encoded in memory to the writer, the passes which produced it are the encode stage.
+static BOOL webpWriteEncodedOutput(WebPPicture * __nonnull picture,
+                                   WebPMemoryWriter * __nonnull output,
+                                   uint64_t metricsStart,
+                                   WebPWriterFunction __nonnull writer,
+                                   void * __nullable customPtr) {
+    webpMetricsStageEnd(WebpMetricsStageEncode, metricsStart, output->size);
+    picture->writer = writer;
+    picture->custom_ptr = customPtr;
+    const BOOL result = 0 != writer(output->mem, output->size, picture);
+    WebPMemoryWriterClear(output);
+    return result;
+}
+
+BOOL webpEncodePictureWithConfig(WebPPicture * __nonnull picture,
+                                 const WebPConfig * __nonnull webpConfig,
+                                 WIKEncoderConfig * const __nonnull config,
+                                 WebPWriterFunction __nonnull writer,
+                                 void * __nullable customPtr) {
+    const uint64_t metricsStart = webpMetricsStageBegin();
+    WebPConfig modeConfig;
+    if (WIKEncoderModeAuto == config.mode) {
+        // The rate control works with lossy compression only.
+        const __auto_type content = 0 < webpConfig->target_size
+                ? WebpPictureContentNatural
+                : webpClassifyPictureContent(picture);
+        if (WebpPictureContentMixed == content) {
+            WebPMemoryWriter output;
+            const float minPSNR = 0 < webpConfig->target_PSNR ? webpConfig->target_PSNR : WEBP_AUTO_MODE_MIN_PSNR;
+            if (!webpEncodePictureWithModeTrials(picture, webpConfig, minPSNR, &output)) {
+                return NO;
+            }
+            return webpWriteEncodedOutput(picture, &output, metricsStart, writer, customPtr);
+        }
+        modeConfig = *webpConfig;
+        modeConfig.lossless = WebpPictureContentSynthetic == content ? 1 : 0;
+        webpConfig = &modeConfig;
+    }
+    const BOOL isPredictive = 0 < webpConfig->target_size
+            && !webpConfig->lossless
+            && WIKRateControlPredictive == config.rateControl;
+    if (!isPredictive) {
+        return 0 != webpCodecEncode(webpConfig, picture, writer, customPtr);
     }
+    // Passes of the rate control are encoded in memory, only the accepted one reaches the writer.
+    WebPMemoryWriter output;
+    const float tolerance = config.fileSizeTolerance ? config.fileSizeTolerance.floatValue : 0.1f;
+    if (!webpEncodePictureToTargetSize(picture, webpConfig, config->_contentHint, tolerance, &output)) {
+        return NO;
+    }
+    return webpWriteEncodedOutput(picture, &output, metricsStart, writer, customPtr);
+}
 
+BOOL webpEncodeCGImage(CGImageRef __nonnull imageRef,
+                       WIKEncoderConfig * const __nonnull config,
+                       WebPWriterFunction __nonnull writer,
+                       void * __nullable customPtr) {
+    const size_t width = CGImageGetWidth(imageRef);
+    const size_t height = CGImageGetHeight(imageRef);
+    if (0 >= width || 0 >= height || !config) {
+        return NO;
+    }
+    webpMetricsOperationBegin(WebpMetricsOperationEncode);
+    @webp_defer {
+        webpMetricsOperationEnd();
+    };
     WebPPicture *picture = calloc(1, sizeof(WebPPicture));
     if (!picture || !WebPPictureInit(picture)) {
         if (picture) free(picture);
-        return NULL;
+        return NO;
     }
     @webp_defer {
         WebPPictureFree(picture);
         free(picture);
     };
+    if (!webpImportCGImage(imageRef, picture, webpEncoderTargetSize(CGSizeMake(width, height), config))) {
+        return NO;
+    }
+    return webpEncodePicture(picture, config, writer, customPtr);
+}
+
+// The result takes over the writer memory, trimmed to the encoded size, instead of copying it.
+static CFDataRef __nullable webpCreateDataFromWriter(WebPMemoryWriter * __nonnull writer) CF_RETURNS_RETAINED {
+    if (0 == writer->size) {
+        return NULL;
+    }
+    uint8_t *bytes = realloc(writer->mem, writer->size) ?: writer->mem;
+    __auto_type dataRef = CFDataCreateWithBytesNoCopy(kCFAllocatorDefault, bytes, (CFIndex) writer->size, kCFAllocatorMalloc);
+    if (dataRef) {
+        writer->mem = NULL;
+        writer->size = 0;
+    }
+    else {
+        writer->mem = bytes;
+    }
+    return dataRef;
+}
+
+CFDataRef __nullable webpCreateDataFromCGImage(CGImageRef __nonnull imageRef,
+                                              WIKEncoderConfig * const __nonnull config) CF_RETURNS_RETAINED {
     WebPMemoryWriter *writer = calloc(1, sizeof(WebPMemoryWriter));
     if (!writer) {
         return NULL;
@@ -283,39 +679,181 @@ CFDataRef __nullable webpCreateDataFromCGImage(CGImageRef __nonnull imageRef,
         WebPMemoryWriterClear(writer);
         free(writer);
     };
-    picture->use_argb = 0;
-    picture->width = (int)width;
-    picture->height = (int)height;
-    picture->writer = WebPMemoryWrite;
-    picture->custom_ptr = writer;
-    if ((hasAlpha && !WebPPictureImportRGBA(picture, rgba, (int)bytesPerRow))
-        || (!hasAlpha && !WebPPictureImportRGB(picture, rgba, (int)bytesPerRow))) {
+    if (!webpEncodeCGImage(imageRef, config, WebPMemoryWrite, writer)) {
         return NULL;
     }
+    return webpCreateDataFromWriter(writer);
+}
+
+CFDataRef __nullable webpCreateDataFromPicture(WebPPicture * __nonnull picture,
+                                               WIKEncoderConfig * const __nonnull config) CF_RETURNS_RETAINED {
+    webpMetricsOperationBegin(WebpMetricsOperationEncode);
+    @webp_defer {
+        webpMetricsOperationEnd();
+    };
+    WebPMemoryWriter writer;
+    WebPMemoryWriterInit(&writer);
+    CFDataRef dataRef = NULL;
+    if (webpEncodePicture(picture, config, WebPMemoryWrite, &writer)) {
+        dataRef = webpCreateDataFromWriter(&writer);
+    }
+    WebPMemoryWriterClear(&writer);
+    return dataRef;
+}
 
-    if (config.maxPixelSize) {
-        __auto_type maxSize = [config.maxPixelSize CGSizeValue];
-        __auto_type currentRatio = width / height;
-        __auto_type maxRatio = maxSize.width / maxSize.height;
-        CGFloat targetWidth, targetHeight;
-        if (currentRatio > maxRatio) {
-            targetWidth = MIN(width, maxSize.width);
-            targetHeight = ceil(targetWidth / currentRatio);
+NSArray<NSData *> * __nullable webpDataRenditionsFromCGImage(CGImageRef __nonnull imageRef,
+                                                             NSArray<WIKEncoderConfig *> * const __nonnull configs) {
+    const NSUInteger count = configs.count;
+    const CGSize imageSize = CGSizeMake(CGImageGetWidth(imageRef), CGImageGetHeight(imageRef));
+    if (0 == count || 0 >= imageSize.width || 0 >= imageSize.height) {
+        return nil;
+    }
+    webpMetricsOperationBegin(WebpMetricsOperationEncode);
+    @webp_defer {
+        webpMetricsOperationEnd();
+    };
+    // Renditions are built from the largest to the smallest one.
+    CGSize *sizes = calloc(count, sizeof(CGSize));
+    NSUInteger *order = calloc(count, sizeof(NSUInteger));
+    WebPPicture *pictures = calloc(count, sizeof(WebPPicture));
+    CFDataRef *results = calloc(count, sizeof(CFDataRef));
+    @webp_defer {
+        for (NSUInteger idx = 0; idx < count && pictures; ++idx) {
+            WebPPictureFree(&pictures[idx]);
+        }
+        for (NSUInteger idx = 0; idx < count && results; ++idx) {
+            if (results[idx]) CFRelease(results[idx]);
         }
-        else {
-            targetHeight = MIN(height, maxSize.height);
-            targetWidth = ceil(targetHeight * currentRatio);
+        free(sizes);
+        free(order);
+        free(pictures);
+        free(results);
+    };
+    if (!sizes || !order || !pictures || !results) {
+        return nil;
+    }
+    for (NSUInteger idx = 0; idx < count; ++idx) {
+        sizes[idx] = webpEncoderTargetSize(imageSize, configs[idx]);
+        order[idx] = idx;
+        if (!WebPPictureInit(&pictures[idx])) {
+            return nil;
         }
-        __auto_type currentSize = CGSizeMake(width, height);
-        __auto_type targetSize = CGSizeMake(targetWidth, targetHeight);
-        if (!CGSizeEqualToSize(currentSize, targetSize)
-                && !WebPPictureRescale(picture, (int) targetSize.width, (int) targetSize.height)) {
-            return NULL;
+    }
+    qsort_b(order, count, sizeof(NSUInteger), ^int(const void *lhs, const void *rhs) {
+        const CGSize lhsSize = sizes[*(const NSUInteger *) lhs];
+        const CGSize rhsSize = sizes[*(const NSUInteger *) rhs];
+        const CGFloat lhsArea = lhsSize.width * lhsSize.height;
+        const CGFloat rhsArea = rhsSize.width * rhsSize.height;
+        return lhsArea > rhsArea ? -1 : (lhsArea < rhsArea ? 1 : 0);
+    });
+    // The image is imported and converted once, at the largest rendition size. Every next
+    // rendition is downscaled from the previous one, so each step works on fewer pixels.
+    if (!webpImportCGImage(imageRef, &pictures[order[0]], sizes[order[0]])) {
+        return nil;
+    }
+    for (NSUInteger step = 1; step < count; ++step) {
+        WebPPicture *source = &pictures[order[step - 1]];
+        WebPPicture *target = &pictures[order[step]];
+        const CGSize size = sizes[order[step]];
+        if (!webpCodecScalePicture(source, target, (int) size.width, (int) size.height)) {
+            return nil;
         }
     }
+    // The encoder converts pictures in place, so encoding starts only once all renditions are built.
+    atomic_bool isFailed = false;
+    atomic_bool * const failure = &isFailed;
+    dispatch_apply(count, dispatch_get_global_queue(qos_class_self(), 0), ^(size_t idx) {
+        @autoreleasepool {
+            if (!atomic_load(failure) && !(results[idx] = webpCreateDataFromPicture(&pictures[idx], configs[idx]))) {
+                atomic_store(failure, true);
+            }
+            WebPPictureFree(&pictures[idx]);
+        }
+    });
+    if (atomic_load(&isFailed)) {
+        return nil;
+    }
+    NSMutableArray<NSData *> *renditions = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger idx = 0; idx < count; ++idx) {
+        [renditions addObject:(__bridge NSData *) results[idx]];
+    }
+    return [renditions copy];
+}
 
-    if (!WebPEncode(&webpConfig, picture)) {
-        return NULL;
+static int webpFileWrite(const uint8_t *data, size_t dataSize, const WebPPicture *picture) {
+    const int fd = *(const int *) picture->custom_ptr;
+    while (0 < dataSize) {
+        const ssize_t written = write(fd, data, dataSize);
+        if (0 > written) {
+            if (EINTR == errno) continue;
+            return 0;
+        }
+        data += written;
+        dataSize -= (size_t) written;
     }
-    return CFDataCreate(CFAllocatorGetDefault(), writer->mem, writer->size);
+    return 1;
+}
+
+int webpCreateTemporaryFile(const char * __nonnull path, char * __nullable * __nonnull tmpPath) {
+    static const char kSuffixChars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    static const size_t kSuffixLength = 6;
+    const size_t pathLength = strlen(path);
+    if (!(*tmpPath = malloc(pathLength + 1 + kSuffixLength + 1))) {
+        return -1;
+    }
+    memcpy(*tmpPath, path, pathLength);
+    (*tmpPath)[pathLength] = '.';
+    (*tmpPath)[pathLength + 1 + kSuffixLength] = '\0';
+    // Unlike mkstemp, open(2) applies the umask to the mode, so a new destination gets the same
+    // mode as any other file the process creates.
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        for (size_t idx = 0; idx < kSuffixLength; ++idx) {
+            (*tmpPath)[pathLength + 1 + idx] = kSuffixChars[arc4random_uniform(sizeof(kSuffixChars) - 1)];
+        }
+        const int fd = open(*tmpPath, O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC, 0666);
+        if (0 <= fd || EEXIST != errno) {
+            if (0 > fd) {
+                free(*tmpPath);
+                *tmpPath = NULL;
+            }
+            return fd;
+        }
+    }
+    free(*tmpPath);
+    *tmpPath = NULL;
+    return -1;
+}
+
+BOOL webpCommitTemporaryFile(const int fd, const char * __nonnull tmpPath, const char * __nonnull path, BOOL result) {
+    // The replaced file keeps its mode, a new one has the mode the temporary file was created with.
+    // The data must reach the disk before the rename, otherwise a crash can leave a truncated destination.
+    if (result) {
+        struct stat destination;
+        if (0 == stat(path, &destination)) {
+            result = 0 == fchmod(fd, destination.st_mode & 07777);
+        }
+        result = result && 0 == fsync(fd);
+    }
+    result = (0 == close(fd)) && result;
+    if (!result || 0 != rename(tmpPath, path)) {
+        unlink(tmpPath);
+        return NO;
+    }
+    return YES;
+}
+
+BOOL webpWriteCGImageToFile(CGImageRef __nonnull imageRef,
+                            WIKEncoderConfig * const __nonnull config,
+                            NSString * __nonnull path) {
+    // Encoder output goes straight to a temporary file which replaces the destination on success.
+    char *tmpName = NULL;
+    int fd = webpCreateTemporaryFile(path.fileSystemRepresentation, &tmpName);
+    if (0 > fd) {
+        return NO;
+    }
+    @webp_defer {
+        free(tmpName);
+    };
+    const BOOL result = webpEncodeCGImage(imageRef, config, webpFileWrite, &fd);
+    return webpCommitTemporaryFile(fd, tmpName, path.fileSystemRepresentation, result);
 }
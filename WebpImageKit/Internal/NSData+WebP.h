@@ -10,6 +10,8 @@
 
 @interface NSData (WebP)
 
++ (nullable instancetype)webpDataWithContentsOfMappedFile:(nonnull NSString *)path;
+
 - (BOOL)webpIsImage;
 
 @end
@@ -7,21 +7,17 @@
 //
 
 #import "NSData+WebP.h"
+#import "WebpContainer.h"
 
 @implementation NSData (WebP)
 
++ (nullable instancetype)webpDataWithContentsOfMappedFile:(nonnull NSString *)path {
+    // The file is mapped read-only and decoders read the pages directly, without a copy.
+    return [self dataWithContentsOfFile:path options:NSDataReadingMappedAlways error:nil];
+}
+
 - (BOOL)webpIsImage {
-    if (12 > self.length) {
-        return NO;
-    }
-    uint8_t byte;
-    [self getBytes:&byte length:1];
-    if (0x52 != byte) {
-        return NO;
-    }
-    NSString *testString = [[NSString alloc] initWithData:[self subdataWithRange:NSMakeRange(0, 12)]
-                                                 encoding:NSASCIIStringEncoding];
-    return [testString hasPrefix:@"RIFF"] && [testString hasSuffix:@"WEBP"];
+    return 0 != webpContainerHasSignature(self.bytes, self.length);
 }
 
 @end
@@ -0,0 +1,34 @@
+//
+//  UIImage+WebP+Internal.h
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+#import "UIImage+WebP.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface UIImage (WebpDecoderInternal)
+
+/**
+ * Same as `webpImageWithData:displaySize:scaleFactor:loopCount:`, `isCancelled` is checked between
+ * animation frames and between data chunks of still images. Returns nil once cancelled.
+ */
++ (nullable instancetype)webpImageWithData:(NSData *const)data
+                               displaySize:(const CGSize)size
+                               scaleFactor:(const CGFloat)scaleFactor
+                                 loopCount:(NSUInteger * __nullable)loopCount
+                               isCancelled:(BOOL (^ __nullable)(void))isCancelled;
+
+/**
+ * YES if the memory governor decoded the image at a lower resolution than the scale factor asks for.
+ * Such images keep their size in points with a smaller scale.
+ */
+- (BOOL)webpIsDownscaledForScaleFactor:(const CGFloat)scaleFactor;
+
+@end
+
+NS_ASSUME_NONNULL_END
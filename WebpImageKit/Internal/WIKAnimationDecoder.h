@@ -0,0 +1,104 @@
+//
+//  WIKAnimationDecoder.h
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * Renders frames of a WebP image on demand. Keeps the demuxer over the compressed
+ * bytes and a single canvas; frames are composited only when requested.
+ * @warning Not thread-safe, callers are responsible for serializing access.
+ */
+@interface WIKAnimationDecoder : NSObject
+
+@property (nonatomic, readonly) NSData *data;
+@property (nonatomic, readonly) NSUInteger frameCount;
+@property (nonatomic, readonly) NSUInteger loopCount;
+@property (nonatomic, readonly) BOOL isAnimated;
+@property (nonatomic, readonly) BOOL hasAlpha;
+@property (nonatomic, readonly) CGSize canvasSize;
+/**
+ * Size of the output frames in pixels. Setting CGSizeZero resets it to the canvas size.
+ * Frames are decoded by libwebp right at the output scale and composited on a canvas of
+ * this size, so scaled output costs less than decoding at the canvas size.
+ */
+@property (nonatomic) CGSize outputSize;
+
+/**
+ * Creates decoder for the WebP data.
+ *
+ * @param data
+ *        Image data in WebP format. The decoder keeps a strong reference to it.
+ * @param targetSize
+ *        Size of the output frames in pixels. For CGSizeZero - uses the canvas size.
+ * @return New decoder or nil if data can't be demuxed.
+ */
+- (nullable instancetype)initWithData:(NSData *)data targetSize:(CGSize)targetSize NS_DESIGNATED_INITIALIZER;
+
+/**
+ * Duration of the frame in seconds.
+ */
+- (NSTimeInterval)durationAtIndex:(NSUInteger)index;
+
+/**
+ * Returns index of the nearest key frame at or before the given frame. Rendering of the frame
+ * starts from that key frame, so seeking costs at most the distance between key frames.
+ *
+ * @param index
+ *        Zero based frame index.
+ * @return Key frame index or NSNotFound if the index is out of bounds.
+ */
+- (NSUInteger)keyFrameIndexForIndex:(NSUInteger)index;
+
+/**
+ * Returns composited frame. Sequential access costs a single frame decode, random
+ * access decodes frames starting from the nearest key frame.
+ *
+ * @param index
+ *        Zero based frame index.
+ * @return An image object, or NULL if an error occurs. You are responsible for releasing this object using CFRelease.
+ */
+- (nullable CGImageRef)copyFrameAtIndex:(NSUInteger)index CF_RETURNS_RETAINED;
+
+/**
+ * Renders all frames in order. Fragments are decoded concurrently on worker threads a few frames
+ * ahead of the compositor, which blends them onto the canvas on the calling thread, so decoding
+ * a long animation scales with the number of cores. Frames which fail to decode are skipped.
+ *
+ * @param block
+ *        Called on the calling thread with each composited frame. The image is released after the
+ *        block returns, retain it to keep it. Set `stop` to YES to stop rendering.
+ * @return NO if the canvas can't be allocated.
+ */
+- (BOOL)enumerateFramesUsingBlock:(void (NS_NOESCAPE ^)(CGImageRef image, NSUInteger index, BOOL *stop))block;
+
+/**
+ * Reserves the decode memory budget for the canvas, the frames decoded ahead and `count` frames
+ * copied out of it. The output size shrinks when the budget grants less memory. Without
+ * a reservation the canvas is accounted when it is created. The reservation is released together
+ * with the canvas. Still images reserve their memory when the frame is decoded.
+ *
+ * @param count
+ *        Number of frames the caller keeps until the decode is done.
+ * @return NO if the budget is exhausted.
+ */
+- (BOOL)reserveMemoryForFrameCount:(NSUInteger)count;
+
+/**
+ * Releases the canvas. The next frame request renders from the nearest key frame.
+ */
+- (void)purgeCanvas;
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@end
+
+NS_ASSUME_NONNULL_END
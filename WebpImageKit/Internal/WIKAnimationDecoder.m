@@ -0,0 +1,291 @@
+//
+//  WIKAnimationDecoder.m
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#import "WIKAnimationDecoder.h"
+#import "CoreGraphics+WebP.h"
+#import "WebpBufferPool.h"
+#import "WebpCodec.h"
+#import "WebpMemoryBudget.h"
+#import "WebpMetrics.h"
+#import "WebpImageKitMacro.h"
+
+// Upper bound of the frames decoded ahead of the compositor, each of them holds a frame buffer.
+static const NSUInteger kWIKMaxDecodeLookahead = 8;
+
+// Fragment decoded ahead of the compositor. The worker fills the pixels and signals `_ready`.
+@interface WIKFrameDecodeSlot : NSObject {
+@public
+    uint8_t *_pixels;
+    size_t _capacity;
+    size_t _stride;
+    BOOL _isDecoded;
+    dispatch_semaphore_t _ready;
+}
+@end
+
+@implementation WIKFrameDecodeSlot
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _ready = dispatch_semaphore_create(0);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    webpBufferPoolRelease(_pixels, _capacity);
+}
+
+@end
+
+@implementation WIKAnimationDecoder {
+@private
+    // Frames are rendered by the core, the decoder only owns the canvas and its memory.
+    WebpCodecAnimation *_animation;
+    CGColorSpaceRef _colorSpace;
+    uint8_t *_canvas;
+    size_t _canvasCapacity;
+    size_t _canvasStride;
+    size_t _reservedMemory;
+}
+
+- (nullable instancetype)initWithData:(NSData *)data targetSize:(CGSize)targetSize {
+    if (!data.length) {
+        return nil;
+    }
+    if (self = [super init]) {
+        _data = data;
+        if (!(_animation = webpCodecAnimationCreate(data.bytes, data.length))) {
+            return nil;
+        }
+        WebpCodecAnimationInfo info;
+        webpCodecAnimationGetInfo(_animation, &info);
+        _isAnimated = 0 != info.isAnimated;
+        _hasAlpha = 0 != info.hasAlpha;
+        _loopCount = _isAnimated ? info.loopCount : NSNotFound;
+        _canvasSize = CGSizeMake(info.canvasWidth, info.canvasHeight);
+        _frameCount = info.frameCount;
+        _colorSpace = webpCreateColorSpace(webpCodecAnimationGetDemuxer(_animation));
+        self.outputSize = targetSize;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    webpBufferPoolRelease(_canvas, _canvasCapacity);
+    webpMemoryBudgetRelease(_reservedMemory);
+    if (_colorSpace) {
+        CGColorSpaceRelease(_colorSpace);
+    }
+    webpCodecAnimationDelete(_animation);
+}
+
+- (NSUInteger)keyFrameIndexForIndex:(NSUInteger)index {
+    if (index >= _frameCount) {
+        return NSNotFound;
+    }
+    return webpCodecAnimationGetFrame(_animation, (uint32_t) index)->keyFrame;
+}
+
+- (NSTimeInterval)durationAtIndex:(NSUInteger)index {
+    if (index >= _frameCount) {
+        return 0.0;
+    }
+    return webpCodecAnimationGetFrame(_animation, (uint32_t) index)->duration / 1000.0;
+}
+
+- (void)setOutputSize:(CGSize)outputSize {
+    _outputSize = 0 < outputSize.width && 0 < outputSize.height ? outputSize : _canvasSize;
+    _outputSize = CGSizeMake(trunc(_outputSize.width), trunc(_outputSize.height));
+    [self purgeCanvas];
+    webpCodecAnimationSetOutputSize(_animation, (uint32_t) _outputSize.width, (uint32_t) _outputSize.height);
+}
+
+- (BOOL)isScaledOutput {
+    return !CGSizeEqualToSize(_canvasSize, _outputSize);
+}
+
+- (nullable CGImageRef)copyFrameAtIndex:(NSUInteger)index CF_RETURNS_RETAINED {
+    if (index >= _frameCount) {
+        return NULL;
+    }
+    if (!_isAnimated) {
+        return [self copyStillImage];
+    }
+    if (!_canvas && ![self createCanvas]) {
+        return NULL;
+    }
+    if (!webpCodecAnimationRenderFrame(_animation, (uint32_t) index, _canvas, _canvasStride, NULL)) {
+        return NULL;
+    }
+    return webpCreateCGImageFromBuffer(_canvas,
+                                       (size_t) _outputSize.width,
+                                       (size_t) _outputSize.height,
+                                       _canvasStride,
+                                       _hasAlpha,
+                                       _colorSpace);
+}
+
+- (void)purgeCanvas {
+    // Buffers go back to the pool, so the next decoder of the same size reuses them.
+    webpBufferPoolRelease(_canvas, _canvasCapacity);
+    _canvas = NULL;
+    _canvasCapacity = 0;
+    webpCodecAnimationPurge(_animation);
+    webpMemoryBudgetRelease(_reservedMemory);
+    _reservedMemory = 0;
+}
+
+- (BOOL)reserveMemoryForFrameCount:(NSUInteger)count {
+    if (!_isAnimated) {
+        // Still images have no canvas, their decode reserves the memory of the frame.
+        return YES;
+    }
+    [self purgeCanvas];
+    // Frames kept by the caller, the canvas and the buffers of the frames decoded ahead.
+    size_t reserved;
+    const __auto_type size = webpReserveImageMemory(_outputSize, count + 1 + self.decodeLookahead, YES, &reserved);
+    if (0 == reserved) {
+        return NO;
+    }
+    if (!CGSizeEqualToSize(size, _outputSize)) {
+        self.outputSize = size;
+    }
+    _reservedMemory = reserved;
+    return YES;
+}
+
+- (BOOL)enumerateFramesUsingBlock:(void (^)(CGImageRef image, NSUInteger index, BOOL *stop))block {
+    BOOL stop = NO;
+    if (!_isAnimated) {
+        CGImageRef image;
+        if (!(image = [self copyStillImage])) {
+            return NO;
+        }
+        block(image, 0, &stop);
+        CGImageRelease(image);
+        return YES;
+    }
+    if (!_canvas && ![self createCanvas]) {
+        return NO;
+    }
+    [self resetCanvas];
+    // Fragments are independent, so they are decoded concurrently up to `depth` frames ahead.
+    // Only compositing depends on the previous frame and runs in order on this thread.
+    const NSUInteger depth = self.decodeLookahead;
+    NSMutableArray<WIKFrameDecodeSlot *> *slots = [NSMutableArray arrayWithCapacity:depth];
+    for (NSUInteger slotIdx = 0; slotIdx < depth; ++slotIdx) {
+        [slots addObject:[WIKFrameDecodeSlot new]];
+    }
+    dispatch_group_t group = dispatch_group_create();
+    dispatch_queue_t queue = dispatch_get_global_queue(qos_class_self(), 0);
+    // Workers account their decode time to the operation of this thread.
+    WebpMetricsShared *metrics = webpMetricsOperationShare();
+    for (NSUInteger frameIdx = 0; frameIdx < MIN(depth, _frameCount); ++frameIdx) {
+        [self decodeFrameAtIndex:frameIdx intoSlot:slots[frameIdx] group:group queue:queue metrics:metrics];
+    }
+    for (NSUInteger frameIdx = 0; frameIdx < _frameCount && !stop; ++frameIdx) {
+        WIKFrameDecodeSlot *slot = slots[frameIdx % depth];
+        dispatch_semaphore_wait(slot->_ready, DISPATCH_TIME_FOREVER);
+        const BOOL isDrawn = slot->_isDecoded;
+        webpCodecAnimationDrawDecodedFrame(_animation, (uint32_t) frameIdx, _canvas, _canvasStride,
+                                           isDrawn ? slot->_pixels : NULL, slot->_stride);
+        // The slot is free once the frame is on the canvas.
+        if (frameIdx + depth < _frameCount) {
+            [self decodeFrameAtIndex:frameIdx + depth intoSlot:slot group:group queue:queue metrics:metrics];
+        }
+        if (!isDrawn) {
+            // Broken frames are skipped, the rest of the animation still composites on top of the canvas.
+            continue;
+        }
+        @autoreleasepool {
+            CGImageRef image = webpCreateCGImageFromBuffer(_canvas,
+                                                           (size_t) _outputSize.width,
+                                                           (size_t) _outputSize.height,
+                                                           _canvasStride,
+                                                           _hasAlpha,
+                                                           _colorSpace);
+            if (image) {
+                block(image, frameIdx, &stop);
+                CGImageRelease(image);
+            }
+        }
+    }
+    // Workers still decoding ahead of a stop write into the slots.
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    webpMetricsSharedRelease(metrics);
+    return YES;
+}
+
+#pragma mark - Private
+
+- (NSUInteger)decodeLookahead {
+    return MAX(MIN(webpConcurrencyLimit(), kWIKMaxDecodeLookahead), (NSUInteger) 2);
+}
+
+// Called on the compositor thread, so the demuxer is never used concurrently.
+- (void)decodeFrameAtIndex:(NSUInteger)index
+                  intoSlot:(WIKFrameDecodeSlot *)slot
+                     group:(dispatch_group_t)group
+                     queue:(dispatch_queue_t)queue
+                   metrics:(nullable WebpMetricsShared *)metrics {
+    const __auto_type rect = webpCodecAnimationGetFrameRect(_animation, (uint32_t) index);
+    slot->_isDecoded = NO;
+    slot->_stride = webpByteAlign(rect.width * 4, 64);
+    const size_t size = slot->_stride * rect.height;
+    if (slot->_capacity < size) {
+        webpBufferPoolRelease(slot->_pixels, slot->_capacity);
+        size_t capacity;
+        slot->_pixels = webpAcquirePooledBuffer(size, &capacity);
+        slot->_capacity = slot->_pixels ? capacity : 0;
+    }
+    WebPData fragment;
+    if (!slot->_pixels || !webpCodecAnimationGetFragment(_animation, (uint32_t) index, &fragment)) {
+        dispatch_semaphore_signal(slot->_ready);
+        return;
+    }
+    const WebpCodecAnimation *animation = _animation;
+    dispatch_group_async(group, queue, ^{
+        webpMetricsOperationAttach(metrics);
+        slot->_isDecoded = webpCodecAnimationDecodeFragment(animation, (uint32_t) index, &fragment,
+                                                            slot->_pixels, slot->_stride);
+        webpMetricsOperationDetach();
+        dispatch_semaphore_signal(slot->_ready);
+    });
+}
+
+- (nullable CGImageRef)copyStillImage CF_RETURNS_RETAINED {
+    WebPData fragment;
+    if (!webpCodecAnimationGetFragment(_animation, 0, &fragment)) {
+        return NULL;
+    }
+    return webpCreateCGImage(fragment, _colorSpace, self.isScaledOutput ? _outputSize : CGSizeZero);
+}
+
+- (BOOL)createCanvas {
+    if (0 == _reservedMemory) {
+        // Canvases of on-demand animations live as long as the animation is shown, so they can't wait for memory.
+        _reservedMemory = webpImageMemorySize(_outputSize, 2);
+        webpMemoryBudgetCharge(_reservedMemory);
+    }
+    _canvasStride = webpByteAlign((size_t) _outputSize.width * 4, 64);
+    if (!(_canvas = webpAcquirePooledBuffer(_canvasStride * (size_t) _outputSize.height, &_canvasCapacity))) {
+        _canvasCapacity = 0;
+        return NO;
+    }
+    [self resetCanvas];
+    return YES;
+}
+
+// The animation renders the next frame from its key frame onto the cleared canvas.
+- (void)resetCanvas {
+    memset(_canvas, 0, _canvasStride * (size_t) _outputSize.height);
+    webpCodecAnimationPurge(_animation);
+}
+
+@end
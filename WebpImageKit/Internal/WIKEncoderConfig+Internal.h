@@ -8,6 +8,7 @@
 
 #import <Foundation/Foundation.h>
 #import <libwebp/encode.h>
+#import <libwebp/mux.h>
 #import "WIKEncoderConfig.h"
 
 @interface WIKEncoderConfig () {
@@ -40,6 +41,14 @@
     NSNumber *_partitions;
     NSNumber *_partitionLimit;
     NSNumber *_sharpYuv;
+
+    WIKRateControl _rateControl;
+    NSNumber *_fileSizeTolerance;
+
+    WIKAnimationMode _animationMode;
+    NSNumber *_minKeyFrameDistance;
+    NSNumber *_maxKeyFrameDistance;
+    NSNumber *_allowMixed;
 }
 
 @property (nonatomic, readonly, nullable) NSNumber *targetQuality;
@@ -48,6 +57,7 @@
 @property (nonatomic, readonly, nullable) NSValue *maxPixelSize;
 
 - (BOOL)setupWebpEncoderConfiguration:(nonnull WebPConfig *)config;
+- (BOOL)setupWebpAnimationOptions:(nonnull WebPAnimEncoderOptions *)options loopCount:(int)loopCount;
 
 - (nullable WIKEncoderConfig *)initWithQuality:(int)quality andPreset:(WIKPreset)preset;
 
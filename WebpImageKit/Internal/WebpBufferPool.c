@@ -0,0 +1,146 @@
+//
+//  WebpBufferPool.c
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "WebpBufferPool.h"
+#include "WebpMetrics.h"
+
+#define WEBP_POOL_MIN_SHIFT 12                  // the smallest class is 4 KB
+#define WEBP_POOL_MAX_SHIFT 31                  // larger buffers aren't pooled
+#define WEBP_POOL_CLASS_COUNT (1 + (WEBP_POOL_MAX_SHIFT - WEBP_POOL_MIN_SHIFT) * 4)
+#define WEBP_POOL_CLASS_DEPTH 4                 // cached buffers per class
+#define WEBP_POOL_DEFAULT_LIMIT (32u << 20)
+
+typedef struct {
+    uint8_t *buffers[WEBP_POOL_CLASS_DEPTH];
+    size_t count;
+} WebpPoolClass;
+
+static pthread_mutex_t webpPoolLock = PTHREAD_MUTEX_INITIALIZER;
+static WebpPoolClass webpPoolClasses[WEBP_POOL_CLASS_COUNT];
+static size_t webpPoolCachedSize = 0;
+static size_t webpPoolLimit = WEBP_POOL_DEFAULT_LIMIT;
+
+static inline unsigned webpPoolLog2(size_t value) {
+    unsigned result = 0;
+    while (value >>= 1) {
+        ++result;
+    }
+    return result;
+}
+
+// Returns the class index for the size, or -1 if the size isn't pooled, and the class capacity.
+static int webpPoolClassForSize(size_t size, size_t *capacity) {
+    if (size <= ((size_t) 1 << WEBP_POOL_MIN_SHIFT)) {
+        *capacity = (size_t) 1 << WEBP_POOL_MIN_SHIFT;
+        return 0;
+    }
+    // size is in (2^shift, 2^(shift + 1)], the range is split into four classes.
+    const unsigned shift = webpPoolLog2(size - 1);
+    if (shift >= WEBP_POOL_MAX_SHIFT) {
+        *capacity = size;
+        return -1;
+    }
+    const size_t step = (size_t) 1 << (shift - 2);
+    const size_t steps = (size + step - 1) / step;
+    *capacity = steps * step;
+    return 1 + (int) (shift - WEBP_POOL_MIN_SHIFT) * 4 + (int) (steps - 5);
+}
+
+static inline size_t webpPoolClassCapacity(int classIdx) {
+    if (0 == classIdx) {
+        return (size_t) 1 << WEBP_POOL_MIN_SHIFT;
+    }
+    const unsigned shift = WEBP_POOL_MIN_SHIFT + (unsigned) (classIdx - 1) / 4;
+    const size_t steps = 5 + (size_t) (classIdx - 1) % 4;
+    return steps << (shift - 2);
+}
+
+// Frees cached buffers, largest classes first, until the cached size fits the limit. Called under the lock.
+static void webpPoolTrim(size_t limit) {
+    for (int classIdx = WEBP_POOL_CLASS_COUNT - 1; classIdx >= 0 && webpPoolCachedSize > limit; --classIdx) {
+        WebpPoolClass *poolClass = &webpPoolClasses[classIdx];
+        const size_t capacity = webpPoolClassCapacity(classIdx);
+        while (0 < poolClass->count && webpPoolCachedSize > limit) {
+            free(poolClass->buffers[--poolClass->count]);
+            webpPoolCachedSize -= capacity;
+        }
+    }
+}
+
+uint8_t *webpBufferPoolAcquire(size_t size, size_t *capacity) {
+    size_t classCapacity;
+    const int classIdx = webpPoolClassForSize(size, &classCapacity);
+    if (capacity) {
+        *capacity = classCapacity;
+    }
+    if (0 <= classIdx) {
+        uint8_t *buffer = NULL;
+        pthread_mutex_lock(&webpPoolLock);
+        WebpPoolClass *poolClass = &webpPoolClasses[classIdx];
+        if (0 < poolClass->count) {
+            buffer = poolClass->buffers[--poolClass->count];
+            webpPoolCachedSize -= classCapacity;
+        }
+        pthread_mutex_unlock(&webpPoolLock);
+        if (buffer) {
+            webpMetricsMemoryAcquired(classCapacity);
+            return buffer;
+        }
+    }
+    uint8_t *buffer = malloc(classCapacity);
+    if (buffer) {
+        webpMetricsMemoryAcquired(classCapacity);
+    }
+    return buffer;
+}
+
+void webpBufferPoolRelease(uint8_t *buffer, size_t capacity) {
+    if (!buffer) {
+        return;
+    }
+    webpMetricsMemoryReleased(capacity);
+    size_t classCapacity;
+    const int classIdx = webpPoolClassForSize(capacity, &classCapacity);
+    if (0 <= classIdx && classCapacity == capacity) {
+        pthread_mutex_lock(&webpPoolLock);
+        WebpPoolClass *poolClass = &webpPoolClasses[classIdx];
+        const int isCached = poolClass->count < WEBP_POOL_CLASS_DEPTH && webpPoolCachedSize + capacity <= webpPoolLimit;
+        if (isCached) {
+            poolClass->buffers[poolClass->count++] = buffer;
+            webpPoolCachedSize += capacity;
+        }
+        pthread_mutex_unlock(&webpPoolLock);
+        if (isCached) {
+            return;
+        }
+    }
+    free(buffer);
+}
+
+void webpBufferPoolPurge(void) {
+    pthread_mutex_lock(&webpPoolLock);
+    webpPoolTrim(0);
+    pthread_mutex_unlock(&webpPoolLock);
+}
+
+void webpBufferPoolSetLimit(size_t limit) {
+    pthread_mutex_lock(&webpPoolLock);
+    webpPoolLimit = limit;
+    webpPoolTrim(limit);
+    pthread_mutex_unlock(&webpPoolLock);
+}
+
+size_t webpBufferPoolCachedSize(void) {
+    pthread_mutex_lock(&webpPoolLock);
+    const size_t cachedSize = webpPoolCachedSize;
+    pthread_mutex_unlock(&webpPoolLock);
+    return cachedSize;
+}
@@ -0,0 +1,56 @@
+//
+//  WebpBufferPool.h
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#ifndef WebpBufferPool_h
+#define WebpBufferPool_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * Process wide pool of pixel buffers. Requested sizes are rounded up to size classes with
+ * four classes per power of two, so buffers for frames of the same size are reused while the
+ * rounding waste stays below 25%. Released buffers are kept until the pool limit is reached.
+ * All functions are thread-safe.
+ */
+
+/**
+ * Returns a buffer of at least `size` bytes, its content is undefined. The actual buffer size
+ * is returned in `capacity` and must be passed back to `webpBufferPoolRelease`.
+ */
+uint8_t *webpBufferPoolAcquire(size_t size, size_t *capacity);
+
+/**
+ * Returns the buffer to the pool, or frees it if the pool is full.
+ */
+void webpBufferPoolRelease(uint8_t *buffer, size_t capacity);
+
+/**
+ * Frees all cached buffers.
+ */
+void webpBufferPoolPurge(void);
+
+/**
+ * Sets the maximum number of bytes kept by the pool, cached buffers above the limit are freed.
+ */
+void webpBufferPoolSetLimit(size_t limit);
+
+/**
+ * Returns the number of bytes in cached buffers.
+ */
+size_t webpBufferPoolCachedSize(void);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* WebpBufferPool_h */
@@ -0,0 +1,456 @@
+//
+//  WebpCodec.c
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "WebpCodec.h"
+#include "WebpBufferPool.h"
+#include "WebpCompositor.h"
+#include "WebpMetrics.h"
+
+struct WebpCodecAnimation {
+    WebPData webpData;
+    WebPDemuxer *demuxer;
+    WebpCodecAnimationInfo info;
+    WebpCompositorFrame *frames;
+    WebpCodecRect *outputRects;     // frame rectangles on the output canvas
+    uint32_t outputWidth;
+    uint32_t outputHeight;
+    int64_t renderedIndex;          // frame on the caller's canvas, -1 if none
+    uint8_t *scratch;
+    size_t scratchCapacity;
+};
+
+WebPDemuxer *webpCodecCreateDemuxer(const WebPData *webpData) {
+    const uint64_t metricsStart = webpMetricsStageBegin();
+    WebPDemuxer *demuxer = WebPDemux(webpData);
+    webpMetricsStageEnd(WebpMetricsStageDemux, metricsStart, webpData->size);
+    return demuxer;
+}
+
+int webpCodecSetupDecoder(WebPDecoderConfig *config, const WebpCodecRect *crop,
+                          size_t targetWidth, size_t targetHeight,
+                          size_t *width, size_t *height) {
+    *width = (size_t) config->input.width;
+    *height = (size_t) config->input.height;
+    if (crop) {
+        if (crop->x >= *width || crop->y >= *height) {
+            return 0;
+        }
+        const size_t cropWidth = crop->width < *width - crop->x ? crop->width : *width - crop->x;
+        const size_t cropHeight = crop->height < *height - crop->y ? crop->height : *height - crop->y;
+        if (0 == cropWidth || 0 == cropHeight) {
+            return 0;
+        }
+        config->options.use_cropping = 1;
+        config->options.crop_left = (int) crop->x;
+        config->options.crop_top = (int) crop->y;
+        config->options.crop_width = (int) cropWidth;
+        config->options.crop_height = (int) cropHeight;
+        *width = cropWidth;
+        *height = cropHeight;
+    }
+    // The rescaler isn't free even at 1:1, so it's only enabled when the size actually changes.
+    if (0 < targetWidth && 0 < targetHeight && (*width != targetWidth || *height != targetHeight)) {
+        config->options.use_scaling = 1;
+        config->options.scaled_width = (int) targetWidth;
+        config->options.scaled_height = (int) targetHeight;
+        *width = targetWidth;
+        *height = targetHeight;
+    }
+    config->options.use_threads = 1;
+    return 0 < *width && 0 < *height;
+}
+
+int webpCodecDecode(const uint8_t *bytes, size_t size, WebPDecoderConfig *config, WEBP_CSP_MODE mode,
+                    size_t width, size_t height, uint8_t *pixels, size_t stride) {
+    if (!pixels || 0 == width || 0 == height || stride < width * 4) {
+        return 0;
+    }
+    config->output.colorspace = mode;
+    config->output.is_external_memory = 1;
+    config->output.u.RGBA.rgba = pixels;
+    config->output.u.RGBA.stride = (int) stride;
+    config->output.u.RGBA.size = stride * (height - 1) + width * 4;
+    const uint64_t metricsStart = webpMetricsStageBegin();
+    const int result = VP8_STATUS_OK == WebPDecode(bytes, size, config);
+    webpMetricsStageEnd(WebpMetricsStageDecode, metricsStart, stride * height);
+    return result;
+}
+
+int webpCodecDecodeYuv(const uint8_t *bytes, size_t size, WebPDecoderConfig *config, const WebPYUVABuffer *buffer) {
+    config->output.colorspace = buffer->a ? MODE_YUVA : MODE_YUV;
+    config->output.is_external_memory = 1;
+    config->output.u.YUVA = *buffer;
+    const uint64_t metricsStart = webpMetricsStageBegin();
+    const int result = VP8_STATUS_OK == WebPDecode(bytes, size, config);
+    webpMetricsStageEnd(WebpMetricsStageDecode, metricsStart,
+                        buffer->y_size + buffer->u_size + buffer->v_size + buffer->a_size);
+    return result;
+}
+
+WebpCompositorFrame *webpCodecCreateFrameTable(WebPDemuxer *demuxer, uint32_t *frameCount) {
+    const int canvasWidth = (int) WebPDemuxGetI(demuxer, WEBP_FF_CANVAS_WIDTH);
+    const int canvasHeight = (int) WebPDemuxGetI(demuxer, WEBP_FF_CANVAS_HEIGHT);
+    const uint32_t count = WebPDemuxGetI(demuxer, WEBP_FF_FRAME_COUNT);
+    WebpCompositorFrame *frames;
+    if (0 == count || !(frames = calloc(count, sizeof(WebpCompositorFrame)))) {
+        return NULL;
+    }
+    WebPIterator iterator;
+    if (!WebPDemuxGetFrame(demuxer, 1, &iterator)) {
+        WebPDemuxReleaseIterator(&iterator);
+        free(frames);
+        return NULL;
+    }
+    uint32_t frameIdx = 0;
+    do {
+        frames[frameIdx++] = (WebpCompositorFrame) {
+                .x = iterator.x_offset,
+                .y = iterator.y_offset,
+                .width = iterator.width,
+                .height = iterator.height,
+                .duration = iterator.duration,
+                .disposeToBackground = WEBP_MUX_DISPOSE_BACKGROUND == iterator.dispose_method,
+                .blend = WEBP_MUX_BLEND == iterator.blend_method,
+                .hasAlpha = iterator.has_alpha
+        };
+    } while (frameIdx < count && WebPDemuxNextFrame(&iterator));
+    WebPDemuxReleaseIterator(&iterator);
+    // Frames are drawn straight into the canvas, so every one of them must fit into it.
+    for (uint32_t index = 0; index < frameIdx; ++index) {
+        const WebpCompositorFrame *frame = &frames[index];
+        if (frame->x + frame->width > canvasWidth || frame->y + frame->height > canvasHeight) {
+            free(frames);
+            return NULL;
+        }
+    }
+    webpCompositorFindKeyFrames(frames, frameIdx, canvasWidth, canvasHeight);
+    *frameCount = frameIdx;
+    return frames;
+}
+
+WebpCodecAnimation *webpCodecAnimationCreate(const uint8_t *bytes, size_t size) {
+    if (!bytes || 0 == size) {
+        return NULL;
+    }
+    WebpCodecAnimation *animation = calloc(1, sizeof(WebpCodecAnimation));
+    if (!animation) {
+        return NULL;
+    }
+    animation->webpData.bytes = bytes;
+    animation->webpData.size = size;
+    animation->renderedIndex = -1;
+    if (!(animation->demuxer = webpCodecCreateDemuxer(&animation->webpData))) {
+        webpCodecAnimationDelete(animation);
+        return NULL;
+    }
+    WebpCodecAnimationInfo *info = &animation->info;
+    const uint32_t flags = WebPDemuxGetI(animation->demuxer, WEBP_FF_FORMAT_FLAGS);
+    info->canvasWidth = WebPDemuxGetI(animation->demuxer, WEBP_FF_CANVAS_WIDTH);
+    info->canvasHeight = WebPDemuxGetI(animation->demuxer, WEBP_FF_CANVAS_HEIGHT);
+    info->loopCount = WebPDemuxGetI(animation->demuxer, WEBP_FF_LOOP_COUNT);
+    info->isAnimated = 0 != (flags & ANIMATION_FLAG);
+    info->hasAlpha = 0 != (flags & ALPHA_FLAG);
+    if (0 == info->canvasWidth || 0 == info->canvasHeight
+            || !(animation->frames = webpCodecCreateFrameTable(animation->demuxer, &info->frameCount))
+            || !(animation->outputRects = calloc(info->frameCount, sizeof(WebpCodecRect)))) {
+        webpCodecAnimationDelete(animation);
+        return NULL;
+    }
+    webpCodecAnimationSetOutputSize(animation, 0, 0);
+    return animation;
+}
+
+void webpCodecAnimationDelete(WebpCodecAnimation *animation) {
+    if (!animation) {
+        return;
+    }
+    if (animation->demuxer) {
+        WebPDemuxDelete(animation->demuxer);
+    }
+    webpBufferPoolRelease(animation->scratch, animation->scratchCapacity);
+    free(animation->outputRects);
+    free(animation->frames);
+    free(animation);
+}
+
+void webpCodecAnimationGetInfo(const WebpCodecAnimation *animation, WebpCodecAnimationInfo *info) {
+    *info = animation->info;
+}
+
+WebPDemuxer *webpCodecAnimationGetDemuxer(const WebpCodecAnimation *animation) {
+    return animation->demuxer;
+}
+
+const WebpCompositorFrame *webpCodecAnimationGetFrame(const WebpCodecAnimation *animation, uint32_t index) {
+    return index < animation->info.frameCount ? &animation->frames[index] : NULL;
+}
+
+void webpCodecAnimationSetOutputSize(WebpCodecAnimation *animation, uint32_t width, uint32_t height) {
+    const WebpCodecAnimationInfo *info = &animation->info;
+    if (0 == width || 0 == height) {
+        width = info->canvasWidth;
+        height = info->canvasHeight;
+    }
+    animation->outputWidth = width;
+    animation->outputHeight = height;
+    animation->renderedIndex = -1;
+    // Frames are decoded right at the output size, so each frame rectangle is mapped on the
+    // output canvas. Edges are rounded, so adjacent frame rectangles stay adjacent.
+    const double scaleX = (double) width / info->canvasWidth;
+    const double scaleY = (double) height / info->canvasHeight;
+    const int isScaled = width != info->canvasWidth || height != info->canvasHeight;
+    for (uint32_t frameIdx = 0; frameIdx < info->frameCount; ++frameIdx) {
+        const WebpCompositorFrame *frame = &animation->frames[frameIdx];
+        WebpCodecRect *rect = &animation->outputRects[frameIdx];
+        if (!isScaled) {
+            *rect = (WebpCodecRect) { (size_t) frame->x, (size_t) frame->y, (size_t) frame->width, (size_t) frame->height };
+            continue;
+        }
+        const double left = fmin(round(frame->x * scaleX), width - 1.0);
+        const double top = fmin(round(frame->y * scaleY), height - 1.0);
+        const double right = fmin(round((frame->x + frame->width) * scaleX), width);
+        const double bottom = fmin(round((frame->y + frame->height) * scaleY), height);
+        *rect = (WebpCodecRect) {
+                .x = (size_t) left,
+                .y = (size_t) top,
+                .width = right - left > 1.0 ? (size_t) (right - left) : 1,
+                .height = bottom - top > 1.0 ? (size_t) (bottom - top) : 1
+        };
+    }
+}
+
+WebpCodecRect webpCodecAnimationGetFrameRect(const WebpCodecAnimation *animation, uint32_t index) {
+    return animation->outputRects[index];
+}
+
+void webpCodecAnimationPurge(WebpCodecAnimation *animation) {
+    webpBufferPoolRelease(animation->scratch, animation->scratchCapacity);
+    animation->scratch = NULL;
+    animation->scratchCapacity = 0;
+    animation->renderedIndex = -1;
+}
+
+int webpCodecAnimationGetFragment(const WebpCodecAnimation *animation, uint32_t index, WebPData *fragment) {
+    WebPIterator iterator;
+    if (index >= animation->info.frameCount || !WebPDemuxGetFrame(animation->demuxer, (int) index + 1, &iterator)) {
+        return 0;
+    }
+    // The fragment points into the image bytes, which outlive the animation.
+    *fragment = iterator.fragment;
+    WebPDemuxReleaseIterator(&iterator);
+    return 1;
+}
+
+int webpCodecAnimationDecodeFragment(const WebpCodecAnimation *animation, uint32_t index, const WebPData *fragment,
+                                     uint8_t *pixels, size_t stride) {
+    const WebpCodecRect *rect = &animation->outputRects[index];
+    WebPDecoderConfig config;
+    size_t width, height;
+    if (!WebPInitDecoderConfig(&config)
+            || VP8_STATUS_OK != WebPGetFeatures(fragment->bytes, fragment->size, &config.input)
+            || !webpCodecSetupDecoder(&config, NULL, rect->width, rect->height, &width, &height)
+            || width != rect->width || height != rect->height) {
+        return 0;
+    }
+    return webpCodecDecode(fragment->bytes, fragment->size, &config, MODE_bgrA, width, height, pixels, stride);
+}
+
+static void webpCodecAnimationComposite(const WebpCodecAnimation *animation, uint32_t index,
+                                        uint8_t *canvas, size_t stride, const uint8_t *pixels, size_t pixelStride) {
+    const WebpCodecRect *rect = &animation->outputRects[index];
+    const uint64_t metricsStart = webpMetricsStageBegin();
+    uint8_t *target = canvas + rect->y * stride + rect->x * 4;
+    if (webpCompositorIsBlended(&animation->frames[index])) {
+        webpCompositorBlendRect(target, stride, pixels, pixelStride, rect->width, rect->height);
+    }
+    else {
+        webpCompositorCopyRect(target, stride, pixels, pixelStride, rect->width, rect->height);
+    }
+    webpMetricsStageEnd(WebpMetricsStageComposite, metricsStart, rect->width * rect->height * 4);
+}
+
+// Clears the rectangle of the previous frame if it is disposed to the background.
+static void webpCodecAnimationDispose(const WebpCodecAnimation *animation, uint32_t index, uint8_t *canvas, size_t stride) {
+    if (0 < index && animation->frames[index - 1].disposeToBackground) {
+        const WebpCodecRect *rect = &animation->outputRects[index - 1];
+        webpCompositorClearRect(canvas, stride, rect->x, rect->y, rect->width, rect->height);
+    }
+}
+
+void webpCodecAnimationDrawDecodedFrame(WebpCodecAnimation *animation, uint32_t index, uint8_t *canvas, size_t stride,
+                                        const uint8_t *pixels, size_t pixelStride) {
+    webpCodecAnimationDispose(animation, index, canvas, stride);
+    if (pixels) {
+        webpCodecAnimationComposite(animation, index, canvas, stride, pixels, pixelStride);
+    }
+    animation->renderedIndex = index;
+}
+
+static int webpCodecAnimationDrawFrame(WebpCodecAnimation *animation, uint32_t index, uint8_t *canvas, size_t stride) {
+    webpCodecAnimationDispose(animation, index, canvas, stride);
+    WebPData fragment;
+    if (!webpCodecAnimationGetFragment(animation, index, &fragment)) {
+        return 0;
+    }
+    const WebpCodecRect *rect = &animation->outputRects[index];
+    if (!webpCompositorIsBlended(&animation->frames[index])) {
+        // Nothing to blend with, decode straight into the canvas.
+        return webpCodecAnimationDecodeFragment(animation, index, &fragment,
+                                                canvas + rect->y * stride + rect->x * 4, stride);
+    }
+    const size_t scratchSize = rect->width * rect->height * 4;
+    if (animation->scratchCapacity < scratchSize) {
+        webpBufferPoolRelease(animation->scratch, animation->scratchCapacity);
+        animation->scratchCapacity = 0;
+        if (!(animation->scratch = webpBufferPoolAcquire(scratchSize, &animation->scratchCapacity))) {
+            return 0;
+        }
+    }
+    if (!webpCodecAnimationDecodeFragment(animation, index, &fragment, animation->scratch, rect->width * 4)) {
+        return 0;
+    }
+    webpCodecAnimationComposite(animation, index, canvas, stride, animation->scratch, rect->width * 4);
+    return 1;
+}
+
+int webpCodecAnimationRenderFrame(WebpCodecAnimation *animation, uint32_t index,
+                                  uint8_t *canvas, size_t stride, uint32_t *duration) {
+    if (!canvas || index >= animation->info.frameCount || stride < (size_t) animation->outputWidth * 4) {
+        return 0;
+    }
+    const int64_t keyFrame = animation->frames[index].keyFrame;
+    if ((int64_t) index <= animation->renderedIndex || animation->renderedIndex < keyFrame - 1) {
+        // The canvas can't be reused, so seek to the closest key frame instead of replaying from the first frame.
+        webpCompositorClearRect(canvas, stride, 0, 0, animation->outputWidth, animation->outputHeight);
+        animation->renderedIndex = keyFrame - 1;
+    }
+    int isDrawn = 1;
+    while (animation->renderedIndex < (int64_t) index) {
+        // Broken frames are skipped, the rest of the animation still composites on top of the canvas.
+        isDrawn = webpCodecAnimationDrawFrame(animation, (uint32_t) (animation->renderedIndex + 1), canvas, stride);
+        ++animation->renderedIndex;
+    }
+    if (duration) {
+        *duration = (uint32_t) animation->frames[index].duration;
+    }
+    return isDrawn;
+}
+
+int webpCodecPreparePicture(WebPPicture *picture, size_t width, size_t height) {
+    if (!picture || 0 == width || 0 == height) {
+        return 0;
+    }
+    // Pixels go straight into the ARGB plane, the encoder converts it to YUV in place when needed.
+    // The encoder keeps the ARGB plane, so a picture of the same size is filled again without allocation.
+    const int isAllocated = picture->argb && (size_t) picture->width == width && (size_t) picture->height == height;
+    picture->use_argb = 1;
+    picture->width = (int) width;
+    picture->height = (int) height;
+    if (isAllocated) {
+        return 1;
+    }
+    if (!WebPPictureAlloc(picture)) {
+        return 0;
+    }
+    webpMetricsMemoryAcquired((size_t) picture->argb_stride * height * 4);
+    return 1;
+}
+
+int webpCodecImportPixels(WebPPicture *picture, const uint8_t *pixels, size_t stride, const WebpPixelLayout *layout) {
+    if (!picture || !picture->argb || !pixels || !layout) {
+        return 0;
+    }
+    const size_t width = (size_t) picture->width;
+    const size_t height = (size_t) picture->height;
+    const uint64_t metricsStart = webpMetricsStageBegin();
+    webpConvertPixelsToArgb(pixels, stride, layout, picture->argb, (size_t) picture->argb_stride, width, height);
+    webpMetricsStageEnd(WebpMetricsStageImport, metricsStart, width * height * 4);
+    return 1;
+}
+
+int webpCodecScalePicture(const WebPPicture *source, WebPPicture *target, int width, int height) {
+    if (!source || !target || 0 >= width || 0 >= height) {
+        return 0;
+    }
+    const int isSameSize = source->width == width && source->height == height;
+    if (source == target && isSameSize) {
+        return 1;
+    }
+    const uint64_t metricsStart = webpMetricsStageBegin();
+    if (source == target) {
+        // Rescaling allocates the scaled planes in the picture, they are freed with it.
+        if (!WebPPictureRescale(target, width, height)) {
+            return 0;
+        }
+    }
+    else {
+        // Rescaling a view allocates the new picture and leaves the source untouched.
+        if (!WebPPictureView(source, 0, 0, source->width, source->height, target)) {
+            return 0;
+        }
+        if (!(isSameSize ? WebPPictureCopy(source, target) : WebPPictureRescale(target, width, height))) {
+            WebPPictureInit(target);
+            return 0;
+        }
+    }
+    const size_t bytes = target->use_argb
+            ? (size_t) target->argb_stride * (size_t) height * 4
+            : (size_t) width * (size_t) height * 3 / 2;
+    webpMetricsStageEnd(WebpMetricsStageRescale, metricsStart, bytes);
+    if (source != target) {
+        webpMetricsMemoryAcquired(bytes);
+    }
+    return 1;
+}
+
+typedef struct {
+    WebPWriterFunction writer;
+    void *customPtr;
+    size_t size;
+} WebpCountingWriter;
+
+// Forwards the output to the caller's writer and counts the encoded bytes.
+static int webpCountingWrite(const uint8_t *data, size_t dataSize, const WebPPicture *picture) {
+    WebpCountingWriter *countingWriter = picture->custom_ptr;
+    countingWriter->size += dataSize;
+    WebPPicture target = *picture;
+    target.custom_ptr = countingWriter->customPtr;
+    return countingWriter->writer(data, dataSize, &target);
+}
+
+int webpCodecEncode(const WebPConfig *config, WebPPicture *picture, WebPWriterFunction writer, void *customPtr) {
+    const uint64_t metricsStart = webpMetricsStageBegin();
+    if (0 == metricsStart) {
+        picture->writer = writer;
+        picture->custom_ptr = customPtr;
+        return WebPEncode(config, picture);
+    }
+    WebpCountingWriter countingWriter = { .writer = writer, .customPtr = customPtr, .size = 0 };
+    picture->writer = webpCountingWrite;
+    picture->custom_ptr = &countingWriter;
+    const int result = WebPEncode(config, picture);
+    // The writer is restored, callers may read the output through the picture.
+    picture->writer = writer;
+    picture->custom_ptr = customPtr;
+    webpMetricsStageEnd(WebpMetricsStageEncode, metricsStart, countingWriter.size);
+    return result;
+}
+
+int webpCodecAssemble(WebPMux *mux, WebPData *output) {
+    WebPDataInit(output);
+    const uint64_t metricsStart = webpMetricsStageBegin();
+    if (WEBP_MUX_OK != WebPMuxAssemble(mux, output)) {
+        return 0;
+    }
+    webpMetricsStageEnd(WebpMetricsStageMux, metricsStart, output->size);
+    return 1;
+}
@@ -0,0 +1,184 @@
+//
+//  WebpCodec.h
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#ifndef WebpCodec_h
+#define WebpCodec_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The libwebp pod exposes its headers as <libwebp/...>, system packages as <webp/...>.
+#if __has_include(<libwebp/decode.h>)
+#include <libwebp/decode.h>
+#include <libwebp/demux.h>
+#include <libwebp/encode.h>
+#include <libwebp/mux.h>
+#else
+#include <webp/decode.h>
+#include <webp/demux.h>
+#include <webp/encode.h>
+#include <webp/mux.h>
+#endif
+
+#include "WebpCompositor.h"
+#include "WebpPixelConverter.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * Platform independent pixel pipeline working on raw buffers. Decoded pixels are premultiplied
+ * 8-bit per component in the layout of the output mode, MODE_bgrA matches 32-bit host order
+ * ARGB bitmaps. All functions account their stages in WebpMetrics.
+ */
+
+typedef struct {
+    size_t x;
+    size_t y;
+    size_t width;
+    size_t height;
+} WebpCodecRect;
+
+/**
+ * Creates the demuxer of a complete image.
+ */
+WebPDemuxer *webpCodecCreateDemuxer(const WebPData *webpData);
+
+/**
+ * Sets up cropping and scaling of the decoder, the features of the input must be read already.
+ * libwebp crops first and scales the cropped region, so only the rows and columns of the region
+ * are decoded.
+ *
+ * @param crop Region of the image to decode, NULL for the whole image. It is clipped to the image.
+ * @param targetWidth Width of the decoded image, 0 for the size of the region.
+ * @param targetHeight Height of the decoded image, 0 for the size of the region.
+ * @return Non-zero if the decoded image isn't empty, its size is stored to `width` and `height`.
+ */
+int webpCodecSetupDecoder(WebPDecoderConfig *config, const WebpCodecRect *crop,
+                          size_t targetWidth, size_t targetHeight,
+                          size_t *width, size_t *height);
+
+/**
+ * Decodes the bitstream into the caller's buffer with the options set by `webpCodecSetupDecoder`.
+ * The mode must be one of the 4 bytes per pixel RGB modes.
+ */
+int webpCodecDecode(const uint8_t *bytes, size_t size, WebPDecoderConfig *config, WEBP_CSP_MODE mode,
+                    size_t width, size_t height, uint8_t *pixels, size_t stride);
+
+/**
+ * Decodes the bitstream into the caller's planes, lossy images are decoded without RGB conversion.
+ * The alpha plane is written when `buffer->a` isn't NULL.
+ */
+int webpCodecDecodeYuv(const uint8_t *bytes, size_t size, WebPDecoderConfig *config, const WebPYUVABuffer *buffer);
+
+/**
+ * Reads the frames of the demuxed image and finds their key frames, a still image is a single frame.
+ * The table must be freed with free().
+ *
+ * @return NULL if the image has no frames or a frame doesn't fit into the canvas.
+ */
+WebpCompositorFrame *webpCodecCreateFrameTable(WebPDemuxer *demuxer, uint32_t *frameCount);
+
+typedef struct WebpCodecAnimation WebpCodecAnimation;
+
+typedef struct {
+    uint32_t canvasWidth;
+    uint32_t canvasHeight;
+    uint32_t frameCount;
+    uint32_t loopCount;
+    int isAnimated;
+    int hasAlpha;
+} WebpCodecAnimationInfo;
+
+/**
+ * Creates the decoder of animation frames composited on the canvas. Still images are decoded as
+ * a single frame animation. The bytes must outlive the decoder.
+ */
+WebpCodecAnimation *webpCodecAnimationCreate(const uint8_t *bytes, size_t size);
+void webpCodecAnimationDelete(WebpCodecAnimation *animation);
+void webpCodecAnimationGetInfo(const WebpCodecAnimation *animation, WebpCodecAnimationInfo *info);
+WebPDemuxer *webpCodecAnimationGetDemuxer(const WebpCodecAnimation *animation);
+
+/**
+ * @return NULL if the index is out of the animation.
+ */
+const WebpCompositorFrame *webpCodecAnimationGetFrame(const WebpCodecAnimation *animation, uint32_t index);
+
+/**
+ * Sets the size of the output canvas, 0 for the canvas size of the image. Frames are decoded
+ * right at the output size, the canvas of the caller must be rendered again from a key frame.
+ */
+void webpCodecAnimationSetOutputSize(WebpCodecAnimation *animation, uint32_t width, uint32_t height);
+
+/**
+ * Rectangle of the frame on the output canvas, it is the size of the decoded frame.
+ */
+WebpCodecRect webpCodecAnimationGetFrameRect(const WebpCodecAnimation *animation, uint32_t index);
+
+/**
+ * Releases the scratch memory, the canvas of the caller must be rendered again from a key frame.
+ */
+void webpCodecAnimationPurge(WebpCodecAnimation *animation);
+
+/**
+ * Renders the frame into the caller's canvas in MODE_bgrA. The canvas must keep the previous frame
+ * between calls: frames are composited on it, so the next frame is the cheapest one to render.
+ * Any other frame is rendered from the nearest key frame before it. Broken frames on the way are
+ * skipped.
+ *
+ * @param duration Duration of the frame in milliseconds, optional.
+ * @return Zero if the frame itself can't be decoded.
+ */
+int webpCodecAnimationRenderFrame(WebpCodecAnimation *animation, uint32_t index,
+                                  uint8_t *canvas, size_t stride, uint32_t *duration);
+
+/**
+ * Steps of `webpCodecAnimationRenderFrame` for callers decoding frames ahead on other threads.
+ * The fragment is read on the rendering thread, `webpCodecAnimationDecodeFragment` is safe to call
+ * from any thread and decodes the frame at the size of its output rectangle. The decoded frame is
+ * drawn in order with `webpCodecAnimationDrawDecodedFrame`, NULL pixels only dispose the previous
+ * frame and leave a broken frame out.
+ */
+int webpCodecAnimationGetFragment(const WebpCodecAnimation *animation, uint32_t index, WebPData *fragment);
+int webpCodecAnimationDecodeFragment(const WebpCodecAnimation *animation, uint32_t index, const WebPData *fragment,
+                                     uint8_t *pixels, size_t stride);
+void webpCodecAnimationDrawDecodedFrame(WebpCodecAnimation *animation, uint32_t index, uint8_t *canvas, size_t stride,
+                                        const uint8_t *pixels, size_t pixelStride);
+
+/**
+ * Allocates the ARGB plane of the picture unless it has the same size already.
+ */
+int webpCodecPreparePicture(WebPPicture *picture, size_t width, size_t height);
+
+/**
+ * Converts pixels of the layout into the ARGB plane of the prepared picture, the picture size is used.
+ */
+int webpCodecImportPixels(WebPPicture *picture, const uint8_t *pixels, size_t stride, const WebpPixelLayout *layout);
+
+/**
+ * Rescales the source into the target picture. The same picture is rescaled in place,
+ * otherwise the source is left untouched and the target gets its own memory.
+ */
+int webpCodecScalePicture(const WebPPicture *source, WebPPicture *target, int width, int height);
+
+/**
+ * Encodes the picture with the writer, the writer and its custom pointer are set on the picture.
+ */
+int webpCodecEncode(const WebPConfig *config, WebPPicture *picture, WebPWriterFunction writer, void *customPtr);
+
+/**
+ * Assembles the container, the output must be cleared with WebPDataClear.
+ */
+int webpCodecAssemble(WebPMux *mux, WebPData *output);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* WebpCodec_h */
@@ -0,0 +1,157 @@
+//
+//  WebpCompositor.c
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#include <string.h>
+
+#include "WebpCompositor.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define WEBP_COMPOSITOR_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define WEBP_COMPOSITOR_SSE2 1
+#endif
+
+// Rounded (value * factor) / 255 for value, factor in [0..255].
+static inline uint32_t webpMulDiv255(const uint32_t value, const uint32_t factor) {
+    const uint32_t t = value * factor + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+static inline void webpBlendPixels(uint8_t *dst, const uint8_t *src, size_t count) {
+    for (; count > 0; --count, dst += 4, src += 4) {
+        const uint32_t factor = 255 - src[3];
+        for (int channel = 0; channel < 4; ++channel) {
+            const uint32_t value = src[channel] + webpMulDiv255(dst[channel], factor);
+            dst[channel] = (uint8_t) (value > 255 ? 255 : value);
+        }
+    }
+}
+
+#if WEBP_COMPOSITOR_SSE2
+static inline __m128i webpBlendHalfSSE2(const __m128i src16, const __m128i dst16) {
+    const __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(src16, 0xFF), 0xFF);
+    const __m128i factor = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(dst16, factor), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+static void webpBlendRowSSE2(uint8_t *dst, const uint8_t *src, size_t count) {
+    const __m128i zero = _mm_setzero_si128();
+    for (; count >= 4; count -= 4, dst += 16, src += 16) {
+        const __m128i s = _mm_loadu_si128((const __m128i *) src);
+        const __m128i d = _mm_loadu_si128((const __m128i *) dst);
+        const __m128i lo = webpBlendHalfSSE2(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero));
+        const __m128i hi = webpBlendHalfSSE2(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero));
+        _mm_storeu_si128((__m128i *) dst, _mm_adds_epu8(s, _mm_packus_epi16(lo, hi)));
+    }
+    webpBlendPixels(dst, src, count);
+}
+#endif
+
+#if WEBP_COMPOSITOR_NEON
+static void webpBlendRowNEON(uint8_t *dst, const uint8_t *src, size_t count) {
+    const uint16x8_t half = vdupq_n_u16(128);
+    for (; count >= 8; count -= 8, dst += 32, src += 32) {
+        const uint8x8x4_t s = vld4_u8(src);
+        uint8x8x4_t d = vld4_u8(dst);
+        const uint8x8_t factor = vmvn_u8(s.val[3]);
+        for (int channel = 0; channel < 4; ++channel) {
+            const uint16x8_t t = vaddq_u16(vmull_u8(d.val[channel], factor), half);
+            d.val[channel] = vqadd_u8(s.val[channel], vshrn_n_u16(vsraq_n_u16(t, t, 8), 8));
+        }
+        vst4_u8(dst, d);
+    }
+    webpBlendPixels(dst, src, count);
+}
+#endif
+
+static inline int webpIsFullFrame(const WebpCompositorFrame *frame, int canvasWidth, int canvasHeight) {
+    return 0 == frame->x && 0 == frame->y && frame->width == canvasWidth && frame->height == canvasHeight;
+}
+
+void webpCompositorFindKeyFrames(WebpCompositorFrame *frames, size_t count, int canvasWidth, int canvasHeight) {
+    for (size_t index = 0; index < count; ++index) {
+        WebpCompositorFrame *frame = &frames[index];
+        int isKeyFrame = 0 == index
+                || (webpIsFullFrame(frame, canvasWidth, canvasHeight) && !webpCompositorIsBlended(frame));
+        if (!isKeyFrame) {
+            // The previous frame clears its own rectangle, which is the whole canvas if it is a key frame.
+            const WebpCompositorFrame *prevFrame = &frames[index - 1];
+            isKeyFrame = prevFrame->disposeToBackground
+                    && (webpIsFullFrame(prevFrame, canvasWidth, canvasHeight) || prevFrame->keyFrame == index - 1);
+        }
+        frame->keyFrame = isKeyFrame ? (uint32_t) index : frames[index - 1].keyFrame;
+    }
+}
+
+void webpCompositorClearRect(uint8_t *pixels, size_t stride,
+                             size_t x, size_t y, size_t width, size_t height) {
+    if (!pixels || 0 == width) {
+        return;
+    }
+    uint8_t *row = pixels + y * stride + x * 4;
+    for (size_t rowIdx = 0; rowIdx < height; ++rowIdx, row += stride) {
+        memset(row, 0, width * 4);
+    }
+}
+
+void webpCompositorCopyRect(uint8_t *dst, size_t dstStride,
+                            const uint8_t *src, size_t srcStride,
+                            size_t width, size_t height) {
+    if (!dst || !src || 0 == width) {
+        return;
+    }
+    for (size_t rowIdx = 0; rowIdx < height; ++rowIdx, dst += dstStride, src += srcStride) {
+        memcpy(dst, src, width * 4);
+    }
+}
+
+void webpCompositorBlendRectScalar(uint8_t *dst, size_t dstStride,
+                                   const uint8_t *src, size_t srcStride,
+                                   size_t width, size_t height) {
+    if (!dst || !src) {
+        return;
+    }
+    for (size_t rowIdx = 0; rowIdx < height; ++rowIdx, dst += dstStride, src += srcStride) {
+        webpBlendPixels(dst, src, width);
+    }
+}
+
+void webpCompositorBlendRect(uint8_t *dst, size_t dstStride,
+                             const uint8_t *src, size_t srcStride,
+                             size_t width, size_t height) {
+#if WEBP_COMPOSITOR_NEON
+    if (!dst || !src) {
+        return;
+    }
+    for (size_t rowIdx = 0; rowIdx < height; ++rowIdx, dst += dstStride, src += srcStride) {
+        webpBlendRowNEON(dst, src, width);
+    }
+#elif WEBP_COMPOSITOR_SSE2
+    if (!dst || !src) {
+        return;
+    }
+    for (size_t rowIdx = 0; rowIdx < height; ++rowIdx, dst += dstStride, src += srcStride) {
+        webpBlendRowSSE2(dst, src, width);
+    }
+#else
+    webpCompositorBlendRectScalar(dst, dstStride, src, srcStride, width, height);
+#endif
+}
+
+const char *webpCompositorKernelName(void) {
+#if WEBP_COMPOSITOR_NEON
+    return "neon";
+#elif WEBP_COMPOSITOR_SSE2
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
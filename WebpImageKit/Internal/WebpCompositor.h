@@ -0,0 +1,91 @@
+//
+//  WebpCompositor.h
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#ifndef WebpCompositor_h
+#define WebpCompositor_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * Animation canvas kernels. All buffers contain premultiplied BGRA pixels (MODE_bgrA),
+ * which matches kCGBitmapByteOrder32Host | kCGImageAlphaPremultipliedFirst on little-endian
+ * hosts. Rectangles must lie inside the buffers, callers are responsible for clipping.
+ */
+
+/**
+ * Animation frame as it is drawn on the canvas.
+ */
+typedef struct {
+    int x;                      // rectangle on the canvas
+    int y;
+    int width;
+    int height;
+    int duration;               // milliseconds
+    int disposeToBackground;    // WEBP_MUX_DISPOSE_BACKGROUND, the rectangle is cleared before the next frame
+    int blend;                  // WEBP_MUX_BLEND, the frame is drawn over the canvas
+    int hasAlpha;
+    uint32_t keyFrame;          // index of the nearest frame at or before this one which doesn't depend on previous frames
+} WebpCompositorFrame;
+
+/**
+ * Whether the frame is drawn over the canvas, otherwise it replaces its rectangle.
+ */
+static inline int webpCompositorIsBlended(const WebpCompositorFrame *frame) {
+    return frame->blend && frame->hasAlpha;
+}
+
+/**
+ * Fills `keyFrame` of the frames with the rules of libwebp's WebPAnimDecoder: a key frame either
+ * replaces the whole canvas, or is drawn on the canvas cleared by the dispose method of the previous frame.
+ */
+void webpCompositorFindKeyFrames(WebpCompositorFrame *frames, size_t count, int canvasWidth, int canvasHeight);
+
+/**
+ * Fills the rectangle with transparent pixels (WEBP_MUX_DISPOSE_BACKGROUND).
+ */
+void webpCompositorClearRect(uint8_t *pixels, size_t stride,
+                             size_t x, size_t y, size_t width, size_t height);
+
+/**
+ * Replaces destination pixels with source pixels (WEBP_MUX_NO_BLEND).
+ */
+void webpCompositorCopyRect(uint8_t *dst, size_t dstStride,
+                            const uint8_t *src, size_t srcStride,
+                            size_t width, size_t height);
+
+/**
+ * Draws source pixels over destination pixels (WEBP_MUX_BLEND), dst = src + dst * (1 - src.alpha).
+ * Uses NEON or SSE2 kernels when available.
+ */
+void webpCompositorBlendRect(uint8_t *dst, size_t dstStride,
+                             const uint8_t *src, size_t srcStride,
+                             size_t width, size_t height);
+
+/**
+ * Scalar version of `webpCompositorBlendRect`, produces identical output. Used as a reference
+ * for benchmarks of the vectorized kernels.
+ */
+void webpCompositorBlendRectScalar(uint8_t *dst, size_t dstStride,
+                                   const uint8_t *src, size_t srcStride,
+                                   size_t width, size_t height);
+
+/**
+ * Name of the blend kernel selected at build time ("neon", "sse2" or "scalar").
+ */
+const char *webpCompositorKernelName(void);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* WebpCompositor_h */
@@ -0,0 +1,161 @@
+//
+//  WebpContainer.c
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#include <string.h>
+
+#include "WebpContainer.h"
+
+#define WEBP_RIFF_HEADER_SIZE 12
+#define WEBP_CHUNK_HEADER_SIZE 8
+#define WEBP_ANMF_HEADER_SIZE 16
+
+#define WEBP_VP8X_ALPHA_FLAG 0x10
+
+static inline uint32_t webpReadLE16(const uint8_t *bytes) {
+    return (uint32_t) bytes[0] | ((uint32_t) bytes[1] << 8);
+}
+
+static inline uint32_t webpReadLE24(const uint8_t *bytes) {
+    return webpReadLE16(bytes) | ((uint32_t) bytes[2] << 16);
+}
+
+static inline uint32_t webpReadLE32(const uint8_t *bytes) {
+    return webpReadLE24(bytes) | ((uint32_t) bytes[3] << 24);
+}
+
+static inline int webpIsChunk(const uint8_t *chunk, const char fourcc[4]) {
+    return 0 == memcmp(chunk, fourcc, 4);
+}
+
+typedef struct {
+    uint32_t width;
+    uint32_t height;
+    int hasAlpha;
+    WebpContainerFormat format;
+} WebpBitstreamInfo;
+
+// Reads VP8/VP8L/ALPH chunks of a still image or of an ANMF frame payload.
+static int webpParseBitstreamChunks(const uint8_t *bytes, size_t size, WebpBitstreamInfo *info) {
+    size_t offset = 0;
+    while (offset + WEBP_CHUNK_HEADER_SIZE <= size) {
+        const uint8_t *chunk = bytes + offset;
+        const uint32_t chunkSize = webpReadLE32(chunk + 4);
+        const uint8_t *payload = chunk + WEBP_CHUNK_HEADER_SIZE;
+        const size_t available = size - offset - WEBP_CHUNK_HEADER_SIZE;
+        if (webpIsChunk(chunk, "ALPH")) {
+            info->hasAlpha = 1;
+        }
+        else if (webpIsChunk(chunk, "VP8 ")) {
+            info->format = WebpContainerFormatLossy;
+            // 3 bytes frame tag, 3 bytes start code, then 14 bit dimensions with 2 bit scale.
+            if (available >= 10 && chunkSize >= 10) {
+                info->width = webpReadLE16(payload + 6) & 0x3fff;
+                info->height = webpReadLE16(payload + 8) & 0x3fff;
+            }
+            return 1;
+        }
+        else if (webpIsChunk(chunk, "VP8L")) {
+            info->format = WebpContainerFormatLossless;
+            // Signature byte, then 14 bit width - 1, 14 bit height - 1 and alpha hint bit.
+            if (available >= 5 && chunkSize >= 5 && 0x2f == payload[0]) {
+                const uint32_t bits = webpReadLE32(payload + 1);
+                info->width = (bits & 0x3fff) + 1;
+                info->height = ((bits >> 14) & 0x3fff) + 1;
+                info->hasAlpha |= (int) ((bits >> 28) & 1);
+            }
+            return 1;
+        }
+        offset += WEBP_CHUNK_HEADER_SIZE + (size_t) chunkSize + (chunkSize & 1);
+    }
+    return 0;
+}
+
+int webpContainerHasSignature(const uint8_t *bytes, size_t size) {
+    return bytes && size >= WEBP_RIFF_HEADER_SIZE
+            && 0 == memcmp(bytes, "RIFF", 4)
+            && 0 == memcmp(bytes + 8, "WEBP", 4);
+}
+
+int webpContainerParse(const uint8_t *bytes, size_t size, WebpContainerInfo *info) {
+    if (!info || !webpContainerHasSignature(bytes, size)) {
+        return 0;
+    }
+    memset(info, 0, sizeof(WebpContainerInfo));
+    const uint64_t riffEnd = (uint64_t) webpReadLE32(bytes + 4) + 8;
+    const size_t end = riffEnd < size ? (size_t) riffEnd : size;
+    int hasExtendedHeader = 0;
+    int hasFormat = 0;
+    size_t offset = WEBP_RIFF_HEADER_SIZE;
+    while (offset + WEBP_CHUNK_HEADER_SIZE <= end) {
+        const uint8_t *chunk = bytes + offset;
+        const uint32_t chunkSize = webpReadLE32(chunk + 4);
+        const uint8_t *payload = chunk + WEBP_CHUNK_HEADER_SIZE;
+        const size_t available = end - offset - WEBP_CHUNK_HEADER_SIZE;
+        const size_t payloadSize = chunkSize < available ? chunkSize : available;
+        if (webpIsChunk(chunk, "VP8X")) {
+            if (payloadSize < 10) {
+                break;
+            }
+            hasExtendedHeader = 1;
+            info->hasAlpha = 0 != (payload[0] & WEBP_VP8X_ALPHA_FLAG);
+            info->canvasWidth = webpReadLE24(payload + 4) + 1;
+            info->canvasHeight = webpReadLE24(payload + 7) + 1;
+        }
+        else if (webpIsChunk(chunk, "ANIM")) {
+            info->isAnimated = 1;
+            if (payloadSize >= 6) {
+                info->loopCount = webpReadLE16(payload + 4);
+            }
+        }
+        else if (webpIsChunk(chunk, "ANMF")) {
+            info->isAnimated = 1;
+            info->frameCount++;
+            if (payloadSize >= WEBP_ANMF_HEADER_SIZE) {
+                info->duration += webpReadLE24(payload + 12);
+                WebpBitstreamInfo frame = {0};
+                if (webpParseBitstreamChunks(payload + WEBP_ANMF_HEADER_SIZE,
+                                             payloadSize - WEBP_ANMF_HEADER_SIZE,
+                                             &frame)) {
+                    if (!hasFormat) {
+                        info->format = frame.format;
+                        hasFormat = 1;
+                    }
+                    else if (info->format != frame.format) {
+                        info->format = WebpContainerFormatUndefined;
+                    }
+                }
+            }
+        }
+        else if (webpIsChunk(chunk, "ICCP")) {
+            info->hasICC = 1;
+        }
+        else if (webpIsChunk(chunk, "EXIF")) {
+            info->hasEXIF = 1;
+        }
+        else if (webpIsChunk(chunk, "XMP ")) {
+            info->hasXMP = 1;
+        }
+        else if (!hasFormat && (webpIsChunk(chunk, "ALPH") || webpIsChunk(chunk, "VP8 ") || webpIsChunk(chunk, "VP8L"))) {
+            // Image data of a still image, the alpha chunk precedes the VP8 one.
+            WebpBitstreamInfo image = {0};
+            hasFormat = webpParseBitstreamChunks(chunk, end - offset, &image);
+            info->format = image.format;
+            info->frameCount = 1;
+            if (!hasExtendedHeader) {
+                info->canvasWidth = image.width;
+                info->canvasHeight = image.height;
+                info->hasAlpha = image.hasAlpha;
+            }
+            if (!hasExtendedHeader || !hasFormat) {
+                break;
+            }
+        }
+        offset += WEBP_CHUNK_HEADER_SIZE + (size_t) chunkSize + (chunkSize & 1);
+    }
+    return 0 < info->canvasWidth && 0 < info->canvasHeight;
+}
@@ -0,0 +1,57 @@
+//
+//  WebpContainer.h
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#ifndef WebpContainer_h
+#define WebpContainer_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+typedef enum {
+    WebpContainerFormatUndefined = 0,  // unknown or mixed (animations with lossy and lossless frames)
+    WebpContainerFormatLossy = 1,
+    WebpContainerFormatLossless = 2
+} WebpContainerFormat;
+
+typedef struct {
+    uint32_t canvasWidth;
+    uint32_t canvasHeight;
+    int hasAlpha;
+    int isAnimated;
+    uint32_t frameCount;
+    uint32_t loopCount;
+    uint64_t duration;          // sum of frame durations in milliseconds
+    WebpContainerFormat format;
+    int hasICC;
+    int hasEXIF;
+    int hasXMP;
+} WebpContainerInfo;
+
+/**
+ * Returns non-zero if the bytes start with the RIFF/WEBP signature.
+ */
+int webpContainerHasSignature(const uint8_t *bytes, size_t size);
+
+/**
+ * Reads image properties from the RIFF header and the chunk table without decoding
+ * and without allocating memory. Payloads are skipped except for the few bytes of
+ * the chunk headers. Truncated data is parsed as far as it goes.
+ *
+ * @return Non-zero if at least the canvas size is known.
+ */
+int webpContainerParse(const uint8_t *bytes, size_t size, WebpContainerInfo *info);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* WebpContainer_h */
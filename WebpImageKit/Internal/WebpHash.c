@@ -0,0 +1,68 @@
+//
+//  WebpHash.c
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#include <string.h>
+
+#include "WebpHash.h"
+
+#define WEBP_HASH_PRIME1 0x9e3779b185ebca87ULL
+#define WEBP_HASH_PRIME2 0xc2b2ae3d27d4eb4fULL
+#define WEBP_HASH_PRIME3 0x165667b19e3779f9ULL
+
+static inline uint64_t webpHashRotl(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static inline uint64_t webpHashRead64(const uint8_t *bytes) {
+    uint64_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+static inline uint64_t webpHashRound(uint64_t acc, uint64_t input) {
+    acc += input * WEBP_HASH_PRIME2;
+    return webpHashRotl(acc, 31) * WEBP_HASH_PRIME1;
+}
+
+// Final avalanche, every input bit affects every output bit.
+static inline uint64_t webpHashMix(uint64_t value) {
+    value ^= value >> 33;
+    value *= WEBP_HASH_PRIME2;
+    value ^= value >> 29;
+    value *= WEBP_HASH_PRIME3;
+    value ^= value >> 32;
+    return value;
+}
+
+uint64_t webpHash64(const void *bytes, size_t size, uint64_t seed) {
+    const uint8_t *data = (const uint8_t *) bytes;
+    const uint8_t *end = data + size;
+    // Four independent lanes keep the multipliers busy, like xxHash64.
+    uint64_t lanes[4] = {
+            seed + WEBP_HASH_PRIME1 + WEBP_HASH_PRIME2,
+            seed + WEBP_HASH_PRIME2,
+            seed,
+            seed - WEBP_HASH_PRIME1
+    };
+    for (; end - data >= 32; data += 32) {
+        lanes[0] = webpHashRound(lanes[0], webpHashRead64(data));
+        lanes[1] = webpHashRound(lanes[1], webpHashRead64(data + 8));
+        lanes[2] = webpHashRound(lanes[2], webpHashRead64(data + 16));
+        lanes[3] = webpHashRound(lanes[3], webpHashRead64(data + 24));
+    }
+    uint64_t hash = webpHashRotl(lanes[0], 1) + webpHashRotl(lanes[1], 7)
+            + webpHashRotl(lanes[2], 12) + webpHashRotl(lanes[3], 18);
+    hash += (uint64_t) size;
+    for (; end - data >= 8; data += 8) {
+        hash = webpHashRotl(hash ^ webpHashRound(0, webpHashRead64(data)), 27) * WEBP_HASH_PRIME1 + WEBP_HASH_PRIME3;
+    }
+    for (; data < end; ++data) {
+        hash = webpHashRotl(hash ^ (*data * WEBP_HASH_PRIME3), 11) * WEBP_HASH_PRIME1;
+    }
+    return webpHashMix(hash);
+}
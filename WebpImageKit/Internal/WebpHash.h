@@ -0,0 +1,28 @@
+//
+//  WebpHash.h
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#ifndef WebpHash_h
+#define WebpHash_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * Fast non-cryptographic 64-bit hash of the bytes, processes 32 bytes per step.
+ */
+uint64_t webpHash64(const void *bytes, size_t size, uint64_t seed);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* WebpHash_h */
@@ -34,6 +34,14 @@ void webp_execCleanupBlock(__strong webp_cleanup_block *block);
 
 #define meta_macro_concat_(A, B) A ## B
 
+NS_INLINE NSUInteger webpConcurrencyLimit(void) {
+    return MAX(NSProcessInfo.processInfo.activeProcessorCount, (NSUInteger) 1);
+}
+
+NS_INLINE size_t webpByteAlign(size_t size, size_t alignment) {
+    return ((size + (alignment - 1)) / alignment) * alignment;
+}
+
 NS_INLINE CGSize scaledImageSize(const CGSize imgSize, const CGSize targetSize, const CGFloat scaleFactor) {
     __auto_type rWidth = imgSize.width;
     __auto_type rHeight = imgSize.height;
@@ -0,0 +1,161 @@
+//
+//  WebpMemoryBudget.c
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "WebpMemoryBudget.h"
+
+#define WEBP_BUDGET_DEFAULT_LIMIT ((size_t) 256 << 20)
+#define WEBP_BUDGET_DEFAULT_TIMEOUT 10.0
+
+static pthread_mutex_t webpBudgetLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t webpBudgetCondition = PTHREAD_COND_INITIALIZER;
+static WebpMemoryBudgetStats webpBudgetStats = { .limit = WEBP_BUDGET_DEFAULT_LIMIT };
+static WebpMemoryPolicy webpBudgetPolicy = WebpMemoryPolicyDownscale;
+static double webpBudgetTimeout = WEBP_BUDGET_DEFAULT_TIMEOUT;
+
+static inline size_t webpBudgetAvailable(void) {
+    return webpBudgetStats.used < webpBudgetStats.limit ? webpBudgetStats.limit - webpBudgetStats.used : 0;
+}
+
+// Called under the lock.
+static inline int webpBudgetFits(size_t size) {
+    return 0 == webpBudgetStats.limit || size <= webpBudgetAvailable() || 0 == webpBudgetStats.used;
+}
+
+// Called under the lock.
+static inline size_t webpBudgetGrant(size_t size) {
+    webpBudgetStats.used += size;
+    if (webpBudgetStats.peak < webpBudgetStats.used) {
+        webpBudgetStats.peak = webpBudgetStats.used;
+    }
+    return size;
+}
+
+// Waits until `size` fits or the timeout expires. Called under the lock.
+static int webpBudgetWait(size_t size) {
+    ++webpBudgetStats.waitCount;
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    const double deadline = (double) now.tv_sec + now.tv_usec / 1e6 + webpBudgetTimeout;
+    const struct timespec timeout = {
+            .tv_sec = (time_t) deadline,
+            .tv_nsec = (long) ((deadline - floor(deadline)) * 1e9)
+    };
+    while (!webpBudgetFits(size)) {
+        if (ETIMEDOUT == pthread_cond_timedwait(&webpBudgetCondition, &webpBudgetLock, &timeout)) {
+            return webpBudgetFits(size);
+        }
+    }
+    return 1;
+}
+
+size_t webpMemoryBudgetReserve(size_t size, size_t minSize) {
+    if (0 == size) {
+        return 0;
+    }
+    minSize = minSize < size ? minSize : size;
+    size_t result = 0;
+    pthread_mutex_lock(&webpBudgetLock);
+    if (webpBudgetFits(size)) {
+        result = webpBudgetGrant(size);
+    }
+    else if (WebpMemoryPolicyDownscale == webpBudgetPolicy && minSize < size && minSize <= webpBudgetAvailable()) {
+        ++webpBudgetStats.downscaledCount;
+        result = webpBudgetGrant(webpBudgetAvailable());
+    }
+    else if (WebpMemoryPolicyFail != webpBudgetPolicy) {
+        // Downscaling waits for the minimum size only, the rest of the budget may stay in use for long.
+        const size_t waitSize = WebpMemoryPolicyDownscale == webpBudgetPolicy ? minSize : size;
+        if (webpBudgetWait(waitSize)) {
+            const size_t available = webpBudgetAvailable();
+            const size_t grantSize = size <= available || 0 == webpBudgetStats.limit || waitSize == size
+                    ? size
+                    : (available > waitSize ? available : waitSize);
+            if (grantSize < size) {
+                ++webpBudgetStats.downscaledCount;
+            }
+            result = webpBudgetGrant(grantSize);
+        }
+    }
+    if (0 == result) {
+        ++webpBudgetStats.failedCount;
+    }
+    pthread_mutex_unlock(&webpBudgetLock);
+    return result;
+}
+
+void webpMemoryBudgetCharge(size_t size) {
+    pthread_mutex_lock(&webpBudgetLock);
+    webpBudgetGrant(size);
+    pthread_mutex_unlock(&webpBudgetLock);
+}
+
+void webpMemoryBudgetRelease(size_t size) {
+    if (0 == size) {
+        return;
+    }
+    pthread_mutex_lock(&webpBudgetLock);
+    webpBudgetStats.used -= size < webpBudgetStats.used ? size : webpBudgetStats.used;
+    pthread_cond_broadcast(&webpBudgetCondition);
+    pthread_mutex_unlock(&webpBudgetLock);
+}
+
+void webpMemoryBudgetSetLimit(size_t limit) {
+    pthread_mutex_lock(&webpBudgetLock);
+    webpBudgetStats.limit = limit;
+    pthread_cond_broadcast(&webpBudgetCondition);
+    pthread_mutex_unlock(&webpBudgetLock);
+}
+
+void webpMemoryBudgetSetPolicy(WebpMemoryPolicy policy) {
+    pthread_mutex_lock(&webpBudgetLock);
+    webpBudgetPolicy = policy;
+    pthread_mutex_unlock(&webpBudgetLock);
+}
+
+WebpMemoryPolicy webpMemoryBudgetGetPolicy(void) {
+    pthread_mutex_lock(&webpBudgetLock);
+    const WebpMemoryPolicy policy = webpBudgetPolicy;
+    pthread_mutex_unlock(&webpBudgetLock);
+    return policy;
+}
+
+void webpMemoryBudgetSetWaitTimeout(double timeout) {
+    pthread_mutex_lock(&webpBudgetLock);
+    webpBudgetTimeout = timeout > 0.0 ? timeout : 0.0;
+    pthread_mutex_unlock(&webpBudgetLock);
+}
+
+double webpMemoryBudgetGetWaitTimeout(void) {
+    pthread_mutex_lock(&webpBudgetLock);
+    const double timeout = webpBudgetTimeout;
+    pthread_mutex_unlock(&webpBudgetLock);
+    return timeout;
+}
+
+void webpMemoryBudgetGetStats(WebpMemoryBudgetStats *stats) {
+    if (!stats) {
+        return;
+    }
+    pthread_mutex_lock(&webpBudgetLock);
+    *stats = webpBudgetStats;
+    pthread_mutex_unlock(&webpBudgetLock);
+}
+
+void webpMemoryBudgetResetStats(void) {
+    pthread_mutex_lock(&webpBudgetLock);
+    webpBudgetStats.peak = webpBudgetStats.used;
+    webpBudgetStats.downscaledCount = 0;
+    webpBudgetStats.waitCount = 0;
+    webpBudgetStats.failedCount = 0;
+    pthread_mutex_unlock(&webpBudgetLock);
+}
@@ -0,0 +1,86 @@
+//
+//  WebpMemoryBudget.h
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#ifndef WebpMemoryBudget_h
+#define WebpMemoryBudget_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * Process wide budget of pixel memory used by decodes in flight. Decoders reserve the memory
+ * of their canvases and frame buffers before allocating them and release it when the decode is
+ * done. What happens to a request which doesn't fit depends on the policy.
+ * All functions are thread-safe.
+ */
+
+typedef enum {
+    WebpMemoryPolicyDownscale = 0,  // grant what is left down to the minimum size, then wait
+    WebpMemoryPolicyWait = 1,       // wait until the whole size fits
+    WebpMemoryPolicyFail = 2        // fail right away
+} WebpMemoryPolicy;
+
+typedef struct {
+    size_t limit;
+    size_t used;
+    size_t peak;
+    uint64_t downscaledCount;   // requests granted less than they asked for
+    uint64_t waitCount;         // requests which had to wait
+    uint64_t failedCount;       // requests which got nothing
+} WebpMemoryBudgetStats;
+
+/**
+ * Reserves memory for a decode. Under the downscale policy the request may be granted less than
+ * `size`, but at least `minSize`; pass the same value for both when the size can't change.
+ * A request larger than the whole budget is granted once nothing else is reserved.
+ * Waiting requests fail after the wait timeout.
+ *
+ * @return Reserved number of bytes, or 0 if the request failed.
+ */
+size_t webpMemoryBudgetReserve(size_t size, size_t minSize);
+
+/**
+ * Accounts memory which can't wait or fail, like canvases of on-screen animations.
+ * It is released with `webpMemoryBudgetRelease`.
+ */
+void webpMemoryBudgetCharge(size_t size);
+
+/**
+ * Returns reserved or charged memory to the budget and wakes up waiting requests.
+ */
+void webpMemoryBudgetRelease(size_t size);
+
+/**
+ * Sets the budget size in bytes, 0 disables the limit.
+ */
+void webpMemoryBudgetSetLimit(size_t limit);
+void webpMemoryBudgetSetPolicy(WebpMemoryPolicy policy);
+WebpMemoryPolicy webpMemoryBudgetGetPolicy(void);
+
+/**
+ * Sets how long requests wait for memory, in seconds.
+ */
+void webpMemoryBudgetSetWaitTimeout(double timeout);
+double webpMemoryBudgetGetWaitTimeout(void);
+
+void webpMemoryBudgetGetStats(WebpMemoryBudgetStats *stats);
+
+/**
+ * Resets the peak usage to the current usage and clears the counters.
+ */
+void webpMemoryBudgetResetStats(void);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* WebpMemoryBudget_h */
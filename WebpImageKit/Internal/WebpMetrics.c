@@ -0,0 +1,202 @@
+//
+//  WebpMetrics.c
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "WebpMetrics.h"
+
+// Stages of worker threads, merged into the report of the owning operation when it ends.
+struct WebpMetricsShared {
+    atomic_int refCount;
+    pthread_mutex_t lock;
+    int isOpen;
+    size_t memory;
+    WebpMetricsReport report;
+};
+
+typedef struct {
+    int depth;
+    uint64_t start;
+    size_t memory;
+    WebpMetricsReport report;
+    WebpMetricsShared *shared;      // handed to the workers of the operation
+    WebpMetricsShared *attached;    // operation of another thread this worker accounts to
+} WebpMetricsState;
+
+atomic_int webpMetricsEnabled = 0;
+
+static pthread_rwlock_t webpMetricsLock = PTHREAD_RWLOCK_INITIALIZER;
+static WebpMetricsHandler webpMetricsHandler = NULL;
+static void *webpMetricsContext = NULL;
+static _Thread_local WebpMetricsState webpMetricsState;
+
+static inline uint64_t webpMetricsNow(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+}
+
+static void webpMetricsDeliver(const WebpMetricsReport *report) {
+    pthread_rwlock_rdlock(&webpMetricsLock);
+    if (webpMetricsHandler) {
+        webpMetricsHandler(report, webpMetricsContext);
+    }
+    pthread_rwlock_unlock(&webpMetricsLock);
+}
+
+void webpMetricsSetHandler(WebpMetricsHandler handler, void *context) {
+    pthread_rwlock_wrlock(&webpMetricsLock);
+    webpMetricsHandler = handler;
+    webpMetricsContext = context;
+    atomic_store(&webpMetricsEnabled, NULL != handler);
+    pthread_rwlock_unlock(&webpMetricsLock);
+}
+
+uint64_t webpMetricsStageBegin(void) {
+    return webpMetricsIsEnabled() ? webpMetricsNow() : 0;
+}
+
+void webpMetricsStageEnd(WebpMetricsStage stage, uint64_t start, size_t bytes) {
+    if (0 == start || stage >= WebpMetricsStageCount) {
+        return;
+    }
+    const uint64_t duration = webpMetricsNow() - start;
+    WebpMetricsState *state = &webpMetricsState;
+    if (0 < state->depth) {
+        state->report.stageDuration[stage] += duration;
+        state->report.stageBytes[stage] += bytes;
+        return;
+    }
+    WebpMetricsShared *shared = state->attached;
+    if (shared) {
+        pthread_mutex_lock(&shared->lock);
+        if (shared->isOpen) {
+            shared->report.stageDuration[stage] += duration;
+            shared->report.stageBytes[stage] += bytes;
+        }
+        pthread_mutex_unlock(&shared->lock);
+        return;
+    }
+    WebpMetricsReport report;
+    memset(&report, 0, sizeof(report));
+    report.duration = duration;
+    report.stageDuration[stage] = duration;
+    report.stageBytes[stage] = bytes;
+    webpMetricsDeliver(&report);
+}
+
+void webpMetricsOperationBegin(WebpMetricsOperation operation) {
+    WebpMetricsState *state = &webpMetricsState;
+    // Operations started while disabled are still counted, so the nesting stays balanced.
+    if (0 < state->depth++ || !webpMetricsIsEnabled()) {
+        return;
+    }
+    memset(&state->report, 0, sizeof(state->report));
+    state->report.operation = operation;
+    state->memory = 0;
+    state->start = webpMetricsNow();
+}
+
+void webpMetricsOperationEnd(void) {
+    WebpMetricsState *state = &webpMetricsState;
+    if (0 >= state->depth || 0 < --state->depth || 0 == state->start) {
+        return;
+    }
+    state->report.duration = webpMetricsNow() - state->start;
+    state->start = 0;
+    WebpMetricsShared *shared = state->shared;
+    if (shared) {
+        state->shared = NULL;
+        pthread_mutex_lock(&shared->lock);
+        shared->isOpen = 0;
+        for (int stage = 0; stage < WebpMetricsStageCount; ++stage) {
+            state->report.stageDuration[stage] += shared->report.stageDuration[stage];
+            state->report.stageBytes[stage] += shared->report.stageBytes[stage];
+        }
+        // Peaks of the threads aren't synchronized, their sum is the upper bound.
+        state->report.peakMemory += shared->report.peakMemory;
+        pthread_mutex_unlock(&shared->lock);
+        webpMetricsSharedRelease(shared);
+    }
+    webpMetricsDeliver(&state->report);
+}
+
+WebpMetricsShared *webpMetricsOperationShare(void) {
+    WebpMetricsState *state = &webpMetricsState;
+    if (0 == state->start) {
+        return NULL;
+    }
+    if (!state->shared) {
+        WebpMetricsShared *shared = calloc(1, sizeof(WebpMetricsShared));
+        if (!shared) {
+            return NULL;
+        }
+        // The operation holds one reference until it ends.
+        atomic_init(&shared->refCount, 1);
+        pthread_mutex_init(&shared->lock, NULL);
+        shared->isOpen = 1;
+        state->shared = shared;
+    }
+    atomic_fetch_add(&state->shared->refCount, 1);
+    return state->shared;
+}
+
+void webpMetricsSharedRelease(WebpMetricsShared *shared) {
+    if (shared && 1 == atomic_fetch_sub(&shared->refCount, 1)) {
+        pthread_mutex_destroy(&shared->lock);
+        free(shared);
+    }
+}
+
+void webpMetricsOperationAttach(WebpMetricsShared *shared) {
+    webpMetricsState.attached = shared;
+}
+
+void webpMetricsOperationDetach(void) {
+    webpMetricsState.attached = NULL;
+}
+
+void webpMetricsMemoryAcquired(size_t size) {
+    WebpMetricsState *state = &webpMetricsState;
+    WebpMetricsShared *shared = state->attached;
+    if (0 == state->start && shared) {
+        pthread_mutex_lock(&shared->lock);
+        shared->memory += size;
+        if (shared->report.peakMemory < shared->memory) {
+            shared->report.peakMemory = shared->memory;
+        }
+        pthread_mutex_unlock(&shared->lock);
+        return;
+    }
+    if (0 == state->start) {
+        return;
+    }
+    state->memory += size;
+    if (state->report.peakMemory < state->memory) {
+        state->report.peakMemory = state->memory;
+    }
+}
+
+void webpMetricsMemoryReleased(size_t size) {
+    WebpMetricsState *state = &webpMetricsState;
+    WebpMetricsShared *shared = state->attached;
+    if (0 == state->start && shared) {
+        pthread_mutex_lock(&shared->lock);
+        shared->memory = size < shared->memory ? shared->memory - size : 0;
+        pthread_mutex_unlock(&shared->lock);
+        return;
+    }
+    if (0 == state->start) {
+        return;
+    }
+    // Buffers acquired before the operation may be released during it.
+    state->memory = size < state->memory ? state->memory - size : 0;
+}
@@ -0,0 +1,117 @@
+//
+//  WebpMetrics.h
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#ifndef WebpMetrics_h
+#define WebpMetrics_h
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * Timing of pipeline stages. Stages are accumulated per operation on the thread which runs it,
+ * the report is delivered to the handler when the outermost operation ends. Worker threads of
+ * an operation attach to it with `webpMetricsOperationShare`, other stages which run outside
+ * of an operation are reported one by one.
+ * While no handler is set, every call costs one relaxed atomic load.
+ * All functions are thread-safe.
+ */
+
+typedef enum {
+    WebpMetricsStageDemux = 0,      // container parsing
+    WebpMetricsStageDecode,         // bitstream decode
+    WebpMetricsStageColorSpace,     // color space creation from the ICC profile
+    WebpMetricsStageComposite,      // animation frames blending
+    WebpMetricsStageRescale,        // image rescaling
+    WebpMetricsStageImport,         // pixel conversion into the encoder picture
+    WebpMetricsStageEncode,         // WebPEncode
+    WebpMetricsStageMux,            // container assembly
+    WebpMetricsStageCount
+} WebpMetricsStage;
+
+typedef enum {
+    WebpMetricsOperationNone = 0,   // stages outside of an operation
+    WebpMetricsOperationDecode,
+    WebpMetricsOperationEncode,
+    WebpMetricsOperationTransmux
+} WebpMetricsOperation;
+
+typedef struct {
+    WebpMetricsOperation operation;
+    uint64_t duration;                              // nanoseconds from the start to the end of the operation
+    uint64_t stageDuration[WebpMetricsStageCount];  // nanoseconds, nested stages are included in their parents
+    uint64_t stageBytes[WebpMetricsStageCount];     // bytes produced by the stage
+    size_t peakMemory;                              // peak of pixel and picture buffers held by the operation
+} WebpMetricsReport;
+
+typedef void (*WebpMetricsHandler)(const WebpMetricsReport *report, void *context);
+
+extern atomic_int webpMetricsEnabled;
+
+static inline int webpMetricsIsEnabled(void) {
+    return atomic_load_explicit(&webpMetricsEnabled, memory_order_relaxed);
+}
+
+/**
+ * Sets the handler, NULL disables the metrics. The handler is called on the thread of the
+ * operation and must be thread-safe.
+ */
+void webpMetricsSetHandler(WebpMetricsHandler handler, void *context);
+
+/**
+ * Returns the start time of the stage to pass to `webpMetricsStageEnd`, 0 while disabled.
+ */
+uint64_t webpMetricsStageBegin(void);
+
+/**
+ * Accounts the stage time since `start` and the bytes it produced.
+ */
+void webpMetricsStageEnd(WebpMetricsStage stage, uint64_t start, size_t bytes);
+
+/**
+ * Starts the operation. Nested operations are merged into the outermost one.
+ */
+void webpMetricsOperationBegin(WebpMetricsOperation operation);
+
+/**
+ * Ends the operation and reports it if it is the outermost one.
+ */
+void webpMetricsOperationEnd(void);
+
+typedef struct WebpMetricsShared WebpMetricsShared;
+
+/**
+ * Returns the operation of the current thread for its worker threads, NULL outside of an
+ * operation or while disabled. Stages of the workers are merged into the report when the
+ * operation ends, so workers must detach before that. Release it with `webpMetricsSharedRelease`.
+ */
+WebpMetricsShared *webpMetricsOperationShare(void);
+void webpMetricsSharedRelease(WebpMetricsShared *shared);
+
+/**
+ * Accounts stages and buffers of the current thread to the shared operation until detached.
+ * Attaching NULL is allowed, the stages are reported one by one then.
+ */
+void webpMetricsOperationAttach(WebpMetricsShared *shared);
+void webpMetricsOperationDetach(void);
+
+/**
+ * Accounts buffers allocated and freed by the operation on the current thread.
+ */
+void webpMetricsMemoryAcquired(size_t size);
+void webpMetricsMemoryReleased(size_t size);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* WebpMetrics_h */
@@ -0,0 +1,43 @@
+//
+//  WebpModeSelection.h
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#ifndef WebpModeSelection_h
+#define WebpModeSelection_h
+
+#import <Foundation/Foundation.h>
+#import <libwebp/encode.h>
+
+#define WEBP_AUTO_MODE_MIN_PSNR 40.0f   // quality a lossy result needs to win over the lossless one
+
+typedef NS_ENUM(NSInteger, WebpPictureContent) {
+    WebpPictureContentMixed = 0,    // no clear winner, both modes have to be tried
+    WebpPictureContentNatural,      // photos and gradients, lossy compression
+    WebpPictureContentSynthetic     // few colors and hard edges, lossless compression
+};
+
+/**
+ * Classifies the picture from the color count and the statistics of the edges between
+ * neighbouring pixels. At most 256x256 pixels are sampled, so the cost doesn't depend on
+ * the picture size. Pictures in YUV are classified as natural.
+ */
+extern WebpPictureContent webpClassifyPictureContent(const WebPPicture * __nonnull picture);
+
+/**
+ * Encodes the picture in both lossy and lossless modes concurrently and keeps the smaller result.
+ * The lossy result is accepted if its PSNR reaches `minPSNR`. Once one of the encodes is accepted,
+ * the other one is cancelled through the libwebp progress hook if it takes several times longer.
+ *
+ * @param picture The picture in ARGB. The lossless encode works on a copy.
+ * @param output Receives the encoded data.
+ */
+extern BOOL webpEncodePictureWithModeTrials(WebPPicture * __nonnull picture,
+                                            const WebPConfig * __nonnull config,
+                                            float minPSNR,
+                                            WebPMemoryWriter * __nonnull output);
+
+#endif /* WebpModeSelection_h */
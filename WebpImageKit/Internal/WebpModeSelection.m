@@ -0,0 +1,177 @@
+//
+//  WebpModeSelection.m
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#import <stdatomic.h>
+#import <time.h>
+
+#import "WebpModeSelection.h"
+
+#define WEBP_MS_SAMPLE_AREA (256 * 256)
+#define WEBP_MS_COLOR_TABLE_SIZE 4096       // power of two, four times the color limit
+#define WEBP_MS_COLOR_LIMIT 1024
+#define WEBP_MS_PALETTE_SIZE 256            // lossless encodes such pictures with a color palette
+#define WEBP_MS_SHARP_EDGE 48
+#define WEBP_MS_TRIAL_GRACE 3               // the slower trial may take this many times longer than the accepted one
+
+static inline uint32_t webpLuma(const uint32_t argb) {
+    return (((argb >> 16) & 0xff) * 2 + ((argb >> 8) & 0xff) * 5 + (argb & 0xff)) >> 3;
+}
+
+// Counts distinct colors up to the limit, returns NO once the limit is reached.
+static BOOL webpAddColor(uint32_t *colors, uint8_t *isUsed, size_t *count, const uint32_t color) {
+    size_t idx = (color * 0x9e3779b1u) >> (32 - 12);
+    while (isUsed[idx]) {
+        if (colors[idx] == color) {
+            return YES;
+        }
+        idx = (idx + 1) & (WEBP_MS_COLOR_TABLE_SIZE - 1);
+    }
+    isUsed[idx] = 1;
+    colors[idx] = color;
+    return ++(*count) < WEBP_MS_COLOR_LIMIT;
+}
+
+WebpPictureContent webpClassifyPictureContent(const WebPPicture * __nonnull picture) {
+    if (!picture->use_argb || !picture->argb || 2 > picture->width || 0 >= picture->height) {
+        return WebpPictureContentNatural;
+    }
+    const size_t width = (size_t) picture->width;
+    const size_t height = (size_t) picture->height;
+    const size_t step = MAX((size_t) ceil(sqrt((double) width * height / WEBP_MS_SAMPLE_AREA)), 1);
+    uint32_t colors[WEBP_MS_COLOR_TABLE_SIZE];
+    uint8_t isUsed[WEBP_MS_COLOR_TABLE_SIZE] = {0};
+    size_t colorCount = 0;
+    BOOL isCounting = YES;
+    size_t flatCount = 0, smoothCount = 0, sampleCount = 0;
+    for (size_t y = 0; y < height; y += step) {
+        const uint32_t *row = picture->argb + y * (size_t) picture->argb_stride;
+        for (size_t x = 0; x + 1 < width; x += step) {
+            if (isCounting) {
+                isCounting = webpAddColor(colors, isUsed, &colorCount, row[x]);
+            }
+            // Edges are measured between adjacent pixels of the picture, not of the samples.
+            const uint32_t luma = webpLuma(row[x]);
+            const uint32_t nextLuma = webpLuma(row[x + 1]);
+            const uint32_t delta = luma > nextLuma ? luma - nextLuma : nextLuma - luma;
+            if (row[x] == row[x + 1]) {
+                flatCount++;
+            }
+            else if (delta < WEBP_MS_SHARP_EDGE) {
+                smoothCount++;
+            }
+            sampleCount++;
+        }
+    }
+    if (0 == sampleCount) {
+        return WebpPictureContentNatural;
+    }
+    const double flatRatio = (double) flatCount / sampleCount;
+    const double smoothRatio = (double) smoothCount / sampleCount;
+    // Palette images and images made of flat areas with hard edges compress better losslessly,
+    // photos have many colors and mostly soft transitions.
+    if (colorCount <= WEBP_MS_PALETTE_SIZE || smoothRatio < 0.05) {
+        return WebpPictureContentSynthetic;
+    }
+    if (!isCounting && smoothRatio > 0.35 && flatRatio < 0.3) {
+        return WebpPictureContentNatural;
+    }
+    return WebpPictureContentMixed;
+}
+
+typedef struct {
+    _Atomic(uint64_t) deadline;     // the trials are cancelled after this time
+} WebpModeTrials;
+
+static inline uint64_t webpNow(void) {
+    return clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+}
+
+static int webpModeTrialProgress(int percent, const WebPPicture *picture) {
+    const WebpModeTrials *trials = picture->user_data;
+    return webpNow() < atomic_load(&trials->deadline);
+}
+
+static void webpModeTrialAccept(WebpModeTrials *trials, const uint64_t start) {
+    const uint64_t now = webpNow();
+    const uint64_t deadline = start + (now - start) * WEBP_MS_TRIAL_GRACE;
+    uint64_t current = atomic_load(&trials->deadline);
+    while (deadline < current && !atomic_compare_exchange_weak(&trials->deadline, &current, deadline)) {
+    }
+}
+
+static BOOL webpModeTrialEncode(WebPPicture *picture, const WebPConfig *config, WebPMemoryWriter *writer) {
+    picture->writer = WebPMemoryWrite;
+    picture->custom_ptr = writer;
+    picture->progress_hook = webpModeTrialProgress;
+    const BOOL result = 0 != WebPEncode(config, picture);
+    picture->progress_hook = NULL;
+    return result;
+}
+
+BOOL webpEncodePictureWithModeTrials(WebPPicture * __nonnull picture,
+                                     const WebPConfig * __nonnull config,
+                                     float minPSNR,
+                                     WebPMemoryWriter * __nonnull output) {
+    // The lossy encode converts the picture to YUV in place, the lossless one needs its own ARGB copy.
+    WebPPicture losslessPicture;
+    if (!WebPPictureInit(&losslessPicture) || !WebPPictureCopy(picture, &losslessPicture)) {
+        return NO;
+    }
+    WebpModeTrials trials = { .deadline = UINT64_MAX };
+    WebPConfig lossyConfig = *config;
+    lossyConfig.lossless = 0;
+    WebPConfig losslessConfig = *config;
+    losslessConfig.lossless = 1;
+    WebPMemoryWriter lossy, lossless;
+    WebPMemoryWriterInit(&lossy);
+    WebPMemoryWriterInit(&lossless);
+    losslessPicture.user_data = &trials;
+    losslessPicture.stats = NULL;
+    const uint64_t start = webpNow();
+
+    // The worker gets pointers to the stack, it is finished before the function returns.
+    WebpModeTrials *trialsRef = &trials;
+    WebPPicture *losslessPictureRef = &losslessPicture;
+    WebPMemoryWriter *losslessRef = &lossless;
+    __block BOOL isLosslessEncoded = NO;
+    __auto_type group = dispatch_group_create();
+    dispatch_group_async(group, dispatch_get_global_queue(qos_class_self(), 0), ^{
+        if ((isLosslessEncoded = webpModeTrialEncode(losslessPictureRef, &losslessConfig, losslessRef))) {
+            webpModeTrialAccept(trialsRef, start);
+        }
+    });
+    WebPAuxStats stats;
+    void *userData = picture->user_data;
+    WebPAuxStats *pictureStats = picture->stats;
+    picture->user_data = &trials;
+    picture->stats = &stats;
+    const BOOL isLossyEncoded = webpModeTrialEncode(picture, &lossyConfig, &lossy);
+    const BOOL isLossyAccepted = isLossyEncoded && stats.PSNR[3] >= minPSNR;
+    if (isLossyAccepted) {
+        webpModeTrialAccept(&trials, start);
+    }
+    picture->user_data = userData;
+    picture->stats = pictureStats;
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    WebPPictureFree(&losslessPicture);
+
+    // Lossless is always accepted, the lossy result is used without it even if it misses the quality.
+    const BOOL isLosslessUsed = isLosslessEncoded && (!isLossyAccepted || lossless.size < lossy.size);
+    if (isLosslessUsed) {
+        WebPMemoryWriterClear(&lossy);
+        *output = lossless;
+        return YES;
+    }
+    WebPMemoryWriterClear(&lossless);
+    if (!isLossyEncoded) {
+        WebPMemoryWriterClear(&lossy);
+        return NO;
+    }
+    *output = lossy;
+    return YES;
+}
@@ -0,0 +1,118 @@
+//
+//  WebpPixelConverter.c
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#include <string.h>
+
+#include "WebpPixelConverter.h"
+
+static inline uint32_t webpPackArgb(uint32_t a, uint32_t r, uint32_t g, uint32_t b) {
+    return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+// Rounded value * 255 / alpha, `scale` is (255 << 16) / alpha.
+static inline uint32_t webpUnmultiply(uint32_t value, uint32_t scale) {
+    const uint32_t result = (value * scale + (1u << 15)) >> 16;
+    return result > 255 ? 255 : result;
+}
+
+static void webpConvertOpaqueRow(const uint8_t *src, const WebpPixelLayout *layout, uint32_t *dst, size_t width) {
+    const size_t step = layout->bytesPerPixel;
+    for (size_t x = 0; x < width; ++x, src += step) {
+        dst[x] = webpPackArgb(0xff, src[layout->red], src[layout->green], src[layout->blue]);
+    }
+}
+
+static void webpConvertStraightRow(const uint8_t *src, const WebpPixelLayout *layout, uint32_t *dst, size_t width) {
+    for (size_t x = 0; x < width; ++x, src += 4) {
+        dst[x] = webpPackArgb(src[layout->alpha], src[layout->red], src[layout->green], src[layout->blue]);
+    }
+}
+
+static void webpConvertPremultipliedRow(const uint8_t *src, const WebpPixelLayout *layout, uint32_t *dst, size_t width) {
+    for (size_t x = 0; x < width; ++x, src += 4) {
+        const uint32_t a = src[layout->alpha];
+        if (0xff == a) {
+            dst[x] = webpPackArgb(a, src[layout->red], src[layout->green], src[layout->blue]);
+        }
+        else if (0 == a) {
+            dst[x] = 0;
+        }
+        else {
+            const uint32_t scale = (255u << 16) / a;
+            dst[x] = webpPackArgb(a,
+                                  webpUnmultiply(src[layout->red], scale),
+                                  webpUnmultiply(src[layout->green], scale),
+                                  webpUnmultiply(src[layout->blue], scale));
+        }
+    }
+}
+
+void webpConvertPixelsToArgb(const uint8_t *src, size_t srcStride, const WebpPixelLayout *layout,
+                             uint32_t *dst, size_t dstStride,
+                             size_t width, size_t height) {
+    if (!src || !dst || !layout) {
+        return;
+    }
+    void (*convertRow)(const uint8_t *, const WebpPixelLayout *, uint32_t *, size_t);
+    if (0 > layout->alpha) {
+        convertRow = webpConvertOpaqueRow;
+    }
+    else if (layout->isPremultiplied) {
+        convertRow = webpConvertPremultipliedRow;
+    }
+    else {
+        convertRow = webpConvertStraightRow;
+    }
+    for (size_t y = 0; y < height; ++y, src += srcStride, dst += dstStride) {
+        convertRow(src, layout, dst, width);
+    }
+}
+
+void webpYuvRangeTable(uint8_t table[256], int isChroma, int toFullRange) {
+    // Luma spans 219 codes above 16, chroma spans 224 codes around 128.
+    const int span = isChroma ? 224 : 219;
+    const int origin = isChroma ? 128 : 16;
+    for (int value = 0; value < 256; ++value) {
+        int result;
+        if (toFullRange) {
+            const int centered = value - origin;
+            result = (isChroma ? 128 : 0) + (centered * 255 + (centered < 0 ? -span / 2 : span / 2)) / span;
+        }
+        else {
+            const int centered = value - (isChroma ? 128 : 0);
+            result = origin + (centered * span + (centered < 0 ? -127 : 127)) / 255;
+        }
+        table[value] = (uint8_t) (result < 0 ? 0 : (result > 255 ? 255 : result));
+    }
+}
+
+void webpCopyPlane(const uint8_t *src, size_t srcStride, size_t srcStep,
+                   uint8_t *dst, size_t dstStride, size_t dstStep,
+                   size_t width, size_t height, const uint8_t *table) {
+    if (!src || !dst) {
+        return;
+    }
+    for (size_t y = 0; y < height; ++y, src += srcStride, dst += dstStride) {
+        if (1 == srcStep && 1 == dstStep && !table) {
+            memcpy(dst, src, width);
+            continue;
+        }
+        const uint8_t *srcPixel = src;
+        uint8_t *dstPixel = dst;
+        if (table) {
+            for (size_t x = 0; x < width; ++x, srcPixel += srcStep, dstPixel += dstStep) {
+                *dstPixel = table[*srcPixel];
+            }
+        }
+        else {
+            for (size_t x = 0; x < width; ++x, srcPixel += srcStep, dstPixel += dstStep) {
+                *dstPixel = *srcPixel;
+            }
+        }
+    }
+}
@@ -0,0 +1,59 @@
+//
+//  WebpPixelConverter.h
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#ifndef WebpPixelConverter_h
+#define WebpPixelConverter_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * Byte layout of an 8-bit per component RGB(A) pixel.
+ */
+typedef struct {
+    size_t bytesPerPixel;   // 3 or 4
+    int red;                // byte offsets of the components within the pixel
+    int green;
+    int blue;
+    int alpha;              // -1 for opaque pixels and for the skipped byte
+    int isPremultiplied;
+} WebpPixelLayout;
+
+/**
+ * Converts pixels of any supported layout into 0xAARRGGBB words of WebPPicture::argb
+ * in one pass, premultiplied pixels are converted to straight alpha.
+ *
+ * @param dstStride Destination stride in pixels (WebPPicture::argb_stride).
+ */
+void webpConvertPixelsToArgb(const uint8_t *src, size_t srcStride, const WebpPixelLayout *layout,
+                             uint32_t *dst, size_t dstStride,
+                             size_t width, size_t height);
+
+/**
+ * Fills the table which maps 8-bit luma or chroma samples between the video range used by WebP
+ * (16-235 for luma, 16-240 for chroma) and the full 0-255 range.
+ */
+void webpYuvRangeTable(uint8_t table[256], int isChroma, int toFullRange);
+
+/**
+ * Copies one 8-bit plane. Samples are `srcStep` and `dstStep` bytes apart, so interleaved chroma
+ * planes can be split or merged, and are mapped through the `table` when it isn't NULL.
+ */
+void webpCopyPlane(const uint8_t *src, size_t srcStride, size_t srcStep,
+                   uint8_t *dst, size_t dstStride, size_t dstStep,
+                   size_t width, size_t height, const uint8_t *table);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* WebpPixelConverter_h */
@@ -0,0 +1,32 @@
+//
+//  WebpRateControl.h
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#ifndef WebpRateControl_h
+#define WebpRateControl_h
+
+#import <Foundation/Foundation.h>
+#import <libwebp/encode.h>
+#import "WIKEncoderConfig.h"
+
+/**
+ * Encodes the picture with lossy compression to fit `config->target_size` bytes. The quality is
+ * predicted from a downscaled trial encode and the size model of the content hint, then refined
+ * with at most two full encodes. The result is accepted once it is not larger than the target
+ * and not smaller than `target * (1 - tolerance)`. If both passes miss, libwebp's own size search
+ * finishes the job. Measured sizes update the model shared by all encodes with the same hint.
+ *
+ * @param picture The picture in ARGB or YUV, converted to YUV in place.
+ * @param output Receives the encoded data.
+ */
+extern BOOL webpEncodePictureToTargetSize(WebPPicture * __nonnull picture,
+                                          const WebPConfig * __nonnull config,
+                                          WIKContentHint contentHint,
+                                          float tolerance,
+                                          WebPMemoryWriter * __nonnull output);
+
+#endif /* WebpRateControl_h */
@@ -0,0 +1,184 @@
+//
+//  WebpRateControl.m
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#import <os/lock.h>
+
+#import "WebpRateControl.h"
+
+#define WEBP_RC_HINT_COUNT 4
+#define WEBP_RC_TRIAL_MIN_AREA (192 * 192)   // smaller pictures are predicted from the model alone
+#define WEBP_RC_TRIAL_AREA_RATIO 16          // the trial picture has 1/16 of the pixels
+#define WEBP_RC_LEARNING_RATE 0.3
+
+// The encoded size is modelled as ln(bytes per pixel) = intercept + slope * quality. A downscaled
+// trial encode has more detail per pixel, `trialOffset` is the log ratio of full to trial size.
+typedef struct {
+    double slope;
+    double intercept;
+    double trialOffset;
+} WebpRateModel;
+
+static os_unfair_lock webpRateModelLock = OS_UNFAIR_LOCK_INIT;
+static WebpRateModel webpRateModels[WEBP_RC_HINT_COUNT] = {
+        { .slope = 0.03, .intercept = -4.2, .trialOffset = -0.7 },  // default
+        { .slope = 0.03, .intercept = -4.4, .trialOffset = -0.6 },  // picture
+        { .slope = 0.03, .intercept = -4.0, .trialOffset = -0.8 },  // photo
+        { .slope = 0.02, .intercept = -4.8, .trialOffset = -0.5 },  // graph
+};
+
+static WebpRateModel webpRateModelForHint(WIKContentHint hint) {
+    const NSInteger idx = 0 <= hint && hint < WEBP_RC_HINT_COUNT ? hint : 0;
+    os_unfair_lock_lock(&webpRateModelLock);
+    const WebpRateModel model = webpRateModels[idx];
+    os_unfair_lock_unlock(&webpRateModelLock);
+    return model;
+}
+
+static void webpRateModelUpdate(WIKContentHint hint, void (^update)(WebpRateModel *model)) {
+    const NSInteger idx = 0 <= hint && hint < WEBP_RC_HINT_COUNT ? hint : 0;
+    os_unfair_lock_lock(&webpRateModelLock);
+    update(&webpRateModels[idx]);
+    os_unfair_lock_unlock(&webpRateModelLock);
+}
+
+NS_INLINE double webpRateBlend(double value, double sample) {
+    return value + WEBP_RC_LEARNING_RATE * (sample - value);
+}
+
+NS_INLINE float webpRateClampQuality(double quality) {
+    return (float) MAX(MIN(quality, 100.0), 0.0);
+}
+
+NS_INLINE double webpRateLogBpp(size_t bytes, double area) {
+    return log(MAX((double) bytes, 1.0) / area);
+}
+
+// Single pass encode at the given quality.
+static BOOL webpRateEncode(WebPPicture *picture, const WebPConfig *baseConfig, float quality, WebPMemoryWriter *writer) {
+    WebPConfig config = *baseConfig;
+    config.quality = quality;
+    config.target_size = 0;
+    config.target_PSNR = 0;
+    config.pass = 1;
+    picture->writer = WebPMemoryWrite;
+    picture->custom_ptr = writer;
+    return 0 != WebPEncode(&config, picture);
+}
+
+// Encodes a downscaled copy of the picture, returns ln(bytes per pixel) or NAN.
+static double webpRateTrialLogBpp(const WebPPicture *picture, const WebPConfig *config, float quality) {
+    const double area = (double) picture->width * picture->height;
+    const double scale = sqrt(MAX(area / WEBP_RC_TRIAL_AREA_RATIO, WEBP_RC_TRIAL_MIN_AREA) / area);
+    const int width = MAX((int) round(picture->width * scale), 1);
+    const int height = MAX((int) round(picture->height * scale), 1);
+    WebPPicture trial;
+    // Rescaling a view allocates the trial picture and leaves the source untouched.
+    if (!WebPPictureView(picture, 0, 0, picture->width, picture->height, &trial)) {
+        return NAN;
+    }
+    if (!WebPPictureRescale(&trial, width, height)) {
+        WebPPictureFree(&trial);
+        return NAN;
+    }
+    WebPMemoryWriter writer;
+    WebPMemoryWriterInit(&writer);
+    const BOOL isEncoded = webpRateEncode(&trial, config, quality, &writer);
+    const double result = isEncoded ? webpRateLogBpp(writer.size, (double) width * height) : NAN;
+    WebPMemoryWriterClear(&writer);
+    WebPPictureFree(&trial);
+    return result;
+}
+
+BOOL webpEncodePictureToTargetSize(WebPPicture * __nonnull picture,
+                                   const WebPConfig * __nonnull config,
+                                   WIKContentHint contentHint,
+                                   float tolerance,
+                                   WebPMemoryWriter * __nonnull output) {
+    const size_t targetSize = (size_t) MAX(config->target_size, 0);
+    const double area = (double) picture->width * picture->height;
+    if (0 == targetSize || 0 >= area) {
+        return NO;
+    }
+    tolerance = MAX(MIN(tolerance, 0.9f), 0.01f);
+    const size_t minSize = (size_t) floor(targetSize * (1.0 - tolerance));
+    // Aim at the middle of the accepted range, so model errors in either direction are tolerated.
+    const double targetLogBpp = webpRateLogBpp((size_t) round(targetSize * (1.0 - tolerance / 2)), area);
+    const WebpRateModel model = webpRateModelForHint(contentHint);
+
+    const float trialQuality = config->quality;
+    const BOOL hasTrial = area >= WEBP_RC_TRIAL_MIN_AREA * 2;
+    const double trialLogBpp = hasTrial ? webpRateTrialLogBpp(picture, config, trialQuality) : NAN;
+    float quality;
+    if (!isnan(trialLogBpp)) {
+        const double predictedLogBpp = trialLogBpp + model.trialOffset;
+        quality = webpRateClampQuality(trialQuality + (targetLogBpp - predictedLogBpp) / model.slope);
+    }
+    else {
+        quality = webpRateClampQuality((targetLogBpp - model.intercept) / model.slope);
+    }
+
+    // First full pass at the predicted quality.
+    WebPMemoryWriter first;
+    WebPMemoryWriterInit(&first);
+    if (!webpRateEncode(picture, config, quality, &first)) {
+        WebPMemoryWriterClear(&first);
+        return NO;
+    }
+    const double firstLogBpp = webpRateLogBpp(first.size, area);
+    webpRateModelUpdate(contentHint, ^(WebpRateModel *shared) {
+        shared->intercept = webpRateBlend(shared->intercept, firstLogBpp - shared->slope * quality);
+        if (!isnan(trialLogBpp)) {
+            const double offset = firstLogBpp - shared->slope * (quality - trialQuality) - trialLogBpp;
+            shared->trialOffset = webpRateBlend(shared->trialOffset, offset);
+        }
+    });
+    if (first.size <= targetSize && (first.size >= minSize || 100.0f <= quality)) {
+        *output = first;
+        return YES;
+    }
+
+    // Second pass corrects the quality from the measured size.
+    const float secondQuality = webpRateClampQuality(quality + (targetLogBpp - firstLogBpp) / model.slope);
+    WebPMemoryWriter second;
+    WebPMemoryWriterInit(&second);
+    BOOL isSecondEncoded = NO;
+    if (secondQuality != quality) {
+        isSecondEncoded = webpRateEncode(picture, config, secondQuality, &second);
+    }
+    if (isSecondEncoded && 2.0f <= fabsf(secondQuality - quality)) {
+        const double secondLogBpp = webpRateLogBpp(second.size, area);
+        const double slope = (secondLogBpp - firstLogBpp) / (secondQuality - quality);
+        webpRateModelUpdate(contentHint, ^(WebpRateModel *shared) {
+            shared->slope = webpRateBlend(shared->slope, MAX(MIN(slope, 0.15), 0.005));
+        });
+    }
+    if (isSecondEncoded && second.size <= targetSize) {
+        WebPMemoryWriterClear(&first);
+        *output = second;
+        return YES;
+    }
+    WebPMemoryWriterClear(&second);
+    if (first.size <= targetSize) {
+        *output = first;
+        return YES;
+    }
+    WebPMemoryWriterClear(&first);
+
+    // Both passes are too large, libwebp's size search starts from the best estimate.
+    WebPConfig searchConfig = *config;
+    searchConfig.quality = MIN(quality, secondQuality);
+    searchConfig.pass = MAX(searchConfig.pass, 3);
+    WebPMemoryWriterInit(output);
+    picture->writer = WebPMemoryWrite;
+    picture->custom_ptr = output;
+    if (!WebPEncode(&searchConfig, picture)) {
+        WebPMemoryWriterClear(output);
+        return NO;
+    }
+    return YES;
+}
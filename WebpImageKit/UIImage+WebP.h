@@ -85,6 +85,54 @@ NS_ASSUME_NONNULL_BEGIN
                                scaleFactor:(const CGFloat)scaleFactor
                                  loopCount:(NSUInteger * __nullable)loopCount;
 
+/**
+ * Creates a new UIImage instance with the region of the image in WebP format. Only the region
+ * is decoded, which keeps memory and latency low for viewports of very large images. The
+ * region is scaled to fit the given size and scale factor.
+ * @warning Animated images aren't supported, the region is taken from the first frame.
+ *
+ * @param data
+ *        Image data in WebP format.
+ * @param rect
+ *        The region in pixels, with the origin in the top left corner of the image.
+ * @param size
+ *        Size of the result image in points, CGSizeZero keeps the region size.
+ * @param scaleFactor
+ *        The scale factor of the output image.
+ * @return New image or nil if decoding failed or the region is outside of the image.
+ */
++ (nullable instancetype)webpImageWithData:(NSData * const)data
+                                      rect:(const CGRect)rect
+                               displaySize:(const CGSize)size
+                               scaleFactor:(const CGFloat)scaleFactor;
+
+/**
+ * Creates a new UIImage instance from the file in WebP format. The file is memory-mapped,
+ * so the compressed data isn't copied to memory.
+ *
+ * @param path
+ *        Path to the image file in WebP format.
+ * @return New image or nil if decoding failed or format version unsupported.
+ */
++ (nullable instancetype)webpImageWithContentsOfFile:(NSString * const)path;
+
+/**
+ * Creates a new UIImage instance from the file in WebP format. The resulting image will
+ * have a given size and scale factor.
+ * @warning This method expects the size of the resulting image in points.
+ *
+ * @param path
+ *        Path to the image file in WebP format.
+ * @param size
+ *        Size of the result image in points.
+ * @param scaleFactor
+ *        The scale factor of the output image.
+ * @return New image or nil if decoding failed or format version unsupported.
+ */
++ (nullable instancetype)webpImageWithContentsOfFile:(NSString * const)path
+                                         displaySize:(const CGSize)size
+                                         scaleFactor:(const CGFloat)scaleFactor;
+
 @end
 
 @class WIKEncoderConfig, WIKAnimationFrame;
@@ -100,6 +148,30 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (nullable NSData *)webpDataWithConfig:(WIKEncoderConfig * const)config;
 
+/**
+ * Encodes the image into several renditions, one for each encoder configuration. The image is
+ * imported once and each smaller rendition is downscaled from the previous larger one, the
+ * renditions are encoded in parallel. Usually each configuration sets its own `maxPixelSize`.
+ * Animated images are encoded separately for each configuration.
+ *
+ * @param configs
+ *        Encoder settings of the renditions.
+ * @return Encoded renditions in the order of `configs`, or nil if any rendition failed to encode.
+ */
+- (nullable NSArray<NSData *> *)webpDataWithConfigs:(NSArray<WIKEncoderConfig *> * const)configs;
+
+/**
+ * Encodes the image using the given encoder settings and writes it to the file.
+ * Static images are streamed from the encoder to the file without an in-memory copy.
+ *
+ * @param path
+ *        Destination file path, an existing file is replaced atomically.
+ * @param config
+ *        Encoder settings.
+ * @return YES if the file is written.
+ */
+- (BOOL)webpWriteToFile:(NSString * const)path config:(WIKEncoderConfig * const)config;
+
 /**
  * Encodes frames as an animated Webp image using the given encoder settings.
  *
@@ -112,6 +184,8 @@ NS_ASSUME_NONNULL_BEGIN
 
 /**
  * Encodes frames as an animated Webp image using the given encoder settings and loop count.
+ * With `WIKAnimationModeInterFrame` animation mode only the changed parts of frames are
+ * encoded and identical consecutive frames are merged.
  *
  * @param config
  *        Encoder settings.
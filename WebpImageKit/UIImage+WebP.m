@@ -7,18 +7,34 @@
 //
 
 #import <objc/runtime.h>
+#import <stdatomic.h>
 #import <libwebp/mux.h>
 
 #import "UIImage+WebP.h"
+#import "CGImage+WebP.h"
 #import "NSData+WebP.h"
 #import "CoreGraphics+WebP.h"
 #import "WIKAnimationFrame.h"
+#import "WIKAnimationDecoder.h"
+#import "WIKIncrementalDecoder.h"
+#import "UIImage+WebP+Internal.h"
+#import "WIKEncoderConfig+Internal.h"
+#import "WebpMetrics.h"
 #import "WebpImageKitMacro.h"
 
 static NSUInteger gcdOf(size_t const count, NSUInteger const * const values);
+static CGImageRef __nullable webpCopyImageIncrementally(NSData * const data,
+                                                       const CGSize outputSize,
+                                                       BOOL (^ const isCancelled)(void)) CF_RETURNS_RETAINED;
 
 static void *kLoopCountKey = &kLoopCountKey;
 
+// Images downscaled by the memory governor keep their size in points.
+NS_INLINE CGFloat webpImageScale(const CGFloat scaleFactor, const CGFloat width, const CGFloat requestedWidth) {
+    const __auto_type scale = MAX(scaleFactor, 1.0);
+    return 0 < width && width < requestedWidth ? scale * width / requestedWidth : scale;
+}
+
 @implementation UIImage (WebpDecoder)
 
 + (BOOL)isWebpImageData:(NSData * const)data {
@@ -44,94 +60,65 @@ static void *kLoopCountKey = &kLoopCountKey;
                                displaySize:(const CGSize)size
                                scaleFactor:(const CGFloat)scaleFactor
                                  loopCount:(NSUInteger * __nullable)loopCount {
+    return [self webpImageWithData:data displaySize:size scaleFactor:scaleFactor loopCount:loopCount isCancelled:nil];
+}
+
++ (nullable instancetype)webpImageWithData:(NSData *const)data
+                               displaySize:(const CGSize)size
+                               scaleFactor:(const CGFloat)scaleFactor
+                                 loopCount:(NSUInteger * __nullable)loopCount
+                               isCancelled:(BOOL (^ __nullable)(void))isCancelled {
     if (!data.webpIsImage) {
         return nil;
     }
-    WebPData webpData;
-    WebPDataInit(&webpData);
-    webpData.bytes = data.bytes;
-    webpData.size = data.length;
-    WebPDemuxer *demuxer;
-    if (!(demuxer = WebPDemux(&webpData))) {
-        return nil;
-    }
-    const uint32_t flags = WebPDemuxGetI(demuxer, WEBP_FF_FORMAT_FLAGS);
-    const __auto_type scale = MAX(scaleFactor, 1.0);
-
-    WebPIterator iterator;
-    if (!WebPDemuxGetFrame(demuxer, 1, &iterator)) {
-        WebPDemuxReleaseIterator(&iterator);
-        WebPDemuxDelete(demuxer);
+    webpMetricsOperationBegin(WebpMetricsOperationDecode);
+    @webp_defer {
+        webpMetricsOperationEnd();
+    };
+    WIKAnimationDecoder *decoder;
+    if (!(decoder = [[WIKAnimationDecoder alloc] initWithData:data targetSize:CGSizeZero])) {
         return nil;
     }
-    __auto_type colorSpace = webpCreateColorSpace(demuxer);
-    __auto_type canvasWidth = (size_t) WebPDemuxGetI(demuxer, WEBP_FF_CANVAS_WIDTH);
-    __auto_type canvasHeight = (size_t) WebPDemuxGetI(demuxer, WEBP_FF_CANVAS_HEIGHT);
-    const __auto_type originalSize = CGSizeMake(canvasWidth, canvasHeight);
-    const __auto_type scaledSize = scaledImageSize(originalSize, size, scaleFactor);
-    const __auto_type isScaledOutput = !CGSizeEqualToSize(originalSize, scaledSize);
-    if (!(flags & ANIMATION_FLAG)) {
-        __auto_type cgImage = webpCreateCGImage(iterator.fragment,
-                                                colorSpace,
-                                                isScaledOutput ? scaledSize : CGSizeZero);
+    decoder.outputSize = scaledImageSize(decoder.canvasSize, size, scaleFactor);
+    const __auto_type requestedWidth = decoder.outputSize.width;
+    if (!decoder.isAnimated) {
+        __auto_type cgImage = isCancelled
+                ? webpCopyImageIncrementally(data, decoder.outputSize, isCancelled)
+                : [decoder copyFrameAtIndex:0];
+        if (!cgImage) {
+            return nil;
+        }
+        const __auto_type scale = webpImageScale(scaleFactor, CGImageGetWidth(cgImage), requestedWidth);
         __auto_type resultImg = [[UIImage alloc] initWithCGImage:cgImage scale:scale orientation:UIImageOrientationUp];
         CGImageRelease(cgImage);
-        CFRelease(colorSpace);
-        WebPDemuxReleaseIterator(&iterator);
-        WebPDemuxDelete(demuxer);
         if (loopCount) { *loopCount = NSNotFound; }
         return resultImg;
     }
-    CGBitmapInfo bitmapInfo = kCGBitmapByteOrder32Host;
-    bitmapInfo |= (flags & ALPHA_FLAG) ? kCGImageAlphaPremultipliedFirst : kCGImageAlphaNoneSkipFirst;
-    __auto_type deviceColorSpace = webpCreateDeviceRgbColorSpace();
-    CGContextRef canvas = CGBitmapContextCreate(NULL, canvasWidth, canvasHeight, 8, 0, deviceColorSpace, bitmapInfo);
-    CFRelease(deviceColorSpace);
-    if (!canvas) {
-        WebPDemuxDelete(demuxer);
-        CGColorSpaceRelease(colorSpace);
-        return nil;
-    }
-
-    const __auto_type loopCountValue = WebPDemuxGetI(demuxer, WEBP_FF_LOOP_COUNT);
+    const __auto_type loopCountValue = decoder.loopCount;
     if (loopCount) {
-        *loopCount = MAX(loopCountValue, 0);
+        *loopCount = loopCountValue;
     }
-    NSMutableArray<WIKAnimationFrame *> *frames = [NSMutableArray new];
-    do {
-        @autoreleasepool {
-            __auto_type cgOriginal = webpCreateCGImage(iterator.fragment, colorSpace, CGSizeZero);
-            if (!cgOriginal) {
-                continue;
-            }
-            __auto_type imgRect = (CGRect){CGPointZero, CGSizeMake(iterator.width, iterator.height)};
-            imgRect.origin.x = iterator.x_offset;
-            imgRect.origin.y = canvasHeight - CGRectGetHeight(imgRect) - iterator.y_offset;
-            if (WEBP_MUX_BLEND != iterator.blend_method) {
-                CGContextClearRect(canvas, imgRect);
-            }
-            CGContextDrawImage(canvas, imgRect, cgOriginal);
-            CGImageRef cgImg = CGBitmapContextCreateImage(canvas);
-            CGImageRelease(cgOriginal);
-
-            if (isScaledOutput) {
-                __auto_type scaledImg = webpCreateScaledCGImage(cgImg, scaledSize);
-                CGImageRelease(cgImg);
-                cgImg = scaledImg;
-            }
-            __auto_type frameImg = [[UIImage alloc] initWithCGImage:cgImg scale:scale orientation:UIImageOrientationUp];
-            CGImageRelease(cgImg);
-            WIKAnimationFrame *frame;
-            if ((frame = [[WIKAnimationFrame alloc] initWithImage:frameImg duration:iterator.duration / 1000.0])) {
-                [frames addObject:frame];
-            }
+    if (![decoder reserveMemoryForFrameCount:decoder.frameCount]) {
+        return nil;
+    }
+    const __auto_type scale = webpImageScale(scaleFactor, decoder.outputSize.width, requestedWidth);
+    NSMutableArray<WIKAnimationFrame *> *frames = [NSMutableArray arrayWithCapacity:decoder.frameCount];
+    __block BOOL isStopped = NO;
+    [decoder enumerateFramesUsingBlock:^(CGImageRef cgImg, NSUInteger frameIdx, BOOL *stop) {
+        if (isCancelled && isCancelled()) {
+            isStopped = *stop = YES;
+            return;
         }
-    } while(WebPDemuxNextFrame(&iterator));
-
-    WebPDemuxReleaseIterator(&iterator);
-    WebPDemuxDelete(demuxer);
-    CGContextRelease(canvas);
-    CGColorSpaceRelease(colorSpace);
+        __auto_type frameImg = [[UIImage alloc] initWithCGImage:cgImg scale:scale orientation:UIImageOrientationUp];
+        WIKAnimationFrame *frame;
+        if ((frame = [[WIKAnimationFrame alloc] initWithImage:frameImg duration:[decoder durationAtIndex:frameIdx]])) {
+            [frames addObject:frame];
+        }
+    }];
+    if (isStopped) {
+        return nil;
+    }
+    decoder = nil;
 
     NSTimeInterval fullDuration = 0.0;
     NSUInteger *durations = calloc(frames.count, sizeof(NSUInteger));
@@ -157,10 +144,49 @@ static void *kLoopCountKey = &kLoopCountKey;
         } while (--repeatCount > 0);
     }
     __auto_type animatedImage = [UIImage animatedImageWithImages:images duration:fullDuration];
-    animatedImage.webpLoopCount = MAX(loopCountValue, 0);
+    animatedImage.webpLoopCount = loopCountValue;
     return animatedImage;
 }
 
++ (nullable instancetype)webpImageWithData:(NSData * const)data
+                                      rect:(const CGRect)rect
+                               displaySize:(const CGSize)size
+                               scaleFactor:(const CGFloat)scaleFactor {
+    if (!data.webpIsImage || CGRectIsNull(rect) || CGRectIsEmpty(rect)) {
+        return nil;
+    }
+    const __auto_type targetSize = scaledImageSize(CGRectIntegral(rect).size, size, scaleFactor);
+    CGImageRef cgImage;
+    if (!(cgImage = WebpImageCreateFromDataWithRect((__bridge CFDataRef)data,
+                                                    rect,
+                                                    (UInt32) MAX(targetSize.width, targetSize.height)))) {
+        return nil;
+    }
+    const __auto_type scale = webpImageScale(scaleFactor, CGImageGetWidth(cgImage), targetSize.width);
+    __auto_type resultImg = [[UIImage alloc] initWithCGImage:cgImage scale:scale orientation:UIImageOrientationUp];
+    CGImageRelease(cgImage);
+    return resultImg;
+}
+
++ (nullable instancetype)webpImageWithContentsOfFile:(NSString * const)path {
+    return [self webpImageWithContentsOfFile:path displaySize:CGSizeZero scaleFactor:1.0];
+}
+
++ (nullable instancetype)webpImageWithContentsOfFile:(NSString * const)path
+                                         displaySize:(const CGSize)size
+                                         scaleFactor:(const CGFloat)scaleFactor {
+    NSData *data;
+    if (!path || !(data = [NSData webpDataWithContentsOfMappedFile:path])) {
+        return nil;
+    }
+    return [self webpImageWithData:data displaySize:size scaleFactor:scaleFactor loopCount:nil];
+}
+
+- (BOOL)webpIsDownscaledForScaleFactor:(const CGFloat)scaleFactor {
+    // See webpImageScale, frames of animated images share the scale.
+    return self.scale < MAX(scaleFactor, 1.0);
+}
+
 @end
 
 @implementation UIImage (WebpEncoder)
@@ -203,6 +229,37 @@ static void *kLoopCountKey = &kLoopCountKey;
     return [UIImage webpDataWithAnimationFrames:frames config:config loopCount:self.webpLoopCount];
 }
 
+- (nullable NSArray<NSData *> *)webpDataWithConfigs:(NSArray<WIKEncoderConfig *> * const)configs {
+    if (0 == configs.count) {
+        return nil;
+    }
+    __auto_type frames = [self getFrames];
+    if (0 == frames.count) {
+        return self.CGImage ? webpDataRenditionsFromCGImage(self.CGImage, configs) : nil;
+    }
+    NSMutableArray<NSData *> *renditions = [NSMutableArray arrayWithCapacity:configs.count];
+    for (WIKEncoderConfig *config in configs) {
+        NSData *data = [UIImage webpDataWithAnimationFrames:frames config:config loopCount:self.webpLoopCount];
+        if (!data) {
+            return nil;
+        }
+        [renditions addObject:data];
+    }
+    return [renditions copy];
+}
+
+- (BOOL)webpWriteToFile:(NSString * const)path config:(WIKEncoderConfig * const)config {
+    if (!path || !config) {
+        return NO;
+    }
+    __auto_type frames = [self getFrames];
+    if (0 == frames.count) {
+        return self.CGImage && webpWriteCGImageToFile(self.CGImage, config, path);
+    }
+    NSData *data = [UIImage webpDataWithAnimationFrames:frames config:config loopCount:self.webpLoopCount];
+    return [data writeToFile:path atomically:YES];
+}
+
 + (nullable NSData *)webpDataWithAnimationFrames:(NSArray<WIKAnimationFrame *> * const)frames
                                        andConfig:(WIKEncoderConfig * const)config {
     return [self webpDataWithAnimationFrames:frames config:config loopCount:1];
@@ -211,19 +268,64 @@ static void *kLoopCountKey = &kLoopCountKey;
 + (nullable NSData *)webpDataWithAnimationFrames:(NSArray<WIKAnimationFrame *> * const)frames
                                           config:(WIKEncoderConfig * const)config
                                        loopCount:(const NSUInteger)loopCount {
+    if (WIKAnimationModeInterFrame == config.animationMode) {
+        return [self webpDataWithInterFrameAnimationFrames:frames config:config loopCount:loopCount];
+    }
+    webpMetricsOperationBegin(WebpMetricsOperationEncode);
+    @webp_defer {
+        webpMetricsOperationEnd();
+    };
+    const NSUInteger frameCount = frames.count;
+    CFDataRef *encodedFrames = calloc(MAX(frameCount, 1), sizeof(CFDataRef));
+    if (!encodedFrames) {
+        return nil;
+    }
+    @webp_defer {
+        for (NSUInteger frameIdx = 0; frameIdx < frameCount; ++frameIdx) {
+            if (encodedFrames[frameIdx]) CFRelease(encodedFrames[frameIdx]);
+        }
+        free(encodedFrames);
+    };
+    // Frames are independent, so they are encoded on a bounded number of workers. The semaphore
+    // also limits how many imported frames are kept in memory at once.
+    __auto_type queue = dispatch_get_global_queue(qos_class_self(), 0);
+    __auto_type group = dispatch_group_create();
+    __auto_type inFlight = dispatch_semaphore_create((long) webpConcurrencyLimit());
+    // Blocks capture the address, the group wait below keeps the flag alive until the workers finish.
+    atomic_bool isFailed = false;
+    atomic_bool * const failure = &isFailed;
+    for (NSUInteger frameIdx = 0; frameIdx < frameCount && !atomic_load(&isFailed); ++frameIdx) {
+        dispatch_semaphore_wait(inFlight, DISPATCH_TIME_FOREVER);
+        CGImageRef cgImage = CGImageRetain(frames[frameIdx].image.CGImage);
+        dispatch_group_async(group, queue, ^{
+            @autoreleasepool {
+                if (!atomic_load(failure) && cgImage && !(encodedFrames[frameIdx] = webpCreateDataFromCGImage(cgImage, config))) {
+                    atomic_store(failure, true);
+                }
+                CGImageRelease(cgImage);
+            }
+            dispatch_semaphore_signal(inFlight);
+        });
+    }
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    if (atomic_load(&isFailed)) {
+        return nil;
+    }
+
     WebPMux *mux;
     if (!(mux = WebPMuxNew())) {
         return nil;
     }
-    for (WIKAnimationFrame *frame in frames) {
-        NSData *webpData;
-        if (!(webpData = (__bridge_transfer NSData *) webpCreateDataFromCGImage(frame.image.CGImage, config))) {
+    for (NSUInteger frameIdx = 0; frameIdx < frameCount; ++frameIdx) {
+        CFDataRef webpData;
+        if (!(webpData = encodedFrames[frameIdx])) {
+            WebPMuxDelete(mux);
             return nil;
         }
-        int duration = (int)trunc(frame.duration * 1000);
+        int duration = (int)trunc(frames[frameIdx].duration * 1000);
         WebPMuxFrameInfo frameInfo = {
-                .bitstream.bytes = webpData.bytes,
-                .bitstream.size = webpData.length,
+                .bitstream.bytes = CFDataGetBytePtr(webpData),
+                .bitstream.size = (size_t) CFDataGetLength(webpData),
                 .duration = duration,
                 .id = WEBP_CHUNK_ANMF,
                 .dispose_method = WEBP_MUX_DISPOSE_BACKGROUND, // each frame will clear canvas
@@ -244,11 +346,68 @@ static void *kLoopCountKey = &kLoopCountKey;
     }
 
     WebPData outputData;
-    WebPMuxError error = WebPMuxAssemble(mux, &outputData);
+    const BOOL isAssembled = webpCodecAssemble(mux, &outputData);
     WebPMuxDelete(mux);
-    if (error != WEBP_MUX_OK) {
+    if (!isAssembled) {
+        return nil;
+    }
+    NSData *imageData = [NSData dataWithBytes:outputData.bytes length:outputData.size];
+    WebPDataClear(&outputData);
+    return imageData;
+}
+
++ (nullable NSData *)webpDataWithInterFrameAnimationFrames:(NSArray<WIKAnimationFrame *> * const)frames
+                                                    config:(WIKEncoderConfig * const)config
+                                                 loopCount:(const NSUInteger)loopCount {
+    CGImageRef firstImg;
+    if (!(firstImg = frames.firstObject.image.CGImage)) {
+        return nil;
+    }
+    WebPConfig webpConfig;
+    WebPAnimEncoderOptions options;
+    if (![config setupWebpEncoderConfiguration:&webpConfig]
+            || ![config setupWebpAnimationOptions:&options loopCount:(int)loopCount]) {
+        return nil;
+    }
+    // All frames share the canvas of the first one, libwebp finds changed sub-rectangles,
+    // picks blending and key frames, and merges frames without changes.
+    const __auto_type canvasSize = webpEncoderTargetSize(CGSizeMake(CGImageGetWidth(firstImg), CGImageGetHeight(firstImg)),
+                                                         config);
+    WebPAnimEncoder *encoder;
+    if (!(encoder = WebPAnimEncoderNew((int)canvasSize.width, (int)canvasSize.height, &options))) {
+        return nil;
+    }
+    @webp_defer {
+        WebPAnimEncoderDelete(encoder);
+    };
+    // Frames share the picture and the conversion context, the encoder copies the pixels it needs.
+    __block WebPPicture picture;
+    __block CGContextRef context = NULL;
+    if (!WebPPictureInit(&picture)) {
+        return nil;
+    }
+    @webp_defer {
+        WebPPictureFree(&picture);
+        CGContextRelease(context);
+    };
+    int timestamp = 0;
+    for (WIKAnimationFrame *frame in frames) {
+        @autoreleasepool {
+            const BOOL isAdded = webpImportCGImageWithContext(frame.image.CGImage, &picture, canvasSize, &context)
+                    && WebPAnimEncoderAdd(encoder, &picture, timestamp, &webpConfig);
+            if (!isAdded) {
+                return nil;
+            }
+            timestamp += (int)trunc(frame.duration * 1000);
+        }
+    }
+    WebPData outputData;
+    WebPDataInit(&outputData);
+    const uint64_t metricsStart = webpMetricsStageBegin();
+    if (!WebPAnimEncoderAdd(encoder, NULL, timestamp, NULL) || !WebPAnimEncoderAssemble(encoder, &outputData)) {
         return nil;
     }
+    webpMetricsStageEnd(WebpMetricsStageMux, metricsStart, outputData.size);
     NSData *imageData = [NSData dataWithBytes:outputData.bytes length:outputData.size];
     WebPDataClear(&outputData);
     return imageData;
@@ -293,6 +452,27 @@ static NSUInteger gcdIn(NSUInteger a, NSUInteger b) {
     return b;
 }
 
+// Feeds the data to the incremental decoder in chunks, so the decode stops soon after cancellation.
+static CGImageRef __nullable webpCopyImageIncrementally(NSData * const data,
+                                                       const CGSize outputSize,
+                                                       BOOL (^ const isCancelled)(void)) CF_RETURNS_RETAINED {
+    static const NSUInteger chunkSize = 64 * 1024;
+    __auto_type decoder = [[WIKIncrementalDecoder alloc] initWithMaxPixelSize:(UInt32) MAX(outputSize.width, outputSize.height)];
+    __auto_type status = WIKIncrementalDecoderStatusNeedMoreData;
+    for (NSUInteger offset = 0; offset < data.length && WIKIncrementalDecoderStatusNeedMoreData == status; offset += chunkSize) {
+        if (isCancelled()) {
+            return NULL;
+        }
+        @autoreleasepool {
+            __auto_type chunk = [NSData dataWithBytesNoCopy:(void *) ((const uint8_t *) data.bytes + offset)
+                                                     length:MIN(chunkSize, data.length - offset)
+                                               freeWhenDone:NO];
+            status = [decoder appendData:chunk];
+        }
+    }
+    return WIKIncrementalDecoderStatusComplete == status ? [decoder copyImage] : NULL;
+}
+
 static NSUInteger gcdOf(size_t const count, NSUInteger const * const values) {
     if (count == 0 || !values) {
         return 0;
@@ -0,0 +1,124 @@
+//
+//  WIKAnimatedImage.h
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class UIImage;
+
+/**
+ * Animated WebP image which decodes frames on demand. Only the compressed data, a single
+ * canvas and a small ring of recently decoded frames are kept in memory, so memory usage
+ * doesn't depend on the number of frames. Safe to use from multiple threads.
+ */
+@interface WIKAnimatedImage : NSObject
+
+/**
+ * Compressed image data.
+ */
+@property (nonatomic, readonly) NSData *data;
+
+/**
+ * The number of frames in the image (1 for non-animated images).
+ */
+@property (nonatomic, readonly) NSUInteger frameCount;
+
+/**
+ * The number of animation cycles to play (0 means infinite). For non-animated images, this value is NSNotFound.
+ */
+@property (nonatomic, readonly) NSUInteger loopCount;
+
+/**
+ * Size of the frames in points.
+ */
+@property (nonatomic, readonly) CGSize size;
+
+/**
+ * Scale factor of the frames.
+ */
+@property (nonatomic, readonly) CGFloat scale;
+
+/**
+ * Duration of one animation cycle in seconds.
+ */
+@property (nonatomic, readonly) NSTimeInterval duration;
+
+/**
+ * Maximum number of decoded frames kept in memory. The default value is 3.
+ */
+@property (nonatomic) NSUInteger maxCachedFrameCount;
+
+/**
+ * Creates a new animated image from the data in WebP format.
+ *
+ * @param data
+ *        Image data in WebP format.
+ * @return New image or nil if data can't be parsed.
+ */
++ (nullable instancetype)animatedImageWithData:(NSData * const)data;
+
+/**
+ * Creates a new animated image from the file in WebP format. The file is memory-mapped,
+ * so the compressed data is read from disk on demand instead of being kept in memory.
+ *
+ * @param path
+ *        Path to the image file in WebP format.
+ * @return New image or nil if the file can't be read or parsed.
+ */
++ (nullable instancetype)animatedImageWithContentsOfFile:(NSString * const)path;
+
+/**
+ * Creates a new animated image from the data in WebP format. Frames will have
+ * a given size and scale factor.
+ * @warning This method expects the size of frames in points.
+ *
+ * @param data
+ *        Image data in WebP format.
+ * @param size
+ *        Size of the frames in points. For CGSizeZero - uses the original image size.
+ * @param scaleFactor
+ *        The scale factor of the frames.
+ * @return New image or nil if data can't be parsed.
+ */
+- (nullable instancetype)initWithData:(NSData * const)data
+                          displaySize:(const CGSize)size
+                          scaleFactor:(const CGFloat)scaleFactor NS_DESIGNATED_INITIALIZER;
+
+/**
+ * Returns duration of the frame in seconds.
+ *
+ * @param index
+ *        Zero based frame index.
+ * @return Duration of the frame or 0 if the index is out of bounds.
+ */
+- (NSTimeInterval)durationAtIndex:(const NSUInteger)index;
+
+/**
+ * Returns a frame image, decoding it if needed. Sequential access costs a single frame decode,
+ * seeking decodes frames starting from the nearest key frame which doesn't depend on previous frames.
+ *
+ * @param index
+ *        Zero based frame index.
+ * @return Frame image or nil if the index is out of bounds or decoding failed.
+ */
+- (nullable UIImage *)frameAtIndex:(const NSUInteger)index;
+
+/**
+ * Releases all cached frames and the canvas, e.g. on memory pressure. The next frame request
+ * decodes it from the compressed data starting at the nearest key frame.
+ */
+- (void)purgeFrames;
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@end
+
+NS_ASSUME_NONNULL_END
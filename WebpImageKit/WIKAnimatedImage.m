@@ -0,0 +1,163 @@
+//
+//  WIKAnimatedImage.m
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+#import <os/lock.h>
+
+#import "WIKAnimatedImage.h"
+#import "WIKAnimationDecoder.h"
+#import "NSData+WebP.h"
+#import "WebpMetrics.h"
+#import "WebpImageKitMacro.h"
+
+static const NSUInteger kDefaultCachedFrameCount = 3;
+
+@implementation WIKAnimatedImage {
+@private
+    os_unfair_lock _lock;
+    WIKAnimationDecoder *_decoder;
+    NSMutableArray<UIImage *> *_cachedFrames;
+    NSUInteger *_cachedIndexes;
+    NSUInteger _cacheCapacity;
+    NSUInteger _cacheHead;
+}
+
++ (nullable instancetype)animatedImageWithData:(NSData * const)data {
+    return [[self alloc] initWithData:data displaySize:CGSizeZero scaleFactor:1.0];
+}
+
++ (nullable instancetype)animatedImageWithContentsOfFile:(NSString * const)path {
+    NSData *data;
+    if (!path || !(data = [NSData webpDataWithContentsOfMappedFile:path])) {
+        return nil;
+    }
+    return [[self alloc] initWithData:data displaySize:CGSizeZero scaleFactor:1.0];
+}
+
+- (nullable instancetype)initWithData:(NSData * const)data
+                          displaySize:(const CGSize)size
+                          scaleFactor:(const CGFloat)scaleFactor {
+    if (!data.webpIsImage) {
+        return nil;
+    }
+    if (self = [super init]) {
+        _lock = OS_UNFAIR_LOCK_INIT;
+        _scale = MAX(scaleFactor, 1.0);
+        if (!(_decoder = [[WIKAnimationDecoder alloc] initWithData:data targetSize:CGSizeZero])) {
+            return nil;
+        }
+        _decoder.outputSize = scaledImageSize(_decoder.canvasSize, size, _scale);
+        _data = data;
+        _frameCount = _decoder.frameCount;
+        _loopCount = _decoder.loopCount;
+        _size = CGSizeMake(_decoder.outputSize.width / _scale, _decoder.outputSize.height / _scale);
+        NSTimeInterval duration = 0.0;
+        for (NSUInteger frameIdx = 0; frameIdx < _frameCount; ++frameIdx) {
+            duration += [_decoder durationAtIndex:frameIdx];
+        }
+        _duration = duration;
+        [self resizeCacheToCapacity:kDefaultCachedFrameCount];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (_cachedIndexes) {
+        free(_cachedIndexes);
+    }
+}
+
+- (NSTimeInterval)durationAtIndex:(const NSUInteger)index {
+    return [_decoder durationAtIndex:index];
+}
+
+- (nullable UIImage *)frameAtIndex:(const NSUInteger)index {
+    if (index >= _frameCount) {
+        return nil;
+    }
+    webpMetricsOperationBegin(WebpMetricsOperationDecode);
+    @webp_defer {
+        webpMetricsOperationEnd();
+    };
+    os_unfair_lock_lock(&_lock);
+    @webp_defer {
+        os_unfair_lock_unlock(&self->_lock);
+    };
+    UIImage *image;
+    if ((image = [self cachedFrameAtIndex:index])) {
+        return image;
+    }
+    CGImageRef cgImage;
+    if (!(cgImage = [_decoder copyFrameAtIndex:index])) {
+        return nil;
+    }
+    image = [[UIImage alloc] initWithCGImage:cgImage scale:_scale orientation:UIImageOrientationUp];
+    CGImageRelease(cgImage);
+    [self cacheFrame:image atIndex:index];
+    return image;
+}
+
+- (NSUInteger)maxCachedFrameCount {
+    os_unfair_lock_lock(&_lock);
+    __auto_type result = _cacheCapacity;
+    os_unfair_lock_unlock(&_lock);
+    return result;
+}
+
+- (void)setMaxCachedFrameCount:(NSUInteger)count {
+    os_unfair_lock_lock(&_lock);
+    [self resizeCacheToCapacity:count];
+    os_unfair_lock_unlock(&_lock);
+}
+
+- (void)purgeFrames {
+    os_unfair_lock_lock(&_lock);
+    [self resizeCacheToCapacity:_cacheCapacity];
+    [_decoder purgeCanvas];
+    os_unfair_lock_unlock(&_lock);
+}
+
+#pragma mark - Frames ring
+
+- (void)resizeCacheToCapacity:(NSUInteger)capacity {
+    if (_cachedIndexes) {
+        free(_cachedIndexes);
+        _cachedIndexes = NULL;
+    }
+    _cacheCapacity = 0;
+    _cacheHead = 0;
+    _cachedFrames = [NSMutableArray arrayWithCapacity:capacity];
+    if (0 < capacity && (_cachedIndexes = calloc(capacity, sizeof(NSUInteger)))) {
+        _cacheCapacity = capacity;
+    }
+}
+
+- (nullable UIImage *)cachedFrameAtIndex:(NSUInteger)index {
+    for (NSUInteger slot = 0; slot < _cachedFrames.count; ++slot) {
+        if (_cachedIndexes[slot] == index) {
+            return _cachedFrames[slot];
+        }
+    }
+    return nil;
+}
+
+- (void)cacheFrame:(UIImage *)image atIndex:(NSUInteger)index {
+    if (0 == _cacheCapacity) {
+        return;
+    }
+    if (_cachedFrames.count < _cacheCapacity) {
+        _cachedIndexes[_cachedFrames.count] = index;
+        [_cachedFrames addObject:image];
+        return;
+    }
+    _cachedIndexes[_cacheHead] = index;
+    _cachedFrames[_cacheHead] = image;
+    _cacheHead = (_cacheHead + 1) % _cacheCapacity;
+}
+
+@end
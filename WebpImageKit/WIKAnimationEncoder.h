@@ -0,0 +1,88 @@
+//
+//  WIKAnimationEncoder.h
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <UIKit/UIKit.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class WIKEncoderConfig;
+
+/**
+ * Encodes an animation frame by frame. Every frame is encoded when it is appended and written
+ * to the output right away, so neither the frame pixels nor the encoded frames are kept until
+ * the end. The encoder keeps one canvas and the last encoded frame, identical frames are merged
+ * into it in WIKAnimationModeInterFrame.
+ * In WIKAnimationModeInterFrame frames are scaled to the canvas of the first frame and only
+ * the changed sub-rectangle is encoded. Key frames are inserted every `maxKeyFrameDistance` frames.
+ * In WIKAnimationModeIndependentFrames every frame is encoded in full.
+ * @warning Not thread-safe, callers are responsible for serializing access.
+ */
+@interface WIKAnimationEncoder : NSObject
+
+@property (nonatomic, readonly) WIKEncoderConfig *config;
+@property (nonatomic, readonly) NSUInteger frameCount;
+@property (nonatomic, readonly) NSTimeInterval duration;
+
+/**
+ * The encoded animation, when encoding into memory. Available after `finish`.
+ */
+@property (nonatomic, readonly, nullable) NSData *data;
+
+/**
+ * Creates encoder which writes the animation into memory.
+ *
+ * @param config
+ *        Encoder settings.
+ * @param loopCount
+ *        Number of times to repeat the animation, 0 means infinite.
+ * @return New encoder or nil if the configuration is invalid.
+ */
+- (nullable instancetype)initWithConfig:(WIKEncoderConfig * const)config loopCount:(const NSUInteger)loopCount;
+
+/**
+ * Creates encoder which writes the animation into the file. The output goes to a temporary file
+ * which atomically replaces the file at `path` when the animation is finished.
+ *
+ * @param config
+ *        Encoder settings.
+ * @param loopCount
+ *        Number of times to repeat the animation, 0 means infinite.
+ * @param path
+ *        Destination file path.
+ * @return New encoder or nil if the configuration is invalid or the file can't be created.
+ */
+- (nullable instancetype)initWithConfig:(WIKEncoderConfig * const)config
+                              loopCount:(const NSUInteger)loopCount
+                                   path:(nullable NSString * const)path NS_DESIGNATED_INITIALIZER;
+
+/**
+ * Encodes and writes the frame. The image isn't referenced after the call returns.
+ *
+ * @param image
+ *        Frame image, animated images aren't supported.
+ * @param duration
+ *        Frame duration in seconds.
+ * @return NO if the frame can't be encoded or written, the encoder can't be used anymore then.
+ */
+- (BOOL)appendFrame:(UIImage * const)image duration:(const NSTimeInterval)duration;
+- (BOOL)appendCGImage:(CGImageRef)imageRef duration:(const NSTimeInterval)duration;
+
+/**
+ * Writes the last frame and completes the animation.
+ *
+ * @return YES if the animation is written.
+ */
+- (BOOL)finish;
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,407 @@
+//
+//  WIKAnimationEncoder.m
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#import <unistd.h>
+
+#import <libwebp/encode.h>
+
+#import "WIKAnimationEncoder.h"
+#import "CoreGraphics+WebP.h"
+#import "WIKEncoderConfig+Internal.h"
+#import "WebpMetrics.h"
+#import "WebpImageKitMacro.h"
+
+// RIFF header, VP8X chunk with 10 bytes payload and ANIM chunk with 6 bytes payload.
+#define WEBP_ANIMATION_HEADER_SIZE (12 + 18 + 14)
+#define WEBP_VP8X_FLAGS_OFFSET 20
+#define WEBP_VP8X_CANVAS_OFFSET 24
+#define WEBP_ANIM_LOOP_OFFSET 42
+#define WEBP_ANMF_HEADER_SIZE (8 + 16)
+#define WEBP_ANMF_DURATION_OFFSET 20
+
+#define WEBP_VP8X_ANIMATION_FLAG 0x02
+#define WEBP_VP8X_ALPHA_FLAG 0x10
+#define WEBP_ANMF_DISPOSE_FLAG 0x01
+#define WEBP_ANMF_NO_BLEND_FLAG 0x02
+#define WEBP_MAX_DURATION 0xffffff
+
+static inline void webpPutLE16(uint8_t *bytes, uint32_t value) {
+    bytes[0] = (uint8_t) (value & 0xff);
+    bytes[1] = (uint8_t) ((value >> 8) & 0xff);
+}
+
+static inline void webpPutLE24(uint8_t *bytes, uint32_t value) {
+    webpPutLE16(bytes, value);
+    bytes[2] = (uint8_t) ((value >> 16) & 0xff);
+}
+
+static inline void webpPutLE32(uint8_t *bytes, uint32_t value) {
+    webpPutLE24(bytes, value);
+    bytes[3] = (uint8_t) ((value >> 24) & 0xff);
+}
+
+static inline uint32_t webpGetLE32(const uint8_t *bytes) {
+    return (uint32_t) bytes[0] | ((uint32_t) bytes[1] << 8) | ((uint32_t) bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+}
+
+static inline uint32_t webpDurationFromInterval(const NSTimeInterval duration) {
+    const double milliseconds = trunc(duration * 1000);
+    return 0 < milliseconds ? (uint32_t) MIN(milliseconds, WEBP_MAX_DURATION) : 0;
+}
+
+// Finds the smallest rectangle holding all pixels which differ between the frames, returns NO for identical frames.
+static BOOL webpFindChangedRect(const uint32_t *current, size_t currentStride,
+                                const uint32_t *previous, size_t previousStride,
+                                size_t width, size_t height, CGRect *rect) {
+    size_t minY = height, maxY = 0;
+    for (size_t y = 0; y < height; ++y) {
+        if (0 != memcmp(current + y * currentStride, previous + y * previousStride, width * sizeof(uint32_t))) {
+            minY = MIN(minY, y);
+            maxY = y;
+        }
+    }
+    if (minY == height) {
+        return NO;
+    }
+    size_t minX = width, maxX = 0;
+    for (size_t y = minY; y <= maxY; ++y) {
+        const uint32_t *currentRow = current + y * currentStride;
+        const uint32_t *previousRow = previous + y * previousStride;
+        for (size_t x = 0; x < minX; ++x) {
+            if (currentRow[x] != previousRow[x]) {
+                minX = x;
+                break;
+            }
+        }
+        for (size_t x = width; x > maxX + 1; --x) {
+            if (currentRow[x - 1] != previousRow[x - 1]) {
+                maxX = x - 1;
+                break;
+            }
+        }
+    }
+    maxX = MAX(minX, maxX);
+    // ANMF offsets are stored divided by two.
+    minX &= ~(size_t) 1;
+    minY &= ~(size_t) 1;
+    *rect = CGRectMake(minX, minY, maxX + 1 - minX, maxY + 1 - minY);
+    return YES;
+}
+
+@implementation WIKAnimationEncoder {
+@private
+    WebPConfig _webpConfig;
+    WebPPicture _picture;
+    WebPMemoryWriter _writer;
+    CGContextRef _context;
+    NSUInteger _keyFrameDistance;
+    NSUInteger _framesSinceKeyFrame;
+    uint32_t *_previousPixels;
+    NSMutableData *_pendingFrame;
+    uint32_t _pendingDuration;
+    uint32_t _canvasWidth;
+    uint32_t _canvasHeight;
+    BOOL _hasAlpha;
+    BOOL _hasPartialFrames;
+    BOOL _isFailed;
+    BOOL _isFinished;
+    NSMutableData *_output;
+    NSString *_path;
+    char *_tmpPath;
+    int _fd;
+    uint64_t _outputSize;
+}
+
+- (nullable instancetype)initWithConfig:(WIKEncoderConfig * const)config loopCount:(const NSUInteger)loopCount {
+    return [self initWithConfig:config loopCount:loopCount path:nil];
+}
+
+- (nullable instancetype)initWithConfig:(WIKEncoderConfig * const)config
+                              loopCount:(const NSUInteger)loopCount
+                                   path:(nullable NSString * const)path {
+    if (!config) {
+        return nil;
+    }
+    if (self = [super init]) {
+        _config = [config copy];
+        _fd = -1;
+        if (![config setupWebpEncoderConfiguration:&_webpConfig] || !WebPPictureInit(&_picture)) {
+            return nil;
+        }
+        WebPMemoryWriterInit(&_writer);
+        if (WIKAnimationModeInterFrame == config.animationMode) {
+            _keyFrameDistance = (NSUInteger) MAX(config.maxKeyFrameDistance.integerValue, 0);
+        }
+        if (path) {
+            // Output goes to a temporary file which replaces the destination when the animation is finished.
+            _path = [path copy];
+            if (0 > (_fd = webpCreateTemporaryFile(path.fileSystemRepresentation, &_tmpPath))) {
+                return nil;
+            }
+        }
+        else {
+            _output = [NSMutableData new];
+        }
+        // Canvas size and flags are unknown until the last frame, the header is patched in `finish`.
+        uint8_t header[WEBP_ANIMATION_HEADER_SIZE] = {0};
+        memcpy(header, "RIFF", 4);
+        memcpy(header + 8, "WEBPVP8X", 8);
+        webpPutLE32(header + 16, 10);
+        memcpy(header + 30, "ANIM", 4);
+        webpPutLE32(header + 34, 6);
+        webpPutLE16(header + WEBP_ANIM_LOOP_OFFSET, (uint32_t) MIN(loopCount, 0xffff));
+        if (![self writeBytes:header length:sizeof(header)]) {
+            return nil;
+        }
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [self purge];
+    if (0 <= _fd) {
+        close(_fd);
+        unlink(_tmpPath);
+    }
+    free(_tmpPath);
+}
+
+- (nullable NSData *)data {
+    return _isFinished ? _output : nil;
+}
+
+- (BOOL)appendFrame:(UIImage * const)image duration:(const NSTimeInterval)duration {
+    CGImageRef imageRef = image.images.firstObject.CGImage ?: image.CGImage;
+    return imageRef ? [self appendCGImage:imageRef duration:duration] : NO;
+}
+
+- (BOOL)appendCGImage:(CGImageRef)imageRef duration:(const NSTimeInterval)duration {
+    const size_t width = imageRef ? CGImageGetWidth(imageRef) : 0;
+    const size_t height = imageRef ? CGImageGetHeight(imageRef) : 0;
+    if (_isFailed || _isFinished || 0 == width || 0 == height) {
+        return NO;
+    }
+    webpMetricsOperationBegin(WebpMetricsOperationEncode);
+    @webp_defer {
+        webpMetricsOperationEnd();
+    };
+    const BOOL isAppended = WIKAnimationModeInterFrame == _config.animationMode
+            ? [self appendInterFrame:imageRef duration:webpDurationFromInterval(duration)]
+            : [self appendIndependentFrame:imageRef duration:webpDurationFromInterval(duration)];
+    if (!isAppended) {
+        _isFailed = YES;
+        return NO;
+    }
+    _frameCount++;
+    _duration += duration;
+    return YES;
+}
+
+- (BOOL)finish {
+    if (_isFinished) {
+        return YES;
+    }
+    _isFinished = YES;
+    BOOL result = !_isFailed
+            && [self flushPendingFrame]
+            && 0 < _frameCount
+            && UINT32_MAX >= _outputSize - 8;
+    if (result) {
+        uint8_t riffSize[4];
+        webpPutLE32(riffSize, (uint32_t) (_outputSize - 8));
+        uint8_t vp8x[10] = {0};
+        vp8x[0] = WEBP_VP8X_ANIMATION_FLAG | (_hasAlpha || _hasPartialFrames ? WEBP_VP8X_ALPHA_FLAG : 0);
+        webpPutLE24(vp8x + 4, _canvasWidth - 1);
+        webpPutLE24(vp8x + 7, _canvasHeight - 1);
+        result = [self replaceBytesAtOffset:4 bytes:riffSize length:sizeof(riffSize)]
+                && [self replaceBytesAtOffset:WEBP_VP8X_FLAGS_OFFSET bytes:vp8x length:sizeof(vp8x)];
+    }
+    [self purge];
+    if (0 <= _fd) {
+        result = webpCommitTemporaryFile(_fd, _tmpPath, _path.fileSystemRepresentation, result);
+        _fd = -1;
+    }
+    else if (!result) {
+        _output = nil;
+    }
+    return result;
+}
+
+#pragma mark - Private
+
+- (BOOL)appendIndependentFrame:(CGImageRef)imageRef duration:(const uint32_t)duration {
+    const __auto_type size = webpEncoderTargetSize(CGSizeMake(CGImageGetWidth(imageRef), CGImageGetHeight(imageRef)),
+                                                   _config);
+    if (!webpImportCGImageWithContext(imageRef, &_picture, size, &_context)) {
+        return NO;
+    }
+    const __auto_type width = (uint32_t) _picture.width;
+    const __auto_type height = (uint32_t) _picture.height;
+    // Every frame is drawn at the origin of the canvas, the largest frame defines its size.
+    if (0 < _frameCount && (width != _canvasWidth || height != _canvasHeight)) {
+        _hasPartialFrames = YES;
+    }
+    _canvasWidth = MAX(_canvasWidth, width);
+    _canvasHeight = MAX(_canvasHeight, height);
+    _hasAlpha = _hasAlpha || webpCGImageContainsAlpha(imageRef);
+    return [self flushPendingFrame]
+            && [self encodePicture:&_picture
+                           originX:0
+                           originY:0
+                          duration:duration
+                             flags:WEBP_ANMF_DISPOSE_FLAG | WEBP_ANMF_NO_BLEND_FLAG];
+}
+
+- (BOOL)appendInterFrame:(CGImageRef)imageRef duration:(const uint32_t)duration {
+    if (0 == _frameCount) {
+        const __auto_type size = webpEncoderTargetSize(CGSizeMake(CGImageGetWidth(imageRef), CGImageGetHeight(imageRef)),
+                                                       _config);
+        _canvasWidth = (uint32_t) trunc(size.width);
+        _canvasHeight = (uint32_t) trunc(size.height);
+    }
+    // All frames are scaled to the canvas, so the previous frame can be compared pixel by pixel.
+    if (!webpImportCGImageWithContext(imageRef, &_picture, CGSizeMake(_canvasWidth, _canvasHeight), &_context)) {
+        return NO;
+    }
+    _hasAlpha = _hasAlpha || webpCGImageContainsAlpha(imageRef);
+    const size_t pixelCount = (size_t) _canvasWidth * _canvasHeight;
+    if (!_previousPixels && !(_previousPixels = malloc(pixelCount * sizeof(uint32_t)))) {
+        return NO;
+    }
+    const BOOL isKeyFrame = 0 == _frameCount
+            || (0 < _keyFrameDistance && _framesSinceKeyFrame + 1 >= _keyFrameDistance);
+    CGRect rect = CGRectMake(0, 0, _canvasWidth, _canvasHeight);
+    if (!isKeyFrame && !webpFindChangedRect(_picture.argb, (size_t) _picture.argb_stride,
+                                            _previousPixels, _canvasWidth,
+                                            _canvasWidth, _canvasHeight, &rect)) {
+        // Identical frames only extend the duration of the frame which isn't written yet.
+        _pendingDuration = MIN(_pendingDuration + duration, WEBP_MAX_DURATION);
+        return YES;
+    }
+    _framesSinceKeyFrame = isKeyFrame ? 0 : _framesSinceKeyFrame + 1;
+    // The lossless encoder may modify transparent pixels, so the frame is kept before encoding.
+    for (size_t y = 0; y < _canvasHeight; ++y) {
+        memcpy(_previousPixels + y * _canvasWidth,
+               _picture.argb + y * (size_t) _picture.argb_stride,
+               _canvasWidth * sizeof(uint32_t));
+    }
+    if (![self flushPendingFrame]) {
+        return NO;
+    }
+    if (isKeyFrame) {
+        return [self encodePicture:&_picture originX:0 originY:0 duration:duration flags:WEBP_ANMF_NO_BLEND_FLAG];
+    }
+    WebPPicture view;
+    if (!WebPPictureView(&_picture, (int) rect.origin.x, (int) rect.origin.y,
+                         (int) rect.size.width, (int) rect.size.height, &view)) {
+        return NO;
+    }
+    const BOOL result = [self encodePicture:&view
+                                    originX:(uint32_t) rect.origin.x
+                                    originY:(uint32_t) rect.origin.y
+                                   duration:duration
+                                      flags:WEBP_ANMF_NO_BLEND_FLAG];
+    // The view doesn't own the pixels, only the planes the encoder converted it to.
+    WebPPictureFree(&view);
+    return result;
+}
+
+// Encodes the picture into the pending ANMF chunk, the chunk is written when the next distinct frame arrives.
+- (BOOL)encodePicture:(WebPPicture *)picture
+              originX:(const uint32_t)originX
+              originY:(const uint32_t)originY
+             duration:(const uint32_t)duration
+                flags:(const uint8_t)flags {
+    _writer.size = 0;
+    if (!webpEncodePictureWithConfig(picture, &_webpConfig, _config, WebPMemoryWrite, &_writer) || 12 > _writer.size) {
+        return NO;
+    }
+    if (!_pendingFrame) {
+        _pendingFrame = [NSMutableData dataWithCapacity:_writer.size + WEBP_ANMF_HEADER_SIZE];
+    }
+    uint8_t header[WEBP_ANMF_HEADER_SIZE] = {0};
+    memcpy(header, "ANMF", 4);
+    webpPutLE24(header + 8, originX / 2);
+    webpPutLE24(header + 11, originY / 2);
+    webpPutLE24(header + 14, (uint32_t) picture->width - 1);
+    webpPutLE24(header + 17, (uint32_t) picture->height - 1);
+    header[23] = flags;
+    _pendingFrame.length = 0;
+    [_pendingFrame appendBytes:header length:sizeof(header)];
+    // Only the image data chunks of the encoded still image go into the frame.
+    size_t offset = 12;
+    while (offset + 8 <= _writer.size) {
+        const uint8_t *chunk = _writer.mem + offset;
+        const size_t chunkSize = 8 + (size_t) webpGetLE32(chunk + 4);
+        const size_t paddedSize = chunkSize + (chunkSize & 1);
+        if (offset + chunkSize > _writer.size) {
+            return NO;
+        }
+        if (0 == memcmp(chunk, "ALPH", 4) || 0 == memcmp(chunk, "VP8 ", 4) || 0 == memcmp(chunk, "VP8L", 4)) {
+            [_pendingFrame appendBytes:chunk length:chunkSize];
+            if (chunkSize != paddedSize) {
+                [_pendingFrame appendBytes:"\0" length:1];
+            }
+        }
+        offset += paddedSize;
+    }
+    webpPutLE32((uint8_t *) _pendingFrame.mutableBytes + 4, (uint32_t) (_pendingFrame.length - 8));
+    _pendingDuration = duration;
+    return YES;
+}
+
+- (BOOL)flushPendingFrame {
+    if (0 == _pendingFrame.length) {
+        return YES;
+    }
+    webpPutLE24((uint8_t *) _pendingFrame.mutableBytes + WEBP_ANMF_DURATION_OFFSET, _pendingDuration);
+    const BOOL result = [self writeBytes:_pendingFrame.bytes length:_pendingFrame.length];
+    _pendingFrame.length = 0;
+    return result;
+}
+
+- (BOOL)writeBytes:(const void *)bytes length:(size_t)length {
+    _outputSize += length;
+    if (_output) {
+        [_output appendBytes:bytes length:length];
+        return YES;
+    }
+    const uint8_t *data = bytes;
+    while (0 < length) {
+        const ssize_t written = write(_fd, data, length);
+        if (0 > written) {
+            if (EINTR == errno) continue;
+            return NO;
+        }
+        data += written;
+        length -= (size_t) written;
+    }
+    return YES;
+}
+
+- (BOOL)replaceBytesAtOffset:(const off_t)offset bytes:(const void *)bytes length:(const size_t)length {
+    if (_output) {
+        [_output replaceBytesInRange:NSMakeRange((NSUInteger) offset, length) withBytes:bytes];
+        return YES;
+    }
+    return (ssize_t) length == pwrite(_fd, bytes, length, offset);
+}
+
+- (void)purge {
+    WebPPictureFree(&_picture);
+    WebPMemoryWriterClear(&_writer);
+    free(_previousPixels);
+    _previousPixels = NULL;
+    _pendingFrame = nil;
+    if (_context) {
+        CGContextRelease(_context);
+        _context = NULL;
+    }
+}
+
+@end
@@ -13,16 +13,27 @@ NS_ASSUME_NONNULL_BEGIN
 
 typedef NS_ENUM(int, WIKEncoderMode) {
     WIKEncoderModeLossy = 0,
-    WIKEncoderModeLossLess = 1
+    WIKEncoderModeLossLess = 1,
+    WIKEncoderModeAuto = 2      // chosen per image from its content, see `-[WIKEncoderConfigBuilder setMode:]`
+};
+
+typedef NS_ENUM(NSInteger, WIKAnimationMode) {
+    WIKAnimationModeIndependentFrames = 0,  // every frame is encoded as a full canvas (default).
+    WIKAnimationModeInterFrame              // only changed sub-rectangles are encoded, identical frames are merged.
+};
+
+typedef NS_ENUM(NSInteger, WIKRateControl) {
+    WIKRateControlMultiPass = 0,    // libwebp's size search, a full encode for every pass (default).
+    WIKRateControlPredictive        // quality is predicted from a trial encode, then refined in up to two passes.
 };
 
 /**
  * Encoder configuration. By default, all values are nil, and only non-nil
  * values are applied to the encoder configuration.
  */
-@interface WIKEncoderConfig: NSObject
+@interface WIKEncoderConfig: NSObject <NSCopying>
 
-@property (nonatomic, readonly) WIKEncoderMode mode;                    // Lossless encoding (0=lossy(default), 1=lossless).
+@property (nonatomic, readonly) WIKEncoderMode mode;                    // Lossless encoding (0=lossy(default), 1=lossless, 2=auto).
 @property (nonatomic, readonly, nullable) NSNumber *method;             // 0 (fast) - 6 (slower/better)
 @property (nonatomic, readonly, nullable) NSNumber *passes;             // number of entropy-analysis passes (in [1..10])
 @property (nonatomic, readonly, nullable) NSNumber *preprocessing;      // 0 - none, 1 - segment-smooth
@@ -43,6 +54,14 @@ typedef NS_ENUM(int, WIKEncoderMode) {
 @property (nonatomic, readonly, nullable) NSNumber *partitionLimit;     // 0 (no degradation) - 100 (max degradation)
 @property (nonatomic, readonly, nullable) NSNumber *sharpYuv;           // if needed, use sharp (and slow) RGB->YUV conversion
 
+@property (nonatomic, readonly) WIKRateControl rateControl;             // how the target file size is reached
+@property (nonatomic, readonly, nullable) NSNumber *fileSizeTolerance;  // WIKRateControlPredictive only, accepted undershoot of the target size in [0.01..0.9], 0.1 by default
+
+@property (nonatomic, readonly) WIKAnimationMode animationMode;         // how frames of animated images are encoded
+@property (nonatomic, readonly, nullable) NSNumber *minKeyFrameDistance; // WIKAnimationModeInterFrame only, minimum distance between key frames
+@property (nonatomic, readonly, nullable) NSNumber *maxKeyFrameDistance; // WIKAnimationModeInterFrame only, maximum distance between key frames
+@property (nonatomic, readonly, nullable) NSNumber *allowMixed;         // WIKAnimationModeInterFrame only, choose lossy or lossless per frame
+
 @end
 
 typedef NS_ENUM(NSInteger, WIKContentHint) {
@@ -113,6 +132,19 @@ typedef NS_ENUM(NSInteger, WIKAlphaFilterType) {
  */
 - (WIKEncoderConfigBuilder *)setMaxPixelSize:(const CGSize)size;
 
+/**
+ * Sets the compression mode. WIKEncoderModeAuto classifies every image by its color count and
+ * edge statistics: photos are encoded lossy, graphics with few colors and hard edges lossless.
+ * For images in between both modes are encoded concurrently and the smaller result is kept,
+ * a lossy result only if it reaches `targetPSNR` (40 dB by default). Images with a target file
+ * size are always encoded lossy. Animations let libwebp choose per frame.
+ *
+ * @param mode
+ *        Compression mode.
+ * @return Builder instance.
+ */
+- (WIKEncoderConfigBuilder *)setMode:(const WIKEncoderMode)mode;
+
 - (WIKEncoderConfigBuilder *)setMethod:(const int)value;
 - (WIKEncoderConfigBuilder *)setPasses:(const int)value;
 - (WIKEncoderConfigBuilder *)setPreprocessing:(const BOOL)value;
@@ -133,6 +165,59 @@ typedef NS_ENUM(NSInteger, WIKAlphaFilterType) {
 - (WIKEncoderConfigBuilder *)setPartitionLimit:(const int)value;
 - (WIKEncoderConfigBuilder *)setSharpYuv:(const BOOL)value;
 
+/**
+ * Sets how the target file size is reached, only used by builders created with a file size.
+ * libwebp's multi-pass search is used unless the predictive mode is chosen. The predictive mode
+ * converges in one or two full encodes, the estimates improve as more images with the same
+ * content hint are encoded.
+ *
+ * @param rateControl
+ *        Rate control mode.
+ * @return Builder instance.
+ */
+- (WIKEncoderConfigBuilder *)setRateControl:(const WIKRateControl)rateControl;
+
+/**
+ * Sets how much smaller than the target file size the result can be, as a fraction of the
+ * target size. Smaller tolerances may need the second encoding pass more often.
+ *
+ * @param tolerance
+ *        Accepted undershoot in [0.01..0.9].
+ * @return Builder instance.
+ */
+- (WIKEncoderConfigBuilder *)setFileSizeTolerance:(const float)tolerance;
+
+/**
+ * Sets the encoding mode for animated images. WIKAnimationModeInterFrame diffs consecutive
+ * frames, encodes only changed sub-rectangles with blending and merges identical frames.
+ *
+ * @param mode
+ *        Animation encoding mode.
+ * @return Builder instance.
+ */
+- (WIKEncoderConfigBuilder *)setAnimationMode:(const WIKAnimationMode)mode;
+
+/**
+ * Sets the key frame distance range for WIKAnimationModeInterFrame. Frames between key frames
+ * depend on the previous ones, so shorter distances make seeking cheaper at the cost of size.
+ *
+ * @param minDistance
+ *        Minimum distance between key frames.
+ * @param maxDistance
+ *        Maximum distance between key frames, 0 disables key frames insertion.
+ * @return Builder instance.
+ */
+- (WIKEncoderConfigBuilder *)setKeyFrameDistanceMin:(const int)minDistance max:(const int)maxDistance;
+
+/**
+ * Allows WIKAnimationModeInterFrame to choose lossy or lossless compression per frame,
+ * whichever is smaller.
+ */
+- (WIKEncoderConfigBuilder *)setAllowMixed:(const BOOL)value;
+
+/**
+ * Returns a new configuration with the current settings, later changes of the builder don't affect it.
+ */
 - (WIKEncoderConfig *)construct;
 
 - (instancetype)init NS_UNAVAILABLE;
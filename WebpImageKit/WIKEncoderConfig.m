@@ -35,6 +35,12 @@
 @synthesize partitions = _partitions;
 @synthesize partitionLimit = _partitionLimit;
 @synthesize sharpYuv = _sharpYuv;
+@synthesize rateControl = _rateControl;
+@synthesize fileSizeTolerance = _fileSizeTolerance;
+@synthesize animationMode = _animationMode;
+@synthesize minKeyFrameDistance = _minKeyFrameDistance;
+@synthesize maxKeyFrameDistance = _maxKeyFrameDistance;
+@synthesize allowMixed = _allowMixed;
 
 - (WebPPreset)webpPreset {
     WebPPreset result;
@@ -84,6 +90,8 @@
     if (!config || !WebPConfigPreset(config, self.webpPreset, self.targetQuality.intValue)) {
         return NO;
     }
+    // The auto mode starts from the lossy settings and switches per image.
+    config->lossless = WIKEncoderModeLossLess == _mode ? 1 : 0;
     const __auto_type hint = self.imageHint;
     if (WEBP_HINT_DEFAULT != hint) {
         config->image_hint = hint;
@@ -156,10 +164,71 @@
     return 0 < WebPValidateConfig(config);
 }
 
+- (BOOL)setupWebpAnimationOptions:(WebPAnimEncoderOptions *)options loopCount:(int)loopCount {
+    if (!options || !WebPAnimEncoderOptionsInit(options)) {
+        return NO;
+    }
+    options->anim_params.loop_count = loopCount;
+    options->anim_params.bgcolor = 0;
+    if (nil != self.minKeyFrameDistance) {
+        options->kmin = self.minKeyFrameDistance.intValue;
+    }
+    if (nil != self.maxKeyFrameDistance) {
+        options->kmax = self.maxKeyFrameDistance.intValue;
+    }
+    if (nil != self.allowMixed) {
+        options->allow_mixed = self.allowMixed.intValue;
+    }
+    else if (WIKEncoderModeAuto == _mode) {
+        options->allow_mixed = 1;
+    }
+    return YES;
+}
+
 - (instancetype)init {
     return [self initWithQuality:75.f andPreset:WIKPresetDefault];
 }
 
+- (id)copyWithZone:(NSZone *)zone {
+    WIKEncoderConfig *copy = [[WIKEncoderConfig allocWithZone:zone] init];
+    if (copy) {
+        copy->_mode = _mode;
+        copy->_preset = _preset;
+        copy->_contentHint = _contentHint;
+        copy->_quality = _quality;
+        copy->_fileSize = _fileSize;
+        copy->_maxPixelSize = _maxPixelSize;
+        copy->_qmin = _qmin;
+        copy->_qmax = _qmax;
+        copy->_method = _method;
+        copy->_passes = _passes;
+        copy->_preprocessing = _preprocessing;
+        copy->_targetPSNR = _targetPSNR;
+        copy->_threadLevel = _threadLevel;
+        copy->_lowMemory = _lowMemory;
+        copy->_segments = _segments;
+        copy->_snsStrength = _snsStrength;
+        copy->_filterStrength = _filterStrength;
+        copy->_filterSharpness = _filterSharpness;
+        copy->_filterType = _filterType;
+        copy->_alphaCompression = _alphaCompression;
+        copy->_autoFilter = _autoFilter;
+        copy->_alphaFiltering = _alphaFiltering;
+        copy->_alphaQuality = _alphaQuality;
+        copy->_showCompressed = _showCompressed;
+        copy->_partitions = _partitions;
+        copy->_partitionLimit = _partitionLimit;
+        copy->_sharpYuv = _sharpYuv;
+        copy->_rateControl = _rateControl;
+        copy->_fileSizeTolerance = _fileSizeTolerance;
+        copy->_animationMode = _animationMode;
+        copy->_minKeyFrameDistance = _minKeyFrameDistance;
+        copy->_maxKeyFrameDistance = _maxKeyFrameDistance;
+        copy->_allowMixed = _allowMixed;
+    }
+    return copy;
+}
+
 - (nullable WIKEncoderConfig *)initWithQuality:(int)quality andPreset:(WIKPreset)preset {
     struct WebPConfig initCfg;
     if (!WebPConfigPreset(&initCfg, (WebPPreset)preset, quality)) {
@@ -199,7 +268,7 @@
 
 - (NSString *)description {
     __auto_type content = @{
-        @"mode": WIKEncoderModeLossLess == _mode ? @"lossLess" : @"lossy",
+        @"mode": WIKEncoderModeAuto == _mode ? @"auto" : (WIKEncoderModeLossLess == _mode ? @"lossLess" : @"lossy"),
         @"quality": self.targetQuality ?: @"null",
         @"qmin": self->_qmin ?: @"",
         @"qmax": self->_qmax ?: @"",
@@ -221,7 +290,13 @@
         @"showCompressed": self.showCompressed ?: @"null",
         @"partitions": self.partitions ?: @"null",
         @"partitionLimit": self.partitionLimit ?: @"null",
-        @"sharpYuv": self.sharpYuv ?: @"null"
+        @"sharpYuv": self.sharpYuv ?: @"null",
+        @"rateControl": WIKRateControlMultiPass == _rateControl ? @"multiPass" : @"predictive",
+        @"fileSizeTolerance": self.fileSizeTolerance ?: @"null",
+        @"animationMode": WIKAnimationModeInterFrame == _animationMode ? @"interFrame" : @"independentFrames",
+        @"minKeyFrameDistance": self.minKeyFrameDistance ?: @"null",
+        @"maxKeyFrameDistance": self.maxKeyFrameDistance ?: @"null",
+        @"allowMixed": self.allowMixed ?: @"null"
     };
     return [content description];
 }
@@ -268,6 +343,11 @@
     return self;
 }
 
+- (WIKEncoderConfigBuilder *)setMode:(const WIKEncoderMode)mode {
+    _config->_mode = mode;
+    return self;
+}
+
 - (WIKEncoderConfigBuilder *)setMethod:(const int)value {
     _config->_method = @(MAX(MIN(value, 6), 0));
     return self;
@@ -380,8 +460,35 @@
     return self;
 }
 
+- (WIKEncoderConfigBuilder *)setRateControl:(const WIKRateControl)rateControl {
+    _config->_rateControl = rateControl;
+    return self;
+}
+
+- (WIKEncoderConfigBuilder *)setFileSizeTolerance:(const float)tolerance {
+    _config->_fileSizeTolerance = @(MAX(MIN(tolerance, 0.9f), 0.01f));
+    return self;
+}
+
+- (WIKEncoderConfigBuilder *)setAnimationMode:(const WIKAnimationMode)mode {
+    _config->_animationMode = mode;
+    return self;
+}
+
+- (WIKEncoderConfigBuilder *)setKeyFrameDistanceMin:(const int)minDistance max:(const int)maxDistance {
+    _config->_maxKeyFrameDistance = @(MAX(maxDistance, 0));
+    _config->_minKeyFrameDistance = @(MAX(MIN(minDistance, MAX(maxDistance - 1, 0)), 0));
+    return self;
+}
+
+- (WIKEncoderConfigBuilder *)setAllowMixed:(const BOOL)value {
+    _config->_allowMixed = value ? @1 : @0;
+    return self;
+}
+
 - (WIKEncoderConfig *)construct {
-    return _config;
+    // The builder keeps changing its own instance, so each configuration is a snapshot.
+    return [_config copy];
 }
 
 @end
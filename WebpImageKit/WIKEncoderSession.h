@@ -0,0 +1,64 @@
+//
+//  WIKEncoderSession.h
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <UIKit/UIKit.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class WIKEncoderConfig;
+
+/**
+ * Encodes many still images with the same configuration. The configuration is validated once,
+ * the picture planes, the output buffer and the color conversion context are kept between
+ * encodes and reused while the image size and format stay the same.
+ * @warning Not thread-safe, use one session per thread.
+ */
+@interface WIKEncoderSession : NSObject
+
+@property (nonatomic, readonly) WIKEncoderConfig *config;
+
+/**
+ * Creates session.
+ *
+ * @param config
+ *        Encoder settings.
+ * @return New session or nil if the configuration is invalid.
+ */
+- (nullable instancetype)initWithConfig:(WIKEncoderConfig * const)config NS_DESIGNATED_INITIALIZER;
+
+/**
+ * Encodes the image, see `-[UIImage webpDataWithConfig:]`.
+ * @warning Animated images aren't supported, only the first frame is encoded.
+ *
+ * @param image
+ *        Image to encode.
+ * @return Encoded data or nil if an error occurs.
+ */
+- (nullable NSData *)encodeImage:(UIImage * const)image;
+
+/**
+ * Encodes the image, see `WebpDataCreateFromImage`.
+ *
+ * @param imageRef
+ *        Image to encode.
+ * @return Encoded data or nil if an error occurs.
+ */
+- (nullable NSData *)encodeCGImage:(CGImageRef)imageRef;
+
+/**
+ * Frees the memory kept between encodes.
+ */
+- (void)purge;
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,79 @@
+//
+//  WIKEncoderSession.m
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#import <libwebp/encode.h>
+
+#import "WIKEncoderSession.h"
+#import "CoreGraphics+WebP.h"
+#import "WIKEncoderConfig+Internal.h"
+#import "WebpMetrics.h"
+#import "WebpImageKitMacro.h"
+
+@implementation WIKEncoderSession {
+@private
+    WebPConfig _webpConfig;
+    WebPPicture _picture;
+    WebPMemoryWriter _writer;
+    CGContextRef _context;
+}
+
+- (nullable instancetype)initWithConfig:(WIKEncoderConfig * const)config {
+    if (!config) {
+        return nil;
+    }
+    if (self = [super init]) {
+        _config = [config copy];
+        if (![config setupWebpEncoderConfiguration:&_webpConfig] || !WebPPictureInit(&_picture)) {
+            return nil;
+        }
+        WebPMemoryWriterInit(&_writer);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [self purge];
+}
+
+- (nullable NSData *)encodeImage:(UIImage * const)image {
+    CGImageRef imageRef = image.images.firstObject.CGImage ?: image.CGImage;
+    return imageRef ? [self encodeCGImage:imageRef] : nil;
+}
+
+- (nullable NSData *)encodeCGImage:(CGImageRef)imageRef {
+    const size_t width = imageRef ? CGImageGetWidth(imageRef) : 0;
+    const size_t height = imageRef ? CGImageGetHeight(imageRef) : 0;
+    if (0 == width || 0 == height) {
+        return nil;
+    }
+    webpMetricsOperationBegin(WebpMetricsOperationEncode);
+    @webp_defer {
+        webpMetricsOperationEnd();
+    };
+    const __auto_type targetSize = webpEncoderTargetSize(CGSizeMake(width, height), _config);
+    if (!webpImportCGImageWithContext(imageRef, &_picture, targetSize, &_context)) {
+        return nil;
+    }
+    // The writer keeps its memory, so encodes of similar size don't grow it again.
+    _writer.size = 0;
+    if (!webpEncodePictureWithConfig(&_picture, &_webpConfig, _config, WebPMemoryWrite, &_writer)) {
+        return nil;
+    }
+    return [NSData dataWithBytes:_writer.mem length:_writer.size];
+}
+
+- (void)purge {
+    WebPPictureFree(&_picture);
+    WebPMemoryWriterClear(&_writer);
+    if (_context) {
+        CGContextRelease(_context);
+        _context = NULL;
+    }
+}
+
+@end
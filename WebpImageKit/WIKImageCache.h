@@ -0,0 +1,92 @@
+//
+//  WIKImageCache.h
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <UIKit/UIKit.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef struct {
+    NSUInteger hitCount;
+    NSUInteger missCount;           // requests which decoded the image
+    NSUInteger coalescedCount;      // requests which waited for the same image being decoded by another request
+    NSUInteger evictionCount;
+} WIKImageCacheStatistics;
+
+/**
+ * In-memory cache of decoded images. Images are keyed by a hash of the WebP data together with
+ * the requested size, scale and decode method, so the same data decoded at different sizes is
+ * cached separately. Entries are evicted in least recently used order once the decoded size of
+ * all images exceeds the memory budget. The cache is emptied on memory warnings.
+ * Concurrent requests for the same image are decoded once, the other requests wait for the result.
+ * Images downscaled by `WIKMemoryGovernor` are neither cached nor shared, the waiting requests
+ * decode the image again.
+ * All methods are thread-safe.
+ */
+@interface WIKImageCache : NSObject
+
+/**
+ * Shared cache with a 64 MB budget.
+ */
+@property (class, nonatomic, readonly) WIKImageCache *sharedCache;
+
+/**
+ * Maximum decoded size of cached images in bytes. Images larger than the budget are decoded,
+ * but not cached.
+ */
+@property (nonatomic) NSUInteger memoryBudget;
+
+/**
+ * Decoded size of cached images in bytes.
+ */
+@property (nonatomic, readonly) NSUInteger totalCost;
+@property (nonatomic, readonly) NSUInteger count;
+@property (nonatomic, readonly) WIKImageCacheStatistics statistics;
+
+/**
+ * Creates cache.
+ *
+ * @param memoryBudget
+ *        Maximum decoded size of cached images in bytes.
+ * @return New cache instance.
+ */
+- (instancetype)initWithMemoryBudget:(const NSUInteger)memoryBudget NS_DESIGNATED_INITIALIZER;
+
+/**
+ * Returns the cached image or decodes it with `+[UIImage webpImageWithData:displaySize:scaleFactor:]`.
+ *
+ * @param data
+ *        Image data in WebP format.
+ * @param size
+ *        Size of the result image in points.
+ * @param scaleFactor
+ *        The scale factor of the output image.
+ * @return Image or nil if decoding failed.
+ */
+- (nullable UIImage *)imageWithData:(NSData * const)data
+                        displaySize:(const CGSize)size
+                        scaleFactor:(const CGFloat)scaleFactor;
+
+/**
+ * Returns the cached image or decodes it with `WebpImageCreateFromDataWithSize`.
+ *
+ * @param data
+ *        Image data in WebP format.
+ * @param maxDisplaySize
+ *        Maximum size of the image in pixels. For '0' - uses the original image size.
+ * @return An image object, or NULL if decoding failed. You are responsible for releasing this object using CFRelease.
+ */
+- (nullable CGImageRef)copyImageWithData:(NSData * const)data
+                          maxDisplaySize:(const UInt32)maxDisplaySize CF_RETURNS_RETAINED;
+
+- (void)removeAllImages;
+- (void)resetStatistics;
+
+@end
+
+NS_ASSUME_NONNULL_END
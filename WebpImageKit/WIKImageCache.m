@@ -0,0 +1,367 @@
+//
+//  WIKImageCache.m
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#import <os/lock.h>
+
+#import "WIKImageCache.h"
+#import "CGImage+WebP.h"
+#import "UIImage+WebP.h"
+#import "UIImage+WebP+Internal.h"
+#import "WebpContainer.h"
+#import "WebpHash.h"
+#import "WebpImageKitMacro.h"
+
+typedef NS_ENUM(NSInteger, WIKImageCacheDecoder) {
+    WIKImageCacheDecoderUIImage = 0,
+    WIKImageCacheDecoderCGImage
+};
+
+NS_INLINE NSUInteger webpCGImageCost(CGImageRef image) {
+    return image ? CGImageGetBytesPerRow(image) * CGImageGetHeight(image) : 0;
+}
+
+@interface WIKImageCacheKey : NSObject <NSCopying> {
+@public
+    uint64_t _dataHash;
+    NSUInteger _length;
+    CGSize _size;
+    CGFloat _scale;
+    WIKImageCacheDecoder _decoder;
+}
+@end
+
+@implementation WIKImageCacheKey
+
+- (NSUInteger)hash {
+    return (NSUInteger) _dataHash;
+}
+
+- (BOOL)isEqual:(id)object {
+    if (![object isKindOfClass:[WIKImageCacheKey class]]) {
+        return NO;
+    }
+    WIKImageCacheKey *other = object;
+    return _dataHash == other->_dataHash
+            && _length == other->_length
+            && CGSizeEqualToSize(_size, other->_size)
+            && _scale == other->_scale
+            && _decoder == other->_decoder;
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    return self;
+}
+
+@end
+
+// Entries form a doubly linked list from the most to the least recently used one. The dictionary
+// owns the entries, so the links don't retain them.
+@interface WIKImageCacheEntry : NSObject {
+@public
+    WIKImageCacheKey *_key;
+    id _image;
+    NSUInteger _cost;
+    __unsafe_unretained WIKImageCacheEntry *_prev;
+    __unsafe_unretained WIKImageCacheEntry *_next;
+}
+@end
+
+@implementation WIKImageCacheEntry
+@end
+
+// A decode in progress, requests for the same key wait on the group.
+@interface WIKImageCacheRequest : NSObject {
+@public
+    dispatch_group_t _group;
+    id _result;
+    BOOL _isDownscaled;
+}
+@end
+
+@implementation WIKImageCacheRequest
+@end
+
+@implementation WIKImageCache {
+@private
+    os_unfair_lock _lock;
+    NSMutableDictionary<WIKImageCacheKey *, WIKImageCacheEntry *> *_entries;
+    NSMutableDictionary<WIKImageCacheKey *, WIKImageCacheRequest *> *_requests;
+    __unsafe_unretained WIKImageCacheEntry *_head;
+    __unsafe_unretained WIKImageCacheEntry *_tail;
+    NSUInteger _memoryBudget;
+    NSUInteger _totalCost;
+    WIKImageCacheStatistics _statistics;
+    id<NSObject> _memoryWarningObserver;
+}
+
++ (WIKImageCache *)sharedCache {
+    static dispatch_once_t onceToken;
+    static WIKImageCache *sharedCache;
+    dispatch_once(&onceToken, ^{
+        sharedCache = [[WIKImageCache alloc] initWithMemoryBudget:64 << 20];
+    });
+    return sharedCache;
+}
+
+- (instancetype)init {
+    return [self initWithMemoryBudget:64 << 20];
+}
+
+- (instancetype)initWithMemoryBudget:(const NSUInteger)memoryBudget {
+    if (self = [super init]) {
+        _lock = OS_UNFAIR_LOCK_INIT;
+        _entries = [NSMutableDictionary new];
+        _requests = [NSMutableDictionary new];
+        _memoryBudget = memoryBudget;
+        __weak __typeof(self) weakSelf = self;
+        _memoryWarningObserver = [NSNotificationCenter.defaultCenter addObserverForName:UIApplicationDidReceiveMemoryWarningNotification
+                                                                                 object:nil
+                                                                                  queue:nil
+                                                                             usingBlock:^(__unused NSNotification *notification) {
+            [weakSelf removeAllImages];
+        }];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [NSNotificationCenter.defaultCenter removeObserver:_memoryWarningObserver];
+}
+
+- (NSUInteger)memoryBudget {
+    os_unfair_lock_lock(&_lock);
+    const NSUInteger memoryBudget = _memoryBudget;
+    os_unfair_lock_unlock(&_lock);
+    return memoryBudget;
+}
+
+- (void)setMemoryBudget:(NSUInteger)memoryBudget {
+    os_unfair_lock_lock(&_lock);
+    _memoryBudget = memoryBudget;
+    [self trimToBudget];
+    os_unfair_lock_unlock(&_lock);
+}
+
+- (NSUInteger)totalCost {
+    os_unfair_lock_lock(&_lock);
+    const NSUInteger totalCost = _totalCost;
+    os_unfair_lock_unlock(&_lock);
+    return totalCost;
+}
+
+- (NSUInteger)count {
+    os_unfair_lock_lock(&_lock);
+    const NSUInteger count = _entries.count;
+    os_unfair_lock_unlock(&_lock);
+    return count;
+}
+
+- (WIKImageCacheStatistics)statistics {
+    os_unfair_lock_lock(&_lock);
+    const WIKImageCacheStatistics statistics = _statistics;
+    os_unfair_lock_unlock(&_lock);
+    return statistics;
+}
+
+- (nullable UIImage *)imageWithData:(NSData * const)data
+                        displaySize:(const CGSize)size
+                        scaleFactor:(const CGFloat)scaleFactor {
+    if (0 == data.length) {
+        return nil;
+    }
+    __auto_type key = [self keyWithData:data size:size scale:scaleFactor decoder:WIKImageCacheDecoderUIImage];
+    return [self objectForKey:key decode:^id {
+        return [UIImage webpImageWithData:data displaySize:size scaleFactor:scaleFactor];
+    } isDownscaled:^BOOL(UIImage *image) {
+        return [image webpIsDownscaledForScaleFactor:scaleFactor];
+    } cost:^NSUInteger(UIImage *image) {
+        if (0 == image.images.count) {
+            return webpCGImageCost(image.CGImage);
+        }
+        // Frames longer than the shortest one repeat in the images array, each bitmap is counted once.
+        NSUInteger cost = 0;
+        NSMutableSet *countedImages = [NSMutableSet setWithCapacity:image.images.count];
+        for (UIImage *frame in image.images) {
+            const __auto_type imageRef = frame.CGImage;
+            if (imageRef && ![countedImages containsObject:(__bridge id) imageRef]) {
+                [countedImages addObject:(__bridge id) imageRef];
+                cost += webpCGImageCost(imageRef);
+            }
+        }
+        return cost;
+    }];
+}
+
+- (nullable CGImageRef)copyImageWithData:(NSData * const)data
+                          maxDisplaySize:(const UInt32)maxDisplaySize CF_RETURNS_RETAINED {
+    if (0 == data.length) {
+        return NULL;
+    }
+    __auto_type key = [self keyWithData:data
+                                   size:CGSizeMake(maxDisplaySize, maxDisplaySize)
+                                  scale:1.0
+                                decoder:WIKImageCacheDecoderCGImage];
+    id image = [self objectForKey:key decode:^id {
+        return (__bridge_transfer id) WebpImageCreateFromDataWithSize((__bridge CFDataRef) data, maxDisplaySize);
+    } isDownscaled:^BOOL(id object) {
+        WebpContainerInfo info;
+        if (!webpContainerParse(data.bytes, data.length, &info)) {
+            return NO;
+        }
+        // The width WebpImageCreateFromDataWithSize decodes at unless the memory governor downscales it.
+        __auto_type expectedSize = CGSizeMake(info.canvasWidth, info.canvasHeight);
+        if (0 < maxDisplaySize && maxDisplaySize < MAX(expectedSize.width, expectedSize.height)) {
+            expectedSize = scaledImageSize(expectedSize, CGSizeMake(maxDisplaySize, maxDisplaySize), 1.0);
+        }
+        return CGImageGetWidth((__bridge CGImageRef) object) < (size_t) expectedSize.width;
+    } cost:^NSUInteger(id object) {
+        return webpCGImageCost((__bridge CGImageRef) object);
+    }];
+    return image ? CGImageRetain((__bridge CGImageRef) image) : NULL;
+}
+
+- (void)removeAllImages {
+    os_unfair_lock_lock(&_lock);
+    // Images are released outside of the lock, their deallocation may take a while.
+    NSArray *entries = _entries.allValues;
+    [_entries removeAllObjects];
+    _head = nil;
+    _tail = nil;
+    _totalCost = 0;
+    os_unfair_lock_unlock(&_lock);
+    entries = nil;
+}
+
+- (void)resetStatistics {
+    os_unfair_lock_lock(&_lock);
+    _statistics = (WIKImageCacheStatistics) {0};
+    os_unfair_lock_unlock(&_lock);
+}
+
+#pragma mark - Private
+
+- (WIKImageCacheKey *)keyWithData:(NSData * const)data
+                             size:(const CGSize)size
+                            scale:(const CGFloat)scale
+                          decoder:(const WIKImageCacheDecoder)decoder {
+    WIKImageCacheKey *key = [WIKImageCacheKey new];
+    key->_dataHash = webpHash64(data.bytes, data.length, 0);
+    key->_length = data.length;
+    key->_size = size;
+    key->_scale = scale;
+    key->_decoder = decoder;
+    return key;
+}
+
+// Images downscaled by the memory governor are neither cached nor shared with the coalesced
+// requests, those decode the image again and may get the full size.
+- (nullable id)objectForKey:(WIKImageCacheKey *)key
+                     decode:(id (^)(void))decode
+               isDownscaled:(BOOL (^)(id object))isDownscaled
+                       cost:(NSUInteger (^)(id object))cost {
+    os_unfair_lock_lock(&_lock);
+    WIKImageCacheEntry *entry = _entries[key];
+    if (entry) {
+        ++_statistics.hitCount;
+        [self moveToHead:entry];
+        id image = entry->_image;
+        os_unfair_lock_unlock(&_lock);
+        return image;
+    }
+    WIKImageCacheRequest *request = _requests[key];
+    if (request) {
+        ++_statistics.coalescedCount;
+        os_unfair_lock_unlock(&_lock);
+        dispatch_group_wait(request->_group, DISPATCH_TIME_FOREVER);
+        if (request->_isDownscaled) {
+            return [self objectForKey:key decode:decode isDownscaled:isDownscaled cost:cost];
+        }
+        return request->_result;
+    }
+    ++_statistics.missCount;
+    request = [WIKImageCacheRequest new];
+    request->_group = dispatch_group_create();
+    dispatch_group_enter(request->_group);
+    _requests[key] = request;
+    os_unfair_lock_unlock(&_lock);
+
+    id result = decode();
+    const BOOL isResultDownscaled = result && isDownscaled(result);
+    const NSUInteger resultCost = result ? cost(result) : 0;
+
+    os_unfair_lock_lock(&_lock);
+    request->_result = isResultDownscaled ? nil : result;
+    request->_isDownscaled = isResultDownscaled;
+    [_requests removeObjectForKey:key];
+    if (result && !isResultDownscaled && resultCost <= _memoryBudget) {
+        entry = [WIKImageCacheEntry new];
+        entry->_key = key;
+        entry->_image = result;
+        entry->_cost = resultCost;
+        _entries[key] = entry;
+        [self insertAtHead:entry];
+        _totalCost += resultCost;
+        [self trimToBudget];
+    }
+    os_unfair_lock_unlock(&_lock);
+    dispatch_group_leave(request->_group);
+    return result;
+}
+
+// Called under the lock.
+- (void)insertAtHead:(WIKImageCacheEntry *)entry {
+    entry->_prev = nil;
+    entry->_next = _head;
+    if (_head) {
+        _head->_prev = entry;
+    }
+    _head = entry;
+    if (!_tail) {
+        _tail = entry;
+    }
+}
+
+// Called under the lock.
+- (void)unlink:(WIKImageCacheEntry *)entry {
+    if (entry->_prev) {
+        entry->_prev->_next = entry->_next;
+    }
+    else {
+        _head = entry->_next;
+    }
+    if (entry->_next) {
+        entry->_next->_prev = entry->_prev;
+    }
+    else {
+        _tail = entry->_prev;
+    }
+    entry->_prev = nil;
+    entry->_next = nil;
+}
+
+// Called under the lock.
+- (void)moveToHead:(WIKImageCacheEntry *)entry {
+    if (_head == entry) {
+        return;
+    }
+    [self unlink:entry];
+    [self insertAtHead:entry];
+}
+
+// Called under the lock.
+- (void)trimToBudget {
+    while (_totalCost > _memoryBudget && _tail) {
+        WIKImageCacheEntry *entry = _tail;
+        [self unlink:entry];
+        _totalCost -= entry->_cost;
+        ++_statistics.evictionCount;
+        [_entries removeObjectForKey:entry->_key];
+    }
+}
+
+@end
@@ -0,0 +1,117 @@
+//
+//  WIKImageOperationQueue.h
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <UIKit/UIKit.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class WIKEncoderConfig;
+
+typedef NS_ENUM(NSInteger, WIKRequestPriority) {
+    WIKRequestPriorityLow = -1,     // prefetching, off-screen content
+    WIKRequestPriorityNormal = 0,
+    WIKRequestPriorityHigh = 1      // visible content
+};
+
+/**
+ * Handle of an asynchronous request.
+ */
+@interface WIKImageRequest : NSObject
+
+@property (nonatomic, readonly) WIKRequestPriority priority;
+@property (nonatomic, readonly, getter=isCancelled) BOOL cancelled;
+
+/**
+ * Cancels the request, its completion isn't called. The work stops at the next animation
+ * frame or data chunk, unless other requests are waiting for the same image.
+ */
+- (void)cancel;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+@end
+
+/**
+ * Runs decode and encode requests on a bounded number of workers. Requests with higher priority
+ * start first. Decode requests for the same data, size and scale are coalesced into one decode,
+ * which is cancelled only when all of its requests are cancelled. An image downscaled by
+ * `WIKMemoryGovernor` is delivered to one request only, the others are decoded again.
+ * All methods are thread-safe.
+ */
+@interface WIKImageOperationQueue : NSObject
+
+/**
+ * Shared queue running as many requests at once as there are active processor cores.
+ */
+@property (class, nonatomic, readonly) WIKImageOperationQueue *sharedQueue;
+
+@property (nonatomic, readonly) NSInteger maxConcurrentOperationCount;
+
+/**
+ * Creates queue.
+ *
+ * @param count
+ *        Maximum number of requests running at once. For '0' - the number of active processor cores.
+ * @return New queue instance.
+ */
+- (instancetype)initWithMaxConcurrentOperationCount:(const NSInteger)count NS_DESIGNATED_INITIALIZER;
+
+/**
+ * Decodes the image asynchronously, see `+[UIImage webpImageWithData:displaySize:scaleFactor:]`.
+ *
+ * @param data
+ *        Image data in WebP format.
+ * @param size
+ *        Size of the result image in points.
+ * @param scaleFactor
+ *        The scale factor of the output image.
+ * @param priority
+ *        Request priority.
+ * @param completionQueue
+ *        Queue to call the completion on, the main queue if nil.
+ * @param completion
+ *        Called with the decoded image, or with nil if decoding failed. Not called for cancelled requests.
+ * @return Request handle.
+ */
+- (WIKImageRequest *)decodeImageWithData:(NSData * const)data
+                             displaySize:(const CGSize)size
+                             scaleFactor:(const CGFloat)scaleFactor
+                                priority:(const WIKRequestPriority)priority
+                         completionQueue:(nullable dispatch_queue_t)completionQueue
+                              completion:(void (^)(UIImage * _Nullable image))completion;
+
+/**
+ * Encodes the image asynchronously, see `-[UIImage webpDataWithConfig:]`.
+ *
+ * @param image
+ *        Image to encode.
+ * @param config
+ *        Encoder settings.
+ * @param priority
+ *        Request priority.
+ * @param completionQueue
+ *        Queue to call the completion on, the main queue if nil.
+ * @param completion
+ *        Called with the encoded data, or with nil if encoding failed. Not called for cancelled requests.
+ * @return Request handle.
+ */
+- (WIKImageRequest *)encodeImage:(UIImage * const)image
+                          config:(WIKEncoderConfig * const)config
+                        priority:(const WIKRequestPriority)priority
+                 completionQueue:(nullable dispatch_queue_t)completionQueue
+                      completion:(void (^)(NSData * _Nullable data))completion;
+
+/**
+ * Cancels all requests.
+ */
+- (void)cancelAllRequests;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,380 @@
+//
+//  WIKImageOperationQueue.m
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#import <os/lock.h>
+
+#import "WIKImageOperationQueue.h"
+#import "UIImage+WebP.h"
+#import "UIImage+WebP+Internal.h"
+#import "WebpHash.h"
+#import "WebpImageKitMacro.h"
+
+@class WIKImageOperation;
+
+NS_INLINE NSOperationQueuePriority webpQueuePriority(WIKRequestPriority priority) {
+    switch (priority) {
+        case WIKRequestPriorityLow:
+            return NSOperationQueuePriorityLow;
+        case WIKRequestPriorityHigh:
+            return NSOperationQueuePriorityHigh;
+        default:
+            return NSOperationQueuePriorityNormal;
+    }
+}
+
+NS_INLINE NSQualityOfService webpQualityOfService(WIKRequestPriority priority) {
+    switch (priority) {
+        case WIKRequestPriorityLow:
+            return NSQualityOfServiceUtility;
+        case WIKRequestPriorityHigh:
+            return NSQualityOfServiceUserInitiated;
+        default:
+            return NSQualityOfServiceDefault;
+    }
+}
+
+@interface WIKImageRequest () {
+@public
+    dispatch_queue_t _completionQueue;
+    void (^_completion)(id _Nullable result);
+    __weak WIKImageOperation *_operation;
+}
+
+- (instancetype)initWithPriority:(WIKRequestPriority)priority
+                 completionQueue:(nullable dispatch_queue_t)completionQueue
+                      completion:(void (^)(id _Nullable result))completion;
+
+@end
+
+// Runs the work once for all attached requests, and is cancelled when all of them are cancelled.
+@interface WIKImageOperation : NSOperation
+
+@property (nonatomic, readonly, nullable) id coalescingKey;
+
+- (instancetype)initWithKey:(nullable id)coalescingKey work:(id _Nullable (^)(BOOL (^isCancelled)(void)))work;
+
+// A result rejected by `isShared` goes to the first request only, the other requests are handed
+// to `reschedule` to get results of their own.
+@property (nonatomic, copy, nullable) BOOL (^isShared)(id result);
+@property (nonatomic, copy, nullable) void (^reschedule)(NSArray<WIKImageRequest *> *requests);
+
+// Returns NO once the results are being delivered or the operation is cancelled, the request
+// needs a new operation then.
+- (BOOL)attachRequest:(WIKImageRequest *)request;
+- (void)requestDidCancel;
+
+@end
+
+@implementation WIKImageRequest {
+    os_unfair_lock _lock;
+}
+
+- (instancetype)initWithPriority:(WIKRequestPriority)priority
+                 completionQueue:(nullable dispatch_queue_t)completionQueue
+                      completion:(void (^)(id _Nullable result))completion {
+    if (self = [super init]) {
+        _lock = OS_UNFAIR_LOCK_INIT;
+        _priority = priority;
+        _completionQueue = completionQueue ?: dispatch_get_main_queue();
+        _completion = [completion copy];
+    }
+    return self;
+}
+
+- (BOOL)isCancelled {
+    os_unfair_lock_lock(&_lock);
+    const BOOL cancelled = _cancelled;
+    os_unfair_lock_unlock(&_lock);
+    return cancelled;
+}
+
+- (void)cancel {
+    os_unfair_lock_lock(&_lock);
+    const BOOL wasCancelled = _cancelled;
+    _cancelled = YES;
+    os_unfair_lock_unlock(&_lock);
+    if (!wasCancelled) {
+        [_operation requestDidCancel];
+    }
+}
+
+@end
+
+@implementation WIKImageOperation {
+    os_unfair_lock _lock;
+    NSMutableArray<WIKImageRequest *> *_requests;
+    BOOL _isDelivering;
+    BOOL _isCancelling;
+    id _Nullable (^_work)(BOOL (^isCancelled)(void));
+}
+
+- (instancetype)initWithKey:(nullable id)coalescingKey work:(id _Nullable (^)(BOOL (^isCancelled)(void)))work {
+    if (self = [super init]) {
+        _lock = OS_UNFAIR_LOCK_INIT;
+        _coalescingKey = coalescingKey;
+        _requests = [NSMutableArray new];
+        _work = [work copy];
+    }
+    return self;
+}
+
+- (BOOL)attachRequest:(WIKImageRequest *)request {
+    os_unfair_lock_lock(&_lock);
+    const BOOL isAttached = !_isDelivering && !_isCancelling && !self.isCancelled;
+    if (isAttached) {
+        [_requests addObject:request];
+        request->_operation = self;
+    }
+    os_unfair_lock_unlock(&_lock);
+    if (isAttached && self.queuePriority < webpQueuePriority(request.priority)) {
+        // The operation runs as soon as the most urgent of its requests needs it.
+        self.queuePriority = webpQueuePriority(request.priority);
+        self.qualityOfService = webpQualityOfService(request.priority);
+    }
+    return isAttached;
+}
+
+- (void)requestDidCancel {
+    os_unfair_lock_lock(&_lock);
+    BOOL isAllCancelled = !_isDelivering && !_isCancelling;
+    for (WIKImageRequest *request in _requests) {
+        isAllCancelled = isAllCancelled && request.isCancelled;
+    }
+    // Decided under the lock which attaches requests, so no request joins the operation
+    // between the decision and the cancellation. The flag is never reset.
+    if (isAllCancelled) {
+        _isCancelling = YES;
+    }
+    os_unfair_lock_unlock(&_lock);
+    if (isAllCancelled) {
+        [self cancel];
+    }
+}
+
+- (void)main {
+    id result = nil;
+    if (!self.isCancelled) {
+        __weak __typeof(self) weakSelf = self;
+        result = _work(^BOOL {
+            return weakSelf.isCancelled;
+        });
+    }
+    os_unfair_lock_lock(&_lock);
+    _isDelivering = YES;
+    NSArray<WIKImageRequest *> *requests = [_requests copy];
+    os_unfair_lock_unlock(&_lock);
+    const BOOL isShared = !result || !_isShared || _isShared(result);
+    NSMutableArray<WIKImageRequest *> *rescheduledRequests = [NSMutableArray array];
+    BOOL isDelivered = NO;
+    for (WIKImageRequest *request in requests) {
+        if (request.isCancelled) {
+            continue;
+        }
+        if (isDelivered && !isShared) {
+            [rescheduledRequests addObject:request];
+            continue;
+        }
+        isDelivered = YES;
+        dispatch_async(request->_completionQueue, ^{
+            if (!request.isCancelled) {
+                request->_completion(result);
+            }
+        });
+    }
+    if (0 < rescheduledRequests.count && _reschedule) {
+        _reschedule(rescheduledRequests);
+    }
+}
+
+@end
+
+@interface WIKImageDecodeKey : NSObject <NSCopying> {
+@public
+    uint64_t _dataHash;
+    NSUInteger _length;
+    CGSize _size;
+    CGFloat _scale;
+}
+@end
+
+@implementation WIKImageDecodeKey
+
+- (NSUInteger)hash {
+    return (NSUInteger) _dataHash;
+}
+
+- (BOOL)isEqual:(id)object {
+    if (![object isKindOfClass:[WIKImageDecodeKey class]]) {
+        return NO;
+    }
+    WIKImageDecodeKey *other = object;
+    return _dataHash == other->_dataHash
+            && _length == other->_length
+            && CGSizeEqualToSize(_size, other->_size)
+            && _scale == other->_scale;
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    return self;
+}
+
+@end
+
+@implementation WIKImageOperationQueue {
+@private
+    os_unfair_lock _lock;
+    NSOperationQueue *_queue;
+    NSMutableDictionary<WIKImageDecodeKey *, WIKImageOperation *> *_decodeOperations;
+    NSHashTable<WIKImageRequest *> *_requests;
+}
+
++ (WIKImageOperationQueue *)sharedQueue {
+    static dispatch_once_t onceToken;
+    static WIKImageOperationQueue *sharedQueue;
+    dispatch_once(&onceToken, ^{
+        sharedQueue = [[WIKImageOperationQueue alloc] initWithMaxConcurrentOperationCount:0];
+    });
+    return sharedQueue;
+}
+
+- (instancetype)init {
+    return [self initWithMaxConcurrentOperationCount:0];
+}
+
+- (instancetype)initWithMaxConcurrentOperationCount:(const NSInteger)count {
+    if (self = [super init]) {
+        _lock = OS_UNFAIR_LOCK_INIT;
+        _maxConcurrentOperationCount = 0 < count ? count : (NSInteger) webpConcurrencyLimit();
+        _queue = [NSOperationQueue new];
+        _queue.name = @"WebpImageKit.WIKImageOperationQueue";
+        _queue.maxConcurrentOperationCount = _maxConcurrentOperationCount;
+        _decodeOperations = [NSMutableDictionary new];
+        _requests = [NSHashTable weakObjectsHashTable];
+    }
+    return self;
+}
+
+- (WIKImageRequest *)decodeImageWithData:(NSData * const)data
+                             displaySize:(const CGSize)size
+                             scaleFactor:(const CGFloat)scaleFactor
+                                priority:(const WIKRequestPriority)priority
+                         completionQueue:(nullable dispatch_queue_t)completionQueue
+                              completion:(void (^)(UIImage * _Nullable image))completion {
+    __auto_type request = [[WIKImageRequest alloc] initWithPriority:priority
+                                                    completionQueue:completionQueue
+                                                         completion:completion];
+    WIKImageDecodeKey *key = [WIKImageDecodeKey new];
+    key->_dataHash = webpHash64(data.bytes, data.length, 0);
+    key->_length = data.length;
+    key->_size = size;
+    key->_scale = scaleFactor;
+
+    os_unfair_lock_lock(&_lock);
+    [_requests addObject:request];
+    os_unfair_lock_unlock(&_lock);
+    [self scheduleDecodeRequest:request key:key data:data displaySize:size scaleFactor:scaleFactor];
+    return request;
+}
+
+- (WIKImageRequest *)encodeImage:(UIImage * const)image
+                          config:(WIKEncoderConfig * const)config
+                        priority:(const WIKRequestPriority)priority
+                 completionQueue:(nullable dispatch_queue_t)completionQueue
+                      completion:(void (^)(NSData * _Nullable data))completion {
+    __auto_type request = [[WIKImageRequest alloc] initWithPriority:priority
+                                                    completionQueue:completionQueue
+                                                         completion:completion];
+    __auto_type operation = [[WIKImageOperation alloc] initWithKey:nil work:^id(BOOL (^isCancelled)(void)) {
+        return isCancelled() ? nil : [image webpDataWithConfig:config];
+    }];
+    [operation attachRequest:request];
+    os_unfair_lock_lock(&_lock);
+    [_requests addObject:request];
+    os_unfair_lock_unlock(&_lock);
+    [self enqueueOperation:operation];
+    return request;
+}
+
+- (void)cancelAllRequests {
+    // Cancelling the requests cancels their operations, and also stops completions which are
+    // already dispatched.
+    os_unfair_lock_lock(&_lock);
+    NSArray<WIKImageRequest *> *requests = _requests.allObjects;
+    [_requests removeAllObjects];
+    os_unfair_lock_unlock(&_lock);
+    for (WIKImageRequest *request in requests) {
+        [request cancel];
+    }
+}
+
+#pragma mark - Private
+
+- (void)scheduleDecodeRequest:(WIKImageRequest *)request
+                          key:(WIKImageDecodeKey *)key
+                         data:(NSData * const)data
+                  displaySize:(const CGSize)size
+                  scaleFactor:(const CGFloat)scaleFactor {
+    os_unfair_lock_lock(&_lock);
+    WIKImageOperation *operation = _decodeOperations[key];
+    const BOOL isCoalesced = operation && [operation attachRequest:request];
+    if (!isCoalesced) {
+        operation = [[WIKImageOperation alloc] initWithKey:key work:^id(BOOL (^isCancelled)(void)) {
+            return [UIImage webpImageWithData:data
+                                  displaySize:size
+                                  scaleFactor:scaleFactor
+                                    loopCount:nil
+                                  isCancelled:isCancelled];
+        }];
+        // Images downscaled by the memory governor aren't shared, the coalesced requests decode
+        // again and may get the full size once memory is released.
+        operation.isShared = ^BOOL(UIImage *image) {
+            return ![image webpIsDownscaledForScaleFactor:scaleFactor];
+        };
+        __weak __typeof(self) weakSelf = self;
+        operation.reschedule = ^(NSArray<WIKImageRequest *> *requests) {
+            for (WIKImageRequest *rescheduledRequest in requests) {
+                if (rescheduledRequest.isCancelled) {
+                    continue;
+                }
+                [weakSelf scheduleDecodeRequest:rescheduledRequest
+                                            key:key
+                                           data:data
+                                    displaySize:size
+                                    scaleFactor:scaleFactor];
+            }
+        };
+        [operation attachRequest:request];
+        _decodeOperations[key] = operation;
+    }
+    os_unfair_lock_unlock(&_lock);
+    if (!isCoalesced) {
+        [self enqueueOperation:operation];
+    }
+}
+
+- (void)enqueueOperation:(WIKImageOperation *)operation {
+    __weak __typeof(self) weakSelf = self;
+    __weak WIKImageOperation *weakOperation = operation;
+    operation.completionBlock = ^{
+        [weakSelf operationDidFinish:weakOperation];
+    };
+    [_queue addOperation:operation];
+}
+
+- (void)operationDidFinish:(nullable WIKImageOperation *)operation {
+    if (!operation.coalescingKey) {
+        return;
+    }
+    os_unfair_lock_lock(&_lock);
+    if (_decodeOperations[operation.coalescingKey] == operation) {
+        [_decodeOperations removeObjectForKey:operation.coalescingKey];
+    }
+    os_unfair_lock_unlock(&_lock);
+}
+
+@end
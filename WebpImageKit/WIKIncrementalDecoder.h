@@ -0,0 +1,79 @@
+//
+//  WIKIncrementalDecoder.h
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_ENUM(NSInteger, WIKIncrementalDecoderStatus) {
+    WIKIncrementalDecoderStatusNeedMoreData = 0,  // all received data is decoded, waiting for more bytes
+    WIKIncrementalDecoderStatusComplete,          // the image is fully decoded
+    WIKIncrementalDecoderStatusUnsupported,       // the header is parsed, but the image is animated
+    WIKIncrementalDecoderStatusFailed             // the data is not a valid WebP image
+};
+
+/**
+ * Decodes a static WebP image while its data is still being received. Image features are
+ * available as soon as the header is parsed and the partially decoded image can be requested
+ * at any time. Animated images are detected but not decoded, use `WIKAnimatedImage` once all
+ * data is received.
+ * @warning Not thread-safe, callers are responsible for serializing access.
+ */
+@interface WIKIncrementalDecoder : NSObject
+
+@property (nonatomic, readonly) WIKIncrementalDecoderStatus status;
+
+/**
+ * YES when the image header is parsed and the properties below are valid.
+ */
+@property (nonatomic, readonly) BOOL isHeaderParsed;
+@property (nonatomic, readonly) CGSize canvasSize;
+@property (nonatomic, readonly) BOOL hasAlpha;
+@property (nonatomic, readonly) BOOL isAnimated;
+@property (nonatomic, readonly) BOOL isLossless;
+
+/**
+ * Size of the decoded image in pixels. It is smaller than requested if `WIKMemoryGovernor` downscales the decode.
+ */
+@property (nonatomic, readonly) CGSize outputSize;
+
+/**
+ * The number of fully decoded rows of the output image.
+ */
+@property (nonatomic, readonly) NSUInteger decodedRowCount;
+
+/**
+ * Creates decoder. The resulting image size is limited to the `maxPixelSize` value.
+ *
+ * @param maxPixelSize
+ *        Maximum size of the image in pixels. For '0' - uses the original image size.
+ * @return New decoder instance.
+ */
+- (instancetype)initWithMaxPixelSize:(const UInt32)maxPixelSize NS_DESIGNATED_INITIALIZER;
+
+/**
+ * Appends received bytes and decodes as much of the image as possible.
+ *
+ * @param data
+ *        Next chunk of the image data.
+ * @return Decoder status after the data is consumed.
+ */
+- (WIKIncrementalDecoderStatus)appendData:(NSData * const)data;
+
+/**
+ * Returns an image with all rows decoded so far. Rows which are not decoded yet are transparent
+ * for images with alpha and black for opaque ones.
+ *
+ * @return An image object, or NULL if no rows are decoded yet. You are responsible for releasing this object using CFRelease.
+ */
+- (nullable CGImageRef)copyImage CF_RETURNS_RETAINED;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,195 @@
+//
+//  WIKIncrementalDecoder.m
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#import <libwebp/decode.h>
+#import <libwebp/demux.h>
+
+#import "WIKIncrementalDecoder.h"
+#import "CoreGraphics+WebP.h"
+#import "WebpBufferPool.h"
+#import "WebpMemoryBudget.h"
+#import "WebpMetrics.h"
+#import "WebpImageKitMacro.h"
+
+@implementation WIKIncrementalDecoder {
+@private
+    UInt32 _maxPixelSize;
+    NSMutableData *_headerData;
+    WebPDecoderConfig _config;
+    WebPIDecoder *_idec;
+    uint8_t *_pixels;
+    size_t _capacity;
+    size_t _stride;
+    CGColorSpaceRef _colorSpace;
+    CGImageRef _image;
+    size_t _reservedMemory;
+}
+
+- (instancetype)init {
+    return [self initWithMaxPixelSize:0];
+}
+
+- (instancetype)initWithMaxPixelSize:(const UInt32)maxPixelSize {
+    if (self = [super init]) {
+        _maxPixelSize = maxPixelSize;
+        _headerData = [NSMutableData new];
+        _status = WebPInitDecoderConfig(&_config)
+                ? WIKIncrementalDecoderStatusNeedMoreData
+                : WIKIncrementalDecoderStatusFailed;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (_idec) {
+        WebPIDelete(_idec);
+    }
+    webpBufferPoolRelease(_pixels, _capacity);
+    webpMemoryBudgetRelease(_reservedMemory);
+    if (_image) {
+        CGImageRelease(_image);
+    }
+    if (_colorSpace) {
+        CGColorSpaceRelease(_colorSpace);
+    }
+}
+
+- (WIKIncrementalDecoderStatus)appendData:(NSData * const)data {
+    if (WIKIncrementalDecoderStatusNeedMoreData != _status || 0 == data.length) {
+        return _status;
+    }
+    webpMetricsOperationBegin(WebpMetricsOperationDecode);
+    @webp_defer {
+        webpMetricsOperationEnd();
+    };
+    NSData *chunk = data;
+    if (!_isHeaderParsed) {
+        // Bytes are buffered until the header is complete, the decoder needs the output size upfront.
+        [_headerData appendData:data];
+        const __auto_type code = WebPGetFeatures(_headerData.bytes, _headerData.length, &_config.input);
+        if (VP8_STATUS_NOT_ENOUGH_DATA == code) {
+            return _status;
+        }
+        if (VP8_STATUS_OK != code) {
+            return (_status = WIKIncrementalDecoderStatusFailed);
+        }
+        [self parseHeader];
+        if (_isAnimated) {
+            _headerData = nil;
+            return (_status = WIKIncrementalDecoderStatusUnsupported);
+        }
+        if (![self startDecoding]) {
+            return (_status = WIKIncrementalDecoderStatusFailed);
+        }
+        chunk = _headerData;
+        _headerData = nil;
+    }
+    const __auto_type decodedRowCount = _decodedRowCount;
+    const uint64_t metricsStart = webpMetricsStageBegin();
+    switch (WebPIAppend(_idec, chunk.bytes, chunk.length)) {
+        case VP8_STATUS_OK:
+            _status = WIKIncrementalDecoderStatusComplete;
+            break;
+        case VP8_STATUS_SUSPENDED:
+            _status = WIKIncrementalDecoderStatusNeedMoreData;
+            break;
+        default:
+            _status = WIKIncrementalDecoderStatusFailed;
+            break;
+    }
+    int lastRow = 0;
+    if (WebPIDecGetRGB(_idec, &lastRow, NULL, NULL, NULL)) {
+        _decodedRowCount = (NSUInteger) MAX(lastRow, 0);
+    }
+    webpMetricsStageEnd(WebpMetricsStageDecode, metricsStart,
+                        (size_t) (MAX(_decodedRowCount, decodedRowCount) - decodedRowCount) * _stride);
+    if (WIKIncrementalDecoderStatusNeedMoreData != _status) {
+        WebPIDelete(_idec);
+        _idec = NULL;
+        webpMemoryBudgetRelease(_reservedMemory);
+        _reservedMemory = 0;
+    }
+    return _status;
+}
+
+- (nullable CGImageRef)copyImage CF_RETURNS_RETAINED {
+    if (_image) {
+        return CGImageRetain(_image);
+    }
+    if (!_pixels || 0 == _decodedRowCount) {
+        return NULL;
+    }
+    const __auto_type width = (size_t) _outputSize.width;
+    const __auto_type height = (size_t) _outputSize.height;
+    if (WIKIncrementalDecoderStatusComplete != _status) {
+        return webpCreateCGImageFromBuffer(_pixels, width, height, _stride, _hasAlpha, _colorSpace);
+    }
+    // The decoder is done with the buffer, so the final image takes it over without copying.
+    _image = webpCreateCGImageWithPooledBuffer(_pixels, _capacity, width, height, _stride, _hasAlpha, _colorSpace);
+    _pixels = NULL;
+    return _image ? CGImageRetain(_image) : NULL;
+}
+
+#pragma mark - Private
+
+- (void)parseHeader {
+    _isHeaderParsed = YES;
+    _canvasSize = CGSizeMake(_config.input.width, _config.input.height);
+    _hasAlpha = 0 != _config.input.has_alpha;
+    _isAnimated = 0 != _config.input.has_animation;
+    _isLossless = 2 == _config.input.format;
+    _outputSize = _canvasSize;
+    if (0 < _maxPixelSize && _maxPixelSize < MAX(_canvasSize.width, _canvasSize.height)) {
+        _outputSize = scaledImageSize(_canvasSize, CGSizeMake(_maxPixelSize, _maxPixelSize), 1.0);
+    }
+    // The ICC profile chunk precedes the image data, so it is complete once the features are known.
+    WebPData webpData = { .bytes = _headerData.bytes, .size = _headerData.length };
+    WebPDemuxState state;
+    WebPDemuxer *demuxer;
+    if ((demuxer = WebPDemuxPartial(&webpData, &state))) {
+        _colorSpace = webpCreateColorSpace(demuxer);
+        WebPDemuxDelete(demuxer);
+    }
+    else {
+        _colorSpace = webpCreateDeviceRgbColorSpace();
+    }
+}
+
+- (BOOL)startDecoding {
+    if (0 == (size_t) _outputSize.width || 0 == (size_t) _outputSize.height) {
+        return NO;
+    }
+    // The buffer is reserved while the data is being received, the output shrinks if the budget is short.
+    _outputSize = webpReserveImageMemory(_outputSize, 1, YES, &_reservedMemory);
+    const __auto_type width = (size_t) _outputSize.width;
+    const __auto_type height = (size_t) _outputSize.height;
+    if (0 == _reservedMemory) {
+        return NO;
+    }
+    _stride = webpByteAlign(width * 4, 64);
+    if (!(_pixels = webpAcquirePooledBuffer(_stride * height, &_capacity))) {
+        return NO;
+    }
+    // Rows which aren't decoded yet stay zeroed: transparent with alpha, black for opaque images.
+    memset(_pixels, 0, _stride * height);
+    if (!CGSizeEqualToSize(_canvasSize, _outputSize)) {
+        _config.options.use_scaling = 1;
+        _config.options.scaled_width = (int) width;
+        _config.options.scaled_height = (int) height;
+    }
+    _config.options.use_threads = 1;
+    _config.output.colorspace = MODE_bgrA;
+    _config.output.is_external_memory = 1;
+    _config.output.u.RGBA.rgba = _pixels;
+    _config.output.u.RGBA.stride = (int) _stride;
+    _config.output.u.RGBA.size = _stride * height;
+    // The decoder keeps a pointer to the options, they live in the instance as long as the decoder.
+    return NULL != (_idec = WebPIDecode(NULL, 0, &_config));
+}
+
+@end
@@ -0,0 +1,68 @@
+//
+//  WIKMemoryGovernor.h
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_ENUM(NSInteger, WIKMemoryPolicy) {
+    WIKMemoryPolicyDownscale = 0,   // decode at a lower resolution, down to a quarter of each dimension, then wait
+    WIKMemoryPolicyWait,            // wait until other decodes release their memory
+    WIKMemoryPolicyFail             // fail the decode right away
+};
+
+typedef struct {
+    NSUInteger usedMemory;          // bytes reserved by decodes in flight and by animation canvases
+    NSUInteger peakMemory;
+    NSUInteger downscaledCount;     // decodes which got a lower resolution than requested
+    NSUInteger waitCount;           // decodes which waited for memory
+    NSUInteger failedCount;         // decodes which failed because the budget was exhausted
+} WIKMemoryStatistics;
+
+/**
+ * Process wide budget of pixel memory used by decodes in flight. Every decode reserves the
+ * memory of its output, canvas and frame buffers before allocating them, animations decoded into
+ * `UIImage` reserve the memory of all their frames. A decode which doesn't fit into the budget is
+ * handled according to the policy. Downscaled images keep their size in points, their scale factor
+ * is lowered instead. Canvases of `WIKAnimatedImage` are accounted, but never wait or fail.
+ * All methods are thread-safe.
+ */
+@interface WIKMemoryGovernor : NSObject
+
+@property (class, nonatomic, readonly) WIKMemoryGovernor *sharedGovernor;
+
+/**
+ * Maximum number of bytes reserved at once, 256 MB by default. For '0' - memory isn't limited.
+ * A single decode larger than the budget runs once no other decode is in flight.
+ */
+@property (nonatomic) NSUInteger memoryBudget;
+
+/**
+ * What happens to a decode which doesn't fit into the budget, WIKMemoryPolicyDownscale by default.
+ */
+@property (nonatomic) WIKMemoryPolicy policy;
+
+/**
+ * How long decodes wait for memory before they fail, in seconds. 10 seconds by default.
+ */
+@property (nonatomic) NSTimeInterval waitTimeout;
+
+@property (nonatomic, readonly) NSUInteger usedMemory;
+@property (nonatomic, readonly) WIKMemoryStatistics statistics;
+
+/**
+ * Resets the peak memory to the current usage and clears the counters.
+ */
+- (void)resetStatistics;
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@end
+
+NS_ASSUME_NONNULL_END
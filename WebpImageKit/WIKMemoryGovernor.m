@@ -0,0 +1,92 @@
+//
+//  WIKMemoryGovernor.m
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#import "WIKMemoryGovernor.h"
+#import "WebpMemoryBudget.h"
+
+@implementation WIKMemoryGovernor
+
++ (WIKMemoryGovernor *)sharedGovernor {
+    static dispatch_once_t onceToken;
+    static WIKMemoryGovernor *sharedGovernor;
+    dispatch_once(&onceToken, ^{
+        sharedGovernor = [[WIKMemoryGovernor alloc] initShared];
+    });
+    return sharedGovernor;
+}
+
+- (instancetype)initShared {
+    return [super init];
+}
+
+- (NSUInteger)memoryBudget {
+    WebpMemoryBudgetStats stats;
+    webpMemoryBudgetGetStats(&stats);
+    return stats.limit;
+}
+
+- (void)setMemoryBudget:(NSUInteger)memoryBudget {
+    webpMemoryBudgetSetLimit(memoryBudget);
+}
+
+- (WIKMemoryPolicy)policy {
+    switch (webpMemoryBudgetGetPolicy()) {
+        case WebpMemoryPolicyWait:
+            return WIKMemoryPolicyWait;
+        case WebpMemoryPolicyFail:
+            return WIKMemoryPolicyFail;
+        default:
+            return WIKMemoryPolicyDownscale;
+    }
+}
+
+- (void)setPolicy:(WIKMemoryPolicy)policy {
+    switch (policy) {
+        case WIKMemoryPolicyWait:
+            webpMemoryBudgetSetPolicy(WebpMemoryPolicyWait);
+            break;
+        case WIKMemoryPolicyFail:
+            webpMemoryBudgetSetPolicy(WebpMemoryPolicyFail);
+            break;
+        default:
+            webpMemoryBudgetSetPolicy(WebpMemoryPolicyDownscale);
+            break;
+    }
+}
+
+- (NSTimeInterval)waitTimeout {
+    return webpMemoryBudgetGetWaitTimeout();
+}
+
+- (void)setWaitTimeout:(NSTimeInterval)waitTimeout {
+    webpMemoryBudgetSetWaitTimeout(waitTimeout);
+}
+
+- (NSUInteger)usedMemory {
+    WebpMemoryBudgetStats stats;
+    webpMemoryBudgetGetStats(&stats);
+    return stats.used;
+}
+
+- (WIKMemoryStatistics)statistics {
+    WebpMemoryBudgetStats stats;
+    webpMemoryBudgetGetStats(&stats);
+    return (WIKMemoryStatistics) {
+            .usedMemory = stats.used,
+            .peakMemory = stats.peak,
+            .downscaledCount = (NSUInteger) stats.downscaledCount,
+            .waitCount = (NSUInteger) stats.waitCount,
+            .failedCount = (NSUInteger) stats.failedCount
+    };
+}
+
+- (void)resetStatistics {
+    webpMemoryBudgetResetStats();
+}
+
+@end
@@ -0,0 +1,76 @@
+//
+//  WIKMetrics.h
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_ENUM(NSInteger, WIKMetricsStage) {
+    WIKMetricsStageDemux = 0,       // container parsing
+    WIKMetricsStageDecode,          // bitstream decode
+    WIKMetricsStageColorSpace,      // color space creation from the ICC profile
+    WIKMetricsStageComposite,       // animation frames blending
+    WIKMetricsStageRescale,         // image rescaling
+    WIKMetricsStageImport,          // pixel conversion into the encoder picture
+    WIKMetricsStageEncode,          // bitstream encode
+    WIKMetricsStageMux              // container assembly
+};
+
+typedef NS_ENUM(NSInteger, WIKMetricsOperation) {
+    WIKMetricsOperationNone = 0,    // a stage which ran outside of an operation, like a frame decoded ahead by a worker
+    WIKMetricsOperationDecode,
+    WIKMetricsOperationEncode,
+    WIKMetricsOperationTransmux     // container edits of `CFData+WebP.h`
+};
+
+/**
+ * Timing of a single decode, encode or container edit. Stages nested into other stages, like the
+ * decode of an animation frame, are included into both.
+ */
+@interface WIKOperationMetrics : NSObject
+
+@property (nonatomic, readonly) WIKMetricsOperation operation;
+@property (nonatomic, readonly) NSTimeInterval duration;
+
+/**
+ * Peak size of pixel buffers and encoder pictures held by the operation on its thread, in bytes.
+ */
+@property (nonatomic, readonly) NSUInteger peakMemory;
+
+- (NSTimeInterval)durationOfStage:(const WIKMetricsStage)stage;
+
+/**
+ * Bytes produced by the stage: decoded pixels, encoded or assembled data.
+ */
+- (NSUInteger)bytesOfStage:(const WIKMetricsStage)stage;
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@end
+
+typedef void (^WIKMetricsHandler)(WIKOperationMetrics *metrics);
+
+/**
+ * Per-stage instrumentation of decode and encode pipelines. Metrics are collected only while the
+ * handler is set, otherwise instrumentation costs one atomic load per stage.
+ */
+@interface WIKMetrics : NSObject
+
+/**
+ * Called when an operation ends, on the thread which ran it. The handler must be thread-safe
+ * and must not change the handler itself.
+ */
+@property (class, nonatomic, copy, nullable) WIKMetricsHandler handler;
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,108 @@
+//
+//  WIKMetrics.m
+//  WebpImageKit
+//
+//  Created by Oleg Komaristov on 2026-10-17.
+//  Copyright © 2026 Oleg Komaristov. All rights reserved.
+//
+
+#import <os/lock.h>
+
+#import "WIKMetrics.h"
+#import "WebpMetrics.h"
+
+@implementation WIKOperationMetrics {
+@private
+    WebpMetricsReport _report;
+}
+
+- (instancetype)initWithReport:(const WebpMetricsReport *)report {
+    if (self = [super init]) {
+        _report = *report;
+    }
+    return self;
+}
+
+- (WIKMetricsOperation)operation {
+    switch (_report.operation) {
+        case WebpMetricsOperationDecode:
+            return WIKMetricsOperationDecode;
+        case WebpMetricsOperationEncode:
+            return WIKMetricsOperationEncode;
+        case WebpMetricsOperationTransmux:
+            return WIKMetricsOperationTransmux;
+        default:
+            return WIKMetricsOperationNone;
+    }
+}
+
+- (NSTimeInterval)duration {
+    return (NSTimeInterval) _report.duration / NSEC_PER_SEC;
+}
+
+- (NSUInteger)peakMemory {
+    return _report.peakMemory;
+}
+
+- (NSTimeInterval)durationOfStage:(const WIKMetricsStage)stage {
+    if (0 > stage || WebpMetricsStageCount <= stage) {
+        return 0;
+    }
+    return (NSTimeInterval) _report.stageDuration[stage] / NSEC_PER_SEC;
+}
+
+- (NSUInteger)bytesOfStage:(const WIKMetricsStage)stage {
+    if (0 > stage || WebpMetricsStageCount <= stage) {
+        return 0;
+    }
+    return (NSUInteger) _report.stageBytes[stage];
+}
+
+- (NSString *)description {
+    static NSString * const stageNames[WebpMetricsStageCount] = {
+            @"demux", @"decode", @"colorspace", @"composite", @"rescale", @"import", @"encode", @"mux"
+    };
+    NSMutableString *description = [NSMutableString stringWithFormat:@"<%@: %p; duration = %.3f ms; peakMemory = %zu",
+                                                                     NSStringFromClass(self.class), self,
+                                                                     self.duration * 1000.0, _report.peakMemory];
+    for (int stage = 0; stage < WebpMetricsStageCount; ++stage) {
+        if (0 < _report.stageDuration[stage]) {
+            [description appendFormat:@"; %@ = %.3f ms", stageNames[stage], _report.stageDuration[stage] / 1e6];
+        }
+    }
+    [description appendString:@">"];
+    return description;
+}
+
+@end
+
+static os_unfair_lock webpMetricsHandlerLock = OS_UNFAIR_LOCK_INIT;
+static WIKMetricsHandler webpMetricsBlock;
+
+static void webpMetricsDeliverReport(const WebpMetricsReport *report, void *context) {
+    @autoreleasepool {
+        WIKMetricsHandler handler = (__bridge WIKMetricsHandler) context;
+        handler([[WIKOperationMetrics alloc] initWithReport:report]);
+    }
+}
+
+@implementation WIKMetrics
+
++ (nullable WIKMetricsHandler)handler {
+    os_unfair_lock_lock(&webpMetricsHandlerLock);
+    WIKMetricsHandler handler = webpMetricsBlock;
+    os_unfair_lock_unlock(&webpMetricsHandlerLock);
+    return handler;
+}
+
++ (void)setHandler:(nullable WIKMetricsHandler)handler {
+    os_unfair_lock_lock(&webpMetricsHandlerLock);
+    // Reports are delivered under the core lock, so the previous block is released only once
+    // the core stops using it.
+    __unused WIKMetricsHandler previousHandler = webpMetricsBlock;
+    webpMetricsBlock = [handler copy];
+    webpMetricsSetHandler(webpMetricsBlock ? webpMetricsDeliverReport : NULL, (__bridge void *) webpMetricsBlock);
+    os_unfair_lock_unlock(&webpMetricsHandlerLock);
+}
+
+@end
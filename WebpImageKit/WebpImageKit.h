@@ -15,7 +15,17 @@ FOUNDATION_EXPORT double WebpImageKitVersionNumber;
 FOUNDATION_EXPORT const unsigned char WebpImageKitVersionString[];
 
 #import <WebpImageKit/WIKAnimationFrame.h>
+#import <WebpImageKit/WIKAnimatedImage.h>
+#import <WebpImageKit/WIKIncrementalDecoder.h>
+#import <WebpImageKit/WIKImageCache.h>
+#import <WebpImageKit/WIKImageOperationQueue.h>
+#import <WebpImageKit/WIKMemoryGovernor.h>
+#import <WebpImageKit/WIKMetrics.h>
 #import <WebpImageKit/WIKEncoderConfig.h>
+#import <WebpImageKit/WIKEncoderSession.h>
+#import <WebpImageKit/WIKAnimationEncoder.h>
 #import <WebpImageKit/UIImage+WebP.h>
 #import <WebpImageKit/CGImage+WebP.h>
+#import <WebpImageKit/CFData+WebP.h>
+#import <WebpImageKit/CVPixelBuffer+WebP.h>
 